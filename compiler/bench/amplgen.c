@@ -0,0 +1,293 @@
+/**
+ * @file    amplgen.c
+ * @brief   A generator of synthetic AMPL-2023 programs, for benchmarking the
+ *          compiler.
+ *
+ * The shape of the program is set by parameters: the number of subroutines,
+ * the number of local variables in each, the depth to which loops and
+ * conditionals nest, the number of operands in each expression, and the size
+ * of the string literals.  The same parameters and seed always give the same
+ * program, on every platform, since the generator has a random number
+ * generator of its own.  Every program type checks, and runs to completion.
+ *
+ * @date    2026-10-16
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define USAGE "usage: %s [-n subroutines] [-m locals] [-d depth]" \
+	" [-w width] [-s string]\n       [-r seed] [-p name]\n"
+
+/** the operators of generated expressions */
+static const char *ops[] = { "+", "-", "*" };
+
+/* --- global static variables ---------------------------------------------- */
+
+static unsigned long seed = 1;  /**< the seed of the generator        */
+static int nsubs = 10;          /**< the number of subroutines        */
+static int nlocal = 4;          /**< the local variables of each      */
+static int depth = 3;           /**< the depth of nested statements   */
+static int width = 4;           /**< the operands of each expression  */
+static int strsize = 16;        /**< the size of each string literal  */
+
+/* --- function prototypes -------------------------------------------------- */
+
+static void gen_subdef(int k);
+static void gen_main(void);
+static void gen_locals(void);
+static void gen_nest(int level, int indent);
+static void gen_expr(int navail);
+static void gen_operand(int navail);
+static void gen_string(void);
+static void tab(int indent);
+static unsigned long next(void);
+static int parse_count(const char *arg, const char *progname);
+
+/* --- main routine --------------------------------------------------------- */
+
+int main(int argc, char *argv[])
+{
+	const char *name;
+	int c, k;
+
+	name = "gen";
+	while ((c = getopt(argc, argv, "n:m:d:w:s:r:p:")) != -1) {
+		switch (c) {
+			case 'n': nsubs = parse_count(optarg, argv[0]); break;
+			case 'm': nlocal = parse_count(optarg, argv[0]); break;
+			case 'd': depth = parse_count(optarg, argv[0]); break;
+			case 'w': width = parse_count(optarg, argv[0]); break;
+			case 's': strsize = parse_count(optarg, argv[0]); break;
+			case 'r': seed = parse_count(optarg, argv[0]); break;
+			case 'p': name = optarg; break;
+			default:
+				fprintf(stderr, USAGE, argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+	if (optind != argc) {
+		fprintf(stderr, USAGE, argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	/* every expression needs at least one operand, and a routine at least
+	 * one variable for its result */
+	if (width < 1) {
+		width = 1;
+	}
+	if (nlocal < 1) {
+		nlocal = 1;
+	}
+
+	printf("program %s:\n", name);
+	for (k = 0; k < nsubs; k++) {
+		gen_subdef(k);
+	}
+	gen_main();
+
+	return EXIT_SUCCESS;
+}
+
+/* --- generators ----------------------------------------------------------- */
+
+/*
+ * Subroutine k is a function of two integers.  Its locals are v0, v1, ...,
+ * each initialised from the parameters and the locals before it, and the
+ * loops count with c0, c1, ..., one for each level of nesting.  It calls
+ * subroutine k - 1, so that every subroutine is used, and returns a value
+ * that depends on all its locals.
+ */
+static void gen_subdef(int k)
+{
+	int i;
+
+	printf("\nf%d(int a, int b) -> int:\n", k);
+	gen_locals();
+	for (i = 0; i < nlocal; i++) {
+		tab(1);
+		printf("let v%d = ", i);
+		gen_expr(i);
+		printf(";\n");
+	}
+	if (k > 0) {
+		tab(1);
+		printf("let v0 = v0 + f%d(v%d, %lu);\n", k - 1, nlocal - 1,
+				next() % 100);
+	}
+	if (depth > 0) {
+		gen_nest(0, 1);
+		printf(";\n");
+	}
+	tab(1);
+	printf("output(");
+	gen_string();
+	printf(" .. v0 .. \"\\n\");\n");
+	tab(1);
+	printf("return v0");
+	for (i = 1; i < nlocal; i++) {
+		printf(" + v%d", i);
+	}
+	printf("\n");
+}
+
+/* Main calls the last subroutine, which calls all the others. */
+static void gen_main(void)
+{
+	printf("\nmain:\n");
+	tab(1);
+	printf("int r;\n");
+	tab(1);
+	if (nsubs > 0) {
+		printf("let r = f%d(1, 2);\n", nsubs - 1);
+	} else {
+		printf("let r = 0;\n");
+	}
+	tab(1);
+	printf("output(\"result \" .. r .. \"\\n\")\n");
+}
+
+static void gen_locals(void)
+{
+	int i;
+
+	tab(1);
+	printf("int v0");
+	for (i = 1; i < nlocal; i++) {
+		printf(", v%d", i);
+	}
+	for (i = 0; i < depth; i++) {
+		printf(", c%d", i);
+	}
+	printf(";\n");
+}
+
+/*
+ * Even levels are loops that run twice, and odd levels are conditionals with
+ * an alternative, of which only one branch nests further, so that the size of
+ * the program grows linearly with the depth.  The statements are printed
+ * without a separator or line end after the last, which the caller adds.
+ */
+static void gen_nest(int level, int indent)
+{
+	if (level == depth) {
+		tab(indent);
+		printf("let v%lu = ", next() % nlocal);
+		gen_expr(nlocal);
+		return;
+	}
+
+	if (level % 2 == 0) {
+		tab(indent);
+		printf("let c%d = 0;\n", level);
+		tab(indent);
+		printf("while c%d < 2:\n", level);
+		gen_nest(level + 1, indent + 1);
+		printf(";\n");
+		tab(indent + 1);
+		printf("let c%d = c%d + 1\n", level, level);
+		tab(indent);
+		printf("end");
+	} else {
+		tab(indent);
+		printf("if (v%lu > %lu) and not (v%lu = c%d):\n", next() % nlocal,
+				next() % 50, next() % nlocal, level - 1);
+		gen_nest(level + 1, indent + 1);
+		printf("\n");
+		tab(indent);
+		printf("else:\n");
+		tab(indent + 1);
+		printf("let v%lu = ", next() % nlocal);
+		gen_expr(nlocal);
+		printf("\n");
+		tab(indent);
+		printf("end");
+	}
+}
+
+/*
+ * An expression has width operands, of which the value is kept small with
+ * "rem", so that the values do not all overflow alike; no division can be by
+ * zero.
+ */
+static void gen_expr(int navail)
+{
+	int i;
+
+	printf("(");
+	gen_operand(navail);
+	for (i = 1; i < width; i++) {
+		printf(" %s ", ops[next() % 3]);
+		gen_operand(navail);
+	}
+	printf(") rem %lu", next() % 1000 + 1);
+}
+
+/** Prints a parameter, an available local, or a constant. */
+static void gen_operand(int navail)
+{
+	unsigned long r = next() % (navail + 3);
+
+	if (r == 0) {
+		printf("a");
+	} else if (r == 1) {
+		printf("b");
+	} else if (r == 2) {
+		printf("%lu", next() % 1000);
+	} else {
+		printf("v%lu", r - 3);
+	}
+}
+
+static void gen_string(void)
+{
+	int i;
+
+	putchar('"');
+	for (i = 0; i < strsize; i++) {
+		putchar('a' + next() % 26);
+	}
+	putchar('"');
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+static void tab(int indent)
+{
+	while (indent-- > 0) {
+		printf("  ");
+	}
+}
+
+/**
+ * Returns the next number from a linear congruential generator, with the
+ * constants of Knuth's MMIX, of which the high bits are the most random.
+ */
+static unsigned long next(void)
+{
+	static unsigned long long state;
+	static int seeded = 0;
+
+	if (!seeded) {
+		state = seed;
+		seeded = 1;
+	}
+	state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+
+	return (unsigned long) (state >> 33);
+}
+
+static int parse_count(const char *arg, const char *progname)
+{
+	char *end;
+	long n;
+
+	n = strtol(arg, &end, 10);
+	if (*arg == '\0' || *end != '\0' || n < 0 || n > 100000000) {
+		fprintf(stderr, USAGE, progname);
+		exit(EXIT_FAILURE);
+	}
+
+	return (int) n;
+}
@@ -0,0 +1,84 @@
+#!/bin/sh
+#
+# Time the compilation of all the benchmark programs to class files: through
+# Jasmin with one amplc (and so one JVM) per file, through Jasmin with one
+# amplc for all the files, which assembles them in one JVM, and by writing the
+# class files directly.  The median of the repeats is reported in
+# milliseconds.  The Jasmin paths are reported as "-" if Java or Jasmin is not
+# available.
+#
+# usage: asmbench.sh [repeats]
+#
+# environment:
+#   AMPLC       the compiler (default: ../bin/amplc-bench, built by make here)
+#   JASMIN_JAR  the Jasmin assembler (default: none)
+#
+
+REPEATS=${1:-5}
+BENCHDIR=$(cd "$(dirname "$0")" && pwd)
+AMPLC=${AMPLC:-$BENCHDIR/../bin/amplc-bench}
+
+if [ ! -x "$AMPLC" ]; then
+	echo "$0: compiler '$AMPLC' not found; run make in $BENCHDIR" >&2
+	exit 1
+fi
+
+WORKDIR=$(mktemp -d)
+trap 'rm -rf "$WORKDIR"' EXIT
+cd "$WORKDIR" || exit 1
+
+now() {
+	date +%s%N
+}
+
+# median: read numbers, one per line, and print their median
+median() {
+	sort -n | awk '{ v[NR] = $1 } END { print v[int((NR + 1) / 2)] }'
+}
+
+# time_mode <mode>: print the median time in ms to compile every program
+time_mode() {
+	: > times
+	i=0
+	while [ $i -lt "$REPEATS" ]; do
+		start=$(now)
+		case $1 in
+			single)
+				for prog in "$BENCHDIR"/programs/*.ampl; do
+					"$AMPLC" --jasmin "$prog" > /dev/null 2>&1 || return 1
+				done
+				;;
+			batch)
+				"$AMPLC" --jasmin "$BENCHDIR"/programs/*.ampl \
+					> /dev/null 2>&1 || return 1
+				;;
+			direct)
+				"$AMPLC" "$BENCHDIR"/programs/*.ampl \
+					> /dev/null 2>&1 || return 1
+				;;
+		esac
+		end=$(now)
+		echo $(( (end - start) / 1000 )) >> times
+		i=$((i + 1))
+	done
+	median < times | awk '{ printf "%.1f\n", $1 / 1000 }'
+}
+
+have_jasmin=no
+command -v java > /dev/null 2>&1 && [ -n "$JASMIN_JAR" ] &&
+	[ -f "$JASMIN_JAR" ] && have_jasmin=yes
+
+nprogs=$(ls "$BENCHDIR"/programs/*.ampl | wc -l)
+single=-
+batch=-
+if [ $have_jasmin = yes ]; then
+	single=$(time_mode single) || single=fail
+	batch=$(time_mode batch) || batch=fail
+fi
+direct=$(time_mode direct) || direct=fail
+
+printf "%d programs\n" "$nprogs"
+printf "%-28s %12s\n" "path" "time (ms)"
+printf "%-28s %12s\n" "jasmin, one JVM per file" "$single"
+printf "%-28s %12s\n" "jasmin, one JVM for all" "$batch"
+printf "%-28s %12s\n" "class files, no JVM" "$direct"
@@ -0,0 +1,124 @@
+#!/bin/sh
+#
+# Time the reading of integers by AMPL-2023 programs: input/readints.ampl reads
+# a count and then that many integers into an array, from input made by
+# intgen, ten million integers by default.  The program is run in the
+# interpreter of the compiler (amplc --run), on the JVM, and as a native
+# executable, and the median of the repeats is reported in milliseconds.  The
+# program is compiled before the timing starts, so that the times are those of
+# reading the input.  Every path must print what the interpreter prints.
+#
+# The JVM path can also be timed with the class file of a baseline compiler,
+# such as one built before the runtime read its input without
+# java.util.Scanner, so that the two runtimes can be compared on one input.
+# A path whose tools are not available is reported as "-".
+#
+# usage: inbench.sh [-n count] [repeats]
+#
+# environment:
+#   AMPLC         the compiler (default: ../bin/amplc-bench, built by make here)
+#   AMPLC_BASE    the baseline compiler for the JVM path (default: none)
+#   INTGEN        the input generator (default: ../bin/intgen)
+#   AMPL_RUNTIME  the runtime object for the native path (default: none)
+#   JAVA          the Java launcher for the JVM path (default: java)
+#
+
+COUNT=10000000
+BENCHDIR=$(cd "$(dirname "$0")" && pwd)
+AMPLC=${AMPLC:-$BENCHDIR/../bin/amplc-bench}
+INTGEN=${INTGEN:-$BENCHDIR/../bin/intgen}
+JAVA=${JAVA:-java}
+PROG=$BENCHDIR/input/readints.ampl
+
+while getopts n: opt; do
+	case $opt in
+		n) COUNT=$OPTARG ;;
+		*) echo "usage: $0 [-n count] [repeats]" >&2; exit 1 ;;
+	esac
+done
+shift $((OPTIND - 1))
+REPEATS=${1:-5}
+
+if [ ! -x "$AMPLC" ]; then
+	echo "$0: compiler '$AMPLC' not found; run make in $BENCHDIR" >&2
+	exit 1
+fi
+if [ ! -x "$INTGEN" ]; then
+	echo "$0: generator '$INTGEN' not found; run make in $BENCHDIR" >&2
+	exit 1
+fi
+
+WORKDIR=$(mktemp -d)
+trap 'rm -rf "$WORKDIR"' EXIT
+cd "$WORKDIR" || exit 1
+
+now() {
+	date +%s%N
+}
+
+# median: read numbers, one per line, and print their median
+median() {
+	sort -n | awk '{ v[NR] = $1 } END { print v[int((NR + 1) / 2)] }'
+}
+
+# run_path <path>: run the compiled program once on the input
+run_path() {
+	case $1 in
+		run)    "$AMPLC" --run "$PROG" ;;
+		jvm)    "$JAVA" -cp jvm readints ;;
+		base)   "$JAVA" -cp base readints ;;
+		native) ./readints ;;
+	esac < input > "$1.out" 2> /dev/null
+}
+
+# time_path <path>: print the median time in ms, or fail if the output is
+# not that of the interpreter
+time_path() {
+	: > times
+	i=0
+	while [ $i -lt "$REPEATS" ]; do
+		start=$(now)
+		run_path "$1" || return 1
+		end=$(now)
+		echo $(( (end - start) / 1000 )) >> times
+		i=$((i + 1))
+	done
+	cmp -s "$1.out" expect || return 1
+	median < times | awk '{ printf "%.1f\n", $1 / 1000 }'
+}
+
+"$INTGEN" -n "$COUNT" > input || exit 1
+if ! "$AMPLC" --run "$PROG" < input > expect 2> /dev/null; then
+	echo "$0: readints does not run in the interpreter" >&2
+	exit 1
+fi
+
+have_jvm=no
+command -v "$JAVA" > /dev/null 2>&1 && have_jvm=yes
+have_native=no
+[ -n "$AMPL_RUNTIME" ] && [ -f "$AMPL_RUNTIME" ] && have_native=yes
+
+run=$(time_path run) || run=fail
+jvm=-
+base=-
+if [ $have_jvm = yes ]; then
+	mkdir jvm base
+	(cd jvm && "$AMPLC" "$PROG" > /dev/null 2>&1) &&
+		jvm=$(time_path jvm) || jvm=fail
+	if [ -n "$AMPLC_BASE" ]; then
+		(cd base && "$AMPLC_BASE" "$PROG" > /dev/null 2>&1) &&
+			base=$(time_path base) || base=fail
+	fi
+fi
+native=-
+if [ $have_native = yes ]; then
+	"$AMPLC" --target=x86_64 "$PROG" > /dev/null 2>&1 &&
+		native=$(time_path native) || native=fail
+fi
+
+printf "%d integers, %d bytes of input\n" "$COUNT" "$(wc -c < input)"
+printf "%-28s %12s\n" "path" "time (ms)"
+printf "%-28s %12s\n" "interpreter" "$run"
+printf "%-28s %12s\n" "jvm" "$jvm"
+printf "%-28s %12s\n" "jvm, baseline compiler" "$base"
+printf "%-28s %12s\n" "native" "$native"
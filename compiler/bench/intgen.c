@@ -0,0 +1,101 @@
+/**
+ * @file    intgen.c
+ * @brief   A generator of input for AMPL-2023 programs that read integers,
+ *          for benchmarking the input routines of the runtimes.
+ *
+ * The count is written first, and then that many integers, ten to a line.  The
+ * integers are spread over the whole range of 32 bits, so that they have all
+ * lengths and both signs, and the extremes are among the first, so that the
+ * readers are checked on them too.  The same count and seed always give the
+ * same input, since the generator of amplgen is used.
+ *
+ * @date    2026-10-16
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define USAGE "usage: %s [-n count] [-r seed]\n"
+
+/* --- global static variables ---------------------------------------------- */
+
+static unsigned long seed = 1;  /**< the seed of the generator */
+static int count = 10000000;    /**< the number of integers    */
+
+/* --- function prototypes -------------------------------------------------- */
+
+static unsigned long next(void);
+static int parse_count(const char *arg, const char *progname);
+
+/* --- main routine --------------------------------------------------------- */
+
+int main(int argc, char *argv[])
+{
+	uint32_t high;
+	int32_t value;
+	int c, i;
+
+	while ((c = getopt(argc, argv, "n:r:")) != -1) {
+		switch (c) {
+			case 'n': count = parse_count(optarg, argv[0]); break;
+			case 'r': seed = parse_count(optarg, argv[0]); break;
+			default:
+				fprintf(stderr, USAGE, argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+	if (optind != argc) {
+		fprintf(stderr, USAGE, argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	printf("%d\n", count);
+	for (i = 0; i < count; i++) {
+		if (i == 0) {
+			value = INT32_MIN;
+		} else if (i == 1) {
+			value = INT32_MAX;
+		} else {
+			/* two draws, since each has only 31 random bits */
+			high = (uint32_t) next() << 16;
+			value = (int32_t) (high ^ (uint32_t) next());
+		}
+		printf("%d", (int) value);
+		putchar(i % 10 == 9 || i == count - 1 ? '\n' : ' ');
+	}
+
+	return EXIT_SUCCESS;
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+/** Returns the next number from the generator of amplgen, which see. */
+static unsigned long next(void)
+{
+	static unsigned long long state;
+	static int seeded = 0;
+
+	if (!seeded) {
+		state = seed;
+		seeded = 1;
+	}
+	state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+
+	return (unsigned long) (state >> 33);
+}
+
+static int parse_count(const char *arg, const char *progname)
+{
+	char *end;
+	long n;
+
+	n = strtol(arg, &end, 10);
+	if (*arg == '\0' || *end != '\0' || n < 0 || n > 100000000) {
+		fprintf(stderr, USAGE, progname);
+		exit(EXIT_FAILURE);
+	}
+
+	return (int) n;
+}
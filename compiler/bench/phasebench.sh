@@ -0,0 +1,172 @@
+#!/bin/sh
+#
+# Time the phases of amplc on synthetic programs of different shapes, made by
+# amplgen, and report the median time of each phase over the repeats, the
+# spread of the total time, and the throughput in lines and tokens per second.
+# The programs are compiled to class files, without the cache, and nothing
+# needs the network, Java or Jasmin.
+#
+# The results can be saved, and a later run compared against them: a phase
+# that has become slower by more than the threshold is reported, and the
+# script then fails, so that a regression in the scanner, the symbol table or
+# the code generator is caught.
+#
+# usage: phasebench.sh [-r repeats] [-o results] [-b baseline] [-t percent]
+#
+# environment:
+#   AMPLC    the compiler (default: ../bin/amplc-bench, built by make here)
+#   AMPLGEN  the program generator (default: ../bin/amplgen)
+#
+
+REPEATS=11
+RESULTS=
+BASELINE=
+THRESHOLD=10
+BENCHDIR=$(cd "$(dirname "$0")" && pwd)
+AMPLC=${AMPLC:-$BENCHDIR/../bin/amplc-bench}
+AMPLGEN=${AMPLGEN:-$BENCHDIR/../bin/amplgen}
+
+usage() {
+	echo "usage: $0 [-r repeats] [-o results] [-b baseline] [-t percent]" >&2
+	exit 1
+}
+
+while getopts r:o:b:t: opt; do
+	case $opt in
+		r) REPEATS=$OPTARG ;;
+		o) RESULTS=$OPTARG ;;
+		b) BASELINE=$OPTARG ;;
+		t) THRESHOLD=$OPTARG ;;
+		*) usage ;;
+	esac
+done
+shift $((OPTIND - 1))
+[ $# -eq 0 ] || usage
+
+for tool in "$AMPLC" "$AMPLGEN"; do
+	if [ ! -x "$tool" ]; then
+		echo "$0: '$tool' not found; run make in $BENCHDIR" >&2
+		exit 1
+	fi
+done
+case $RESULTS in
+	''|/*) ;;
+	*) RESULTS=$(pwd)/$RESULTS ;;
+esac
+if [ -n "$BASELINE" ] && [ ! -r "$BASELINE" ]; then
+	echo "$0: baseline '$BASELINE' cannot be read" >&2
+	exit 1
+fi
+
+WORKDIR=$(mktemp -d)
+trap 'rm -rf "$WORKDIR"' EXIT
+[ -n "$BASELINE" ] && cp "$BASELINE" "$WORKDIR/baseline"
+cd "$WORKDIR" || exit 1
+
+# the shapes of the programs: name, then the subroutines, locals, depth of
+# nesting, width of expressions, and size of string literals
+CONFIGS="
+base     200   8    4   6   32
+subs     2000  4    2   4   16
+locals   100   200  2   4   16
+deep     100   8    40  4   16
+wide     100   8    2   200 16
+strings  200   4    2   4   4096
+"
+
+# bench <name> <n> <m> <d> <w> <s>: print the line of results for one shape
+bench() {
+	"$AMPLGEN" -n "$2" -m "$3" -d "$4" -w "$5" -s "$6" -p gen > gen.ampl ||
+		return 1
+	: > reports
+	i=0
+	while [ $i -lt "$REPEATS" ]; do
+		AMPLC_CACHE_DIR= "$AMPLC" --time-report=json gen.ampl \
+			> /dev/null 2>> reports || return 1
+		i=$((i + 1))
+	done
+
+	# the reports are on one line each, in the format that amplc prints
+	awk -v name="$1" '
+		function field(key,    s) {
+			s = $0
+			sub(".*\"" key "\": \\{\"wall_ms\": ", "", s)
+			sub(",.*", "", s)
+			return s + 0
+		}
+		function median(a, n,    i, j, t) {
+			for (i = 2; i <= n; i++) {
+				for (j = i; j > 1 && a[j - 1] > a[j]; j--) {
+					t = a[j]; a[j] = a[j - 1]; a[j - 1] = t
+				}
+			}
+			return (n % 2 ? a[(n + 1) / 2] : (a[n / 2] + a[n / 2 + 1]) / 2)
+		}
+		/^\{/ {
+			n++
+			lines = $0; sub(".*\"lines\": ", "", lines); sub(",.*", "", lines)
+			tokens = $0; sub(".*\"tokens\": ", "", tokens)
+			sub(",.*", "", tokens)
+			scan[n] = field("scan"); parse[n] = field("parse")
+			codegen[n] = field("codegen"); output[n] = field("output")
+			total[n] = field("total")
+		}
+		END {
+			if (n == 0) {
+				exit 1
+			}
+			t = median(total, n)
+			for (i = 1; i <= n; i++) {
+				dev[i] = (total[i] > t ? total[i] - t : t - total[i])
+			}
+			mad = (t > 0 ? 100 * median(dev, n) / t : 0)
+			printf "%s %d %d %.3f %.3f %.3f %.3f %.3f %.1f %.0f %.0f\n",
+				name, lines, tokens, median(scan, n), median(parse, n),
+				median(codegen, n), median(output, n), t, mad,
+				(t > 0 ? lines / t : 0), (t > 0 ? tokens / t : 0)
+		}' reports
+}
+
+: > results
+echo "$CONFIGS" | while read -r name n m d w s; do
+	[ -n "$name" ] || continue
+	bench "$name" "$n" "$m" "$d" "$w" "$s" >> results ||
+		echo "$name fail" >> results
+done
+
+# klines/s and ktokens/s are lines and tokens per ms over the total time
+printf "%-8s %7s %8s %8s %8s %8s %8s %9s %6s %9s %9s\n" shape lines tokens \
+	"scan" "parse" "codegen" "output" "total ms" "+-%" "klines/s" "ktok/s"
+awk '$2 == "fail" { printf "%-8s %7s\n", $1, "fail"; next }
+	{ printf "%-8s %7d %8d %8.2f %8.2f %8.2f %8.2f %9.2f %6.1f %9.0f %9.0f\n",
+		$1, $2, $3, $4, $5, $6, $7, $8, $9, $10, $11 }' results
+
+[ -n "$RESULTS" ] && cp results "$RESULTS"
+
+# a phase regresses if it is slower by the threshold, and by more than the
+# resolution of a short run, which is taken as 0.5 ms
+if [ -n "$BASELINE" ]; then
+	awk -v threshold="$THRESHOLD" '
+		BEGIN {
+			split("scan parse codegen output total", phase, " ")
+		}
+		NR == FNR {
+			for (i = 4; i <= 8; i++) {
+				base[$1, i] = $i
+			}
+			next
+		}
+		$2 != "fail" && ($1, 4) in base {
+			for (i = 4; i <= 8; i++) {
+				old = base[$1, i]
+				if ($i > old * (1 + threshold / 100) && $i - old > 0.5) {
+					printf "regression: %s %s %.2f ms, was %.2f ms\n",
+						$1, phase[i - 3], $i, old
+					bad = 1
+				}
+			}
+		}
+		END {
+			exit bad
+		}' baseline results || exit 1
+fi
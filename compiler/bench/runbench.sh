@@ -0,0 +1,106 @@
+#!/bin/sh
+#
+# Time short-running AMPL-2023 programs from source to output: run in the
+# interpreter of the compiler (amplc --run), compiled to a class file and run
+# on the JVM, and compiled to a native executable.  Each path is timed as a
+# whole, compilation included, and the median of the repeats is reported in
+# milliseconds.  A path whose tools are not available is reported as "-".
+# With -p, only the named program is timed, such as printints, which prints a
+# million integers and so measures the output path of each target.
+#
+# usage: runbench.sh [-p program] [repeats]
+#
+# environment:
+#   AMPLC         the compiler (default: ../bin/amplc-bench, built by make here)
+#   AMPL_RUNTIME  the runtime object for the native path (default: none)
+#   JAVA          the Java launcher for the JVM path (default: java)
+#
+
+BENCHDIR=$(cd "$(dirname "$0")" && pwd)
+AMPLC=${AMPLC:-$BENCHDIR/../bin/amplc-bench}
+JAVA=${JAVA:-java}
+PROGRAM=
+
+while getopts p: opt; do
+	case $opt in
+		p) PROGRAM=$OPTARG ;;
+		*) echo "usage: $0 [-p program] [repeats]" >&2; exit 1 ;;
+	esac
+done
+shift $((OPTIND - 1))
+REPEATS=${1:-11}
+
+# the programs to time are kept in the positional parameters
+if [ -n "$PROGRAM" ]; then
+	set -- "$BENCHDIR/programs/$PROGRAM.ampl"
+else
+	set -- "$BENCHDIR"/programs/*.ampl
+fi
+
+if [ ! -x "$AMPLC" ]; then
+	echo "$0: compiler '$AMPLC' not found; run make in $BENCHDIR" >&2
+	exit 1
+fi
+for prog in "$@"; do
+	if [ ! -f "$prog" ]; then
+		echo "$0: program '$prog' not found" >&2
+		exit 1
+	fi
+done
+
+WORKDIR=$(mktemp -d)
+trap 'rm -rf "$WORKDIR"' EXIT
+cd "$WORKDIR" || exit 1
+
+now() {
+	date +%s%N
+}
+
+# median: read numbers, one per line, and print their median
+median() {
+	sort -n | awk '{ v[NR] = $1 } END { print v[int((NR + 1) / 2)] }'
+}
+
+# time_path <path> <program>: print the median time in ms for one path
+time_path() {
+	: > times
+	i=0
+	while [ $i -lt "$REPEATS" ]; do
+		start=$(now)
+		case $1 in
+			run)
+				"$AMPLC" --run "$2" > /dev/null 2>&1 || return 1
+				;;
+			jvm)
+				"$AMPLC" "$2" > /dev/null 2>&1 &&
+					"$JAVA" -cp . "$(basename "$2" .ampl)" > /dev/null 2>&1 ||
+					return 1
+				;;
+			native)
+				"$AMPLC" --target=x86_64 "$2" > /dev/null 2>&1 &&
+					"./$(basename "$2" .ampl)" > /dev/null 2>&1 || return 1
+				;;
+		esac
+		end=$(now)
+		echo $(( (end - start) / 1000 )) >> times
+		i=$((i + 1))
+	done
+	median < times | awk '{ printf "%.1f\n", $1 / 1000 }'
+}
+
+have_jvm=no
+command -v "$JAVA" > /dev/null 2>&1 && have_jvm=yes
+have_native=no
+[ -n "$AMPL_RUNTIME" ] && [ -f "$AMPL_RUNTIME" ] && have_native=yes
+
+printf "%-12s %12s %12s %12s\n" program "run (ms)" "jvm (ms)" "native (ms)"
+for prog in "$@"; do
+	run=$(time_path run "$prog") || run=fail
+	jvm=-
+	[ $have_jvm = yes ] && { jvm=$(time_path jvm "$prog") || jvm=fail; }
+	native=-
+	[ $have_native = yes ] && { native=$(time_path native "$prog") ||
+		native=fail; }
+	printf "%-12s %12s %12s %12s\n" "$(basename "$prog" .ampl)" "$run" "$jvm" \
+		"$native"
+done
@@ -0,0 +1,218 @@
+/**
+ * @file    scanbench.c
+ * @brief   A microbenchmark of the scanner on words, most of them reserved.
+ *
+ * A corpus of words is made in memory, of which the given percentage are
+ * reserved words and the rest identifiers that resemble them, and is scanned
+ * repeatedly.  The best time of a scan over the whole corpus is reported, per
+ * word and in words per second, which isolates the recognition of reserved
+ * words from the rest of the compiler.  Every word is checked to scan to its
+ * token, so that a fast but wrong scanner is not reported as an improvement.
+ *
+ * @date    2026-10-16
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "arena.h"
+#include "scanner.h"
+#include "token.h"
+
+#define USAGE "usage: %s [-n words] [-k percent] [-r repeats]\n"
+
+/** the reserved words of AMPL-2023, with their tokens */
+static const struct {
+	const char *word;
+	TokenType type;
+} words[] = {
+	{ "and", TOK_AND },         { "array", TOK_ARRAY },
+	{ "bool", TOK_BOOL },       { "chillax", TOK_CHILLAX },
+	{ "elif", TOK_ELIF },       { "else", TOK_ELSE },
+	{ "end", TOK_END },         { "false", TOK_FALSE },
+	{ "if", TOK_IF },           { "input", TOK_INPUT },
+	{ "int", TOK_INT },         { "let", TOK_LET },
+	{ "main", TOK_MAIN },       { "not", TOK_NOT },
+	{ "or", TOK_OR },           { "output", TOK_OUTPUT },
+	{ "program", TOK_PROGRAM }, { "rem", TOK_REM },
+	{ "return", TOK_RETURN },   { "true", TOK_TRUE },
+	{ "while", TOK_WHILE }
+};
+
+#define NWORDS (sizeof(words) / sizeof(words[0]))
+
+/* --- global static variables ---------------------------------------------- */
+
+static int nwords = 1000000;    /**< the words in the corpus          */
+static int percent = 70;        /**< the percentage of reserved words */
+static int repeats = 11;        /**< the scans of the corpus          */
+
+/* --- function prototypes -------------------------------------------------- */
+
+static char *make_corpus(TokenType *expect, size_t *len);
+static int64_t scan_corpus(const char *corpus, size_t len,
+		const TokenType *expect);
+static unsigned long next(void);
+static int parse_count(const char *arg, const char *progname);
+
+/* --- main routine --------------------------------------------------------- */
+
+int main(int argc, char *argv[])
+{
+	TokenType *expect;
+	char *corpus;
+	size_t len;
+	int64_t ns, best;
+	int c, i;
+
+	while ((c = getopt(argc, argv, "n:k:r:")) != -1) {
+		switch (c) {
+			case 'n': nwords = parse_count(optarg, argv[0]); break;
+			case 'k': percent = parse_count(optarg, argv[0]); break;
+			case 'r': repeats = parse_count(optarg, argv[0]); break;
+			default:
+				fprintf(stderr, USAGE, argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+	if (optind != argc || nwords < 1 || percent > 100 || repeats < 1) {
+		fprintf(stderr, USAGE, argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	expect = malloc(nwords * sizeof(*expect));
+	if (expect == NULL) {
+		perror(argv[0]);
+		return EXIT_FAILURE;
+	}
+	corpus = make_corpus(expect, &len);
+
+	best = -1;
+	for (i = 0; i < repeats; i++) {
+		ns = scan_corpus(corpus, len, expect);
+		if (ns < 0) {
+			fprintf(stderr, "%s: a word scanned to the wrong token\n",
+					argv[0]);
+			return EXIT_FAILURE;
+		}
+		if (best < 0 || ns < best) {
+			best = ns;
+		}
+	}
+
+	printf("%d words, %d%% reserved: %.2f ns/word, %.1f Mwords/s\n",
+			nwords, percent, (double) best / nwords,
+			best > 0 ? 1000.0 * nwords / best : 0.0);
+
+	free(corpus);
+	free(expect);
+
+	return EXIT_SUCCESS;
+}
+
+/* --- the corpus ----------------------------------------------------------- */
+
+/*
+ * The identifiers are reserved words with a character added or changed, so
+ * that each shares the length, the first character, or the last character of
+ * a reserved word, and so cannot be told apart by any one of these alone.  No
+ * reserved word starts with "q" or ends with "z" or "_".
+ */
+static char *make_corpus(TokenType *expect, size_t *len)
+{
+	char *corpus, *p;
+	size_t k, n;
+	int i;
+
+	corpus = malloc((size_t) nwords * (MAX_ID_LEN + 1));
+	if (corpus == NULL) {
+		perror("make_corpus");
+		exit(EXIT_FAILURE);
+	}
+
+	p = corpus;
+	for (i = 0; i < nwords; i++) {
+		k = next() % NWORDS;
+		n = strlen(words[k].word);
+		memcpy(p, words[k].word, n);
+		if ((int) (next() % 100) < percent) {
+			expect[i] = words[k].type;
+		} else {
+			expect[i] = TOK_ID;
+			switch (next() % 3) {
+				case 0: p[n++] = '_'; break;
+				case 1: p[n - 1] = 'z'; break;
+				default: p[0] = 'q'; break;
+			}
+		}
+		p += n;
+		*p++ = (i % 16 == 15 ? '\n' : ' ');
+	}
+	*len = p - corpus;
+
+	return corpus;
+}
+
+/* --- the benchmark -------------------------------------------------------- */
+
+/**
+ * Scans the corpus once, and returns the time that it took in nanoseconds, or
+ * -1 if a word scanned to a token other than the one expected.
+ */
+static int64_t scan_corpus(const char *corpus, size_t len,
+		const TokenType *expect)
+{
+	struct timespec start, stop;
+	Token token;
+	int i, wrong;
+
+	init_scanner_buffer(corpus, len);
+	wrong = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < nwords; i++) {
+		get_token(&token);
+		wrong |= (token.type != expect[i]);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &stop);
+	get_token(&token);
+	wrong |= (token.type != TOK_EOF);
+	release_scanner();
+	release_unit_arena();
+
+	if (wrong) {
+		return -1;
+	}
+
+	return (stop.tv_sec - start.tv_sec) * (int64_t) 1000000000
+		+ (stop.tv_nsec - start.tv_nsec);
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+/** Returns the next number from the generator of amplgen, which see. */
+static unsigned long next(void)
+{
+	static unsigned long long state = 1;
+
+	state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+
+	return (unsigned long) (state >> 33);
+}
+
+static int parse_count(const char *arg, const char *progname)
+{
+	char *end;
+	long n;
+
+	n = strtol(arg, &end, 10);
+	if (*arg == '\0' || *end != '\0' || n < 0 || n > 100000000) {
+		fprintf(stderr, USAGE, progname);
+		exit(EXIT_FAILURE);
+	}
+
+	return (int) n;
+}
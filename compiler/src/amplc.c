@@ -16,22 +16,36 @@
  * @date    2023-07-04
  */
 
+#include "arena.h"
+#include "ast.h"
+#include "batch.h"
 #include "boolean.h"
+#include "cache.h"
+#include "classfile.h"
 #include "errmsg.h"
 #include "error.h"
+#include "fold.h"
 #include "hashtable.h"
+#include "interp.h"
+#include "libamplc.h"
+#include "lower.h"
 #include "scanner.h"
+#include "server.h"
 #include "stdarg.h"
 #include "symboltable.h"
+#include "timing.h"
 #include "token.h"
 #include "valtypes.h"
+#include "x86_64.h"
 #include "codegen.h"
 
 #include <ctype.h>
 #include <limits.h>
+#include <setjmp.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 /* --- type definitions --------------------------------------------------- */
 
@@ -40,6 +54,7 @@
 typedef struct variable_s Variable;
 struct variable_s {
 	char *id;       /**< variable identifier                                */
+	unsigned int sym; /**< the number of the identifier                     */
 	ValType type;   /**< variable type                                      */
 	SourcePos pos;  /**< position of the variable in the source             */
 	Variable *next; /**< pointer to the next variable in the list           */
@@ -52,22 +67,38 @@ struct variable_s {
 void debug_start(const char *fmt, ...);
 void debug_end(const char *fmt, ...);
 void debug_info(const char *fmt, ...);
+void debug_reset(void);
 #define DBG_start(...) debug_start(__VA_ARGS__)
 #define DBG_end(...)   debug_end(__VA_ARGS__)
 #define DBG_info(...)  debug_info(__VA_ARGS__)
+#define DBG_reset()    debug_reset()
 #else
 #define DBG_start(...)
 #define DBG_end(...)
 #define DBG_info(...)
+#define DBG_reset()
 #endif /* DEBUG_PARSER */
 
 /* --- global variables --------------------------------------------------- */
 
-Token token; /**< the lookahead token type                           */
-ValType return_type; /**< the return type of the current subroutine          */
+_Thread_local Token token;          /**< the lookahead token type           */
+_Thread_local ValType return_type; /**< the return type of the subroutine */
+
+/* the cache of routine code, or NULL if routines are not cached */
+static _Thread_local const char *routine_cache;
+static _Thread_local CacheDigest routine_digest; /**< the start of each key */
+static _Thread_local FILE *quiet;                /**< discards messages     */
+static _Thread_local unsigned long reused;       /**< the routines reused   */
+static _Thread_local unsigned long built;        /**< the routines compiled */
 
 /* --- helper macros ------------------------------------------------------ */
 
+#define USAGE "usage: %s [--target=jvm | --target=x86_64 | --run]" \
+	" [--jasmin | --dump-ast] [-j <jobs>]\n" \
+	"       [--time-report[=json]] <filename>...\n" \
+	"       %s --server <socket>\n" \
+	"       %s --cache-stats"
+
 #define STARTS_FACTOR(toktype)                                                \
 	(toktype == TOK_ID || toktype == TOK_NUM || toktype == TOK_LPAREN ||      \
 	 toktype == TOK_NOT || toktype == TOK_TRUE || toktype == TOK_FALSE)
@@ -89,34 +120,50 @@ ValType return_type; /**< the return type of the current subroutine          */
 
 #define IS_TYPE(toktype)  (toktype = TOK_BOOL || toktype == TOK_INT)
 
+/* the suffix of the code of a routine in the cache */
+#define BODY_EXT ".body"
+
 /* ----- function prototypes: parser routines -------------------------------- */
 
-void parse_program(void); // Done
-void parse_subdef(void); // Done
-void parse_body(void); // Done
-void parse_type(ValType *t0); // Done
-void parse_vardef(void); // Done
-void parse_statements(void); // Done
-void parse_statement(void); // Done
-void parse_assign(void); // Done
-void parse_call(void); // Done
-void parse_if(void); // Done
-void parse_input(void); // Done
-void parse_output(void); // Done
-void parse_return(void); // Done
-void parse_while(void); // Done
-void parse_arglist(char *id, SourcePos idpos); //Done
-void parse_index(char *id); //Done
-void parse_expr(ValType *t0); //Done
-void parse_relop(void); //Done
-void parse_simple(ValType *t0); //Done
-void parse_addop(void); //Done
-void parse_term(ValType *t0); //Done
-void parse_mulop(void); //Done
-void parse_factor(ValType *t0); //Done
+AstNode *parse_program(void);
+AstNode *parse_subdef(void);
+void parse_body(AstNode *routine);
+void parse_type(ValType *t0);
+AstNode *parse_vardef(void);
+AstNode *parse_statements(void);
+AstNode *parse_statement(void);
+AstNode *parse_assign(void);
+AstNode *parse_call(void);
+AstNode *parse_if(void);
+AstNode *parse_input(void);
+AstNode *parse_output(void);
+AstNode *parse_return(void);
+AstNode *parse_while(void);
+AstNode *parse_arglist(char *id, IDPropt *prop);
+AstNode *parse_index(char *id);
+AstNode *parse_expr(void);
+void parse_relop(void);
+AstNode *parse_simple(void);
+void parse_addop(void);
+AstNode *parse_term(void);
+void parse_mulop(void);
+AstNode *parse_factor(void);
 void parse_string(void); //Done
 
 
+/* --- function prototypes: incremental compilation ------------------------- */
+
+AstNode *reuse_routine(char **key);
+Boolean skim_routine(CacheDigest *d, Boolean is_main);
+void hash_token(CacheDigest *d, Token *t);
+void store_routines(AstNode *program);
+void store_routine(AstNode *node);
+char *body_name(const char *routine);
+
+/* --- function prototypes: time report ------------------------------------- */
+
+void time_scanning(void);
+
 /* --- function prototypes: helper routines --------------------------------- */
 
 /* TODO: Uncomment the following commented-out prototypes for use during type
@@ -125,7 +172,7 @@ void parse_string(void); //Done
 
 void chktypes(ValType found, ValType expected, SourcePos *pos, ...);
 void expect(TokenType type);
-void expect_id(char **id);
+void expect_id(char **id, unsigned int *sym);
 
 /* --- function prototypes: constructors ------------------------------------ */
 
@@ -134,75 +181,608 @@ IDPropt *idpropt(ValType type,
                  unsigned int offset,
                  unsigned int nparams,
                  ValType *params);
-Variable *variable(char *id, ValType type, SourcePos pos);
+Variable *variable(char *id, unsigned int sym, ValType type, SourcePos pos);
+AstNode *reference(AstKind kind, char *id, IDPropt *prop, SourcePos pos);
+AstNode *binary(TokenType op, AstNode *left, AstNode *right, SourcePos pos);
+AstNode *unary(TokenType op, AstNode *expr, SourcePos pos);
 
 
 /* --- function prototypes: error reporting --------------------------------- */
 
-void abort_c(Error err, ...);
-void abort_cp(SourcePos *posp, Error err, ...);
+_Noreturn void abort_c(Error err, ...);
+_Noreturn void abort_cp(SourcePos *posp, Error err, ...);
 
 /* --- main routine --------------------------------------------------------- */
 
+/* the library (libamplc) has the compiler without its command line */
+#ifndef AMPLC_LIBRARY
+
 /**
  * Main method for compiling ampl
  */
 int main(int argc, char *argv[])
 {
-
-	char *jasmin_path;
-
-	FILE *src_file;
+	char *server_path, **names, *opt, *end;
+	const char *cache_dir;
+	int i, n, jobs, status;
+	Boolean cache_stats;
+	Request req;
 
 	/* set up global variables */
 	setprogname(argv[0]);
 
-	/* check command-line arguments and environment */
-	if (argc != 2) {
-		eprintf("usage: %s <filename>", getprogname());
+	/* check command-line arguments */
+	memset(&req, 0, sizeof(req));
+	server_path = NULL;
+	names = emalloc(argc * sizeof(char *));
+	n = 0;
+	jobs = 1;
+	cache_stats = FALSE;
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--jasmin") == 0) {
+			req.use_jasmin = TRUE;
+		} else if (strcmp(argv[i], "--target=jvm") == 0) {
+			req.native = FALSE;
+		} else if (strcmp(argv[i], "--target=x86_64") == 0) {
+			req.native = TRUE;
+		} else if (strcmp(argv[i], "--run") == 0) {
+			req.run = TRUE;
+		} else if (strcmp(argv[i], "--dump-ast") == 0) {
+			req.dump = TRUE;
+		} else if (strcmp(argv[i], "--time-report") == 0) {
+			req.timed = TRUE;
+		} else if (strcmp(argv[i], "--time-report=json") == 0) {
+			req.timed = req.time_json = TRUE;
+		} else if (strcmp(argv[i], "--server") == 0 && i + 1 < argc
+				&& server_path == NULL) {
+			server_path = argv[++i];
+		} else if (strcmp(argv[i], "--cache-stats") == 0) {
+			cache_stats = TRUE;
+		} else if (strncmp(argv[i], "-j", 2) == 0) {
+			/* both "-j N" and "-jN" */
+			opt = (argv[i][2] == '\0' && i + 1 < argc
+					? argv[++i] : argv[i] + 2);
+			jobs = strtol(opt, &end, 10);
+			if (*opt == '\0' || *end != '\0' || jobs < 1) {
+				eprintf(USAGE, getprogname(), getprogname(), getprogname());
+			}
+		} else if (argv[i][0] == '-') {
+			eprintf(USAGE, getprogname(), getprogname(), getprogname());
+		} else {
+			names[n++] = argv[i];
+		}
 	}
 
+	/* the server takes its requests from the socket alone */
+	if (server_path != NULL) {
+		if (argc != 3) {
+			eprintf(USAGE, getprogname(), getprogname(), getprogname());
+		}
+		status = run_server(server_path, compile_request);
+		free(names);
+		freeprogname();
+		return status;
+	}
 
-	if ((jasmin_path = getenv("JASMIN_JAR")) == NULL) {
-	    eprintf("JASMIN_JAR environment variable not set");
+	/* the statistics of the cache are reported on their own */
+	if (cache_stats) {
+		if (argc != 2) {
+			eprintf(USAGE, getprogname(), getprogname(), getprogname());
+		}
+		if ((cache_dir = get_cache_dir()) == NULL) {
+			eprintf("%s environment variable not set", CACHE_DIR_ENV);
+		}
+		print_cache_stats(stdout, cache_dir);
+		free(names);
+		freeprogname();
+		return EXIT_SUCCESS;
 	}
-	
-	setsrcname(argv[1]);
 
-	/* open the source file, and report an error if it cannot be opened */
-	if ((src_file = fopen(argv[1], "r")) == NULL) {
-		eprintf("file '%s' could not be opened:", argv[1]);
+	/* running a program, or dumping its tree, is for one file at a time */
+	if (n == 0 || (req.native && req.use_jasmin)
+			|| (req.run && (req.native || req.use_jasmin))
+			|| (n > 1 && (req.run || req.dump))) {
+		eprintf(USAGE, getprogname(), getprogname(), getprogname());
 	}
 
-	/* initialise all compiler units */
-	init_scanner(src_file);
+	if (n == 1) {
+		req.src_name = names[0];
+		status = compile_request(&req);
+		free(req.output);
+	} else {
+		status = compile_batch(&req, names, n, jobs);
+	}
+	free(names);
+	freeprogname();
+
+#ifdef DEBUG_PARSER
+	if (status == EXIT_SUCCESS) {
+		printf("Success!\n");
+	}
+#endif
+
+	return status;
+}
+
+#endif /* AMPLC_LIBRARY */
+
+/* --- compilation ---------------------------------------------------------- */
+
+int compile_request(Request *req)
+{
+	jmp_buf env;
+	char *jasmin_path, *runtime_path, *volatile key;
+	const char *cache_dir, *src;
+	FILE *volatile src_file;
+	AstNode *program;
+	size_t len;
+	int status;
+
+	/* initialise all compiler units, before anything can go wrong */
+	src_file = NULL;
+	key = NULL;
+	routine_cache = NULL;
+	init_timing(req->timed);
+	DBG_reset();
 	init_symbol_table();
 	init_code_generation();
 
-	/* compile */
-	get_token(&token);
-	parse_program();
+	if ((status = setjmp(env)) != 0) {
+		goto release;
+	}
+	seterrjmp(&env);
+
+	/* check the environment */
+	jasmin_path = NULL;
+	if (req->use_jasmin && !req->dump
+			&& (jasmin_path = getenv("JASMIN_JAR")) == NULL) {
+		eprintf("JASMIN_JAR environment variable not set");
+	}
+
+	runtime_path = NULL;
+	if (req->native && !req->dump
+			&& (runtime_path = getenv("AMPL_RUNTIME")) == NULL) {
+		eprintf("AMPL_RUNTIME environment variable not set");
+	}
+
+	setsrcname(req->src_name);
 
-	/* produce the object code, and assemble */
-	make_code_file();
-	assemble(jasmin_path);
+	/* scan the source text, or open the source file, and report an error if
+	 * it cannot be opened */
+	start_phase(PHASE_READ);
+	if (req->source != NULL) {
+		init_scanner_buffer(req->source, req->length);
+	} else {
+		if ((src_file = fopen(req->src_name, "r")) == NULL) {
+			eprintf("file '%s' could not be opened:", req->src_name);
+		}
+		init_scanner(src_file);
+	}
+	stop_phase(PHASE_READ);
+
+	/* a compilation to a class file is looked up in the cache, if any, by
+	 * the hash of its source text, and a hit skips the compilation */
+	cache_dir = NULL;
+	if (!req->dump && !req->run && !req->native && !req->in_memory
+			&& (cache_dir = get_cache_dir()) != NULL) {
+		src = get_source_text(&len);
+		key = cache_key(src, len, req);
+		if ((req->output = cache_fetch(cache_dir, key)) != NULL) {
+			req->cached = TRUE;
+			goto report;
+		}
+	}
+
+	/* the code of unchanged routines is reused from the cache, unless the
+	 * whole syntax tree is wanted */
+	if (!req->dump && (routine_cache = get_cache_dir()) != NULL) {
+		reused = built = 0;
+	}
+
+	/* skimming ahead of the parser, and scanning on its own for the time
+	 * report, must not report errors, which the parser reports instead */
+	if ((routine_cache != NULL || req->timed)
+			&& (quiet = fopen("/dev/null", "w")) == NULL) {
+		routine_cache = NULL;
+	}
+	if (req->timed && quiet != NULL) {
+		time_scanning();
+	}
+
+	/* parse and type check the program into a syntax tree; the time of the
+	 * scanner, which the parser drives, is reported on its own */
+	start_phase(PHASE_PARSE);
+	get_token(&token);
+	program = parse_program();
+	stop_phase(PHASE_PARSE);
+	deduct_phase(PHASE_PARSE, PHASE_SCAN);
+
+	start_phase(PHASE_CODEGEN);
+	fold_program(program);
+	stop_phase(PHASE_CODEGEN);
+
+	if (req->dump) {
+		start_phase(PHASE_OUTPUT);
+		dump_ast(stdout, program);
+		stop_phase(PHASE_OUTPUT);
+	} else {
+		/* generate code from the syntax tree, and produce the object code,
+		 * either directly as a class file, by assembling Jasmin output
+		 * (which is useful for debugging), or as a native executable; or run
+		 * the generated code in the interpreter
+		 */
+		start_phase(PHASE_CODEGEN);
+		lower_program(program);
+		stop_phase(PHASE_CODEGEN);
+		if (routine_cache != NULL) {
+			store_routines(program);
+		}
+		if (req->run) {
+			start_phase(PHASE_RUN);
+			status = run_program();
+			stop_phase(PHASE_RUN);
+		} else if (req->native) {
+			start_phase(PHASE_OUTPUT);
+			make_asm_file();
+			stop_phase(PHASE_OUTPUT);
+			start_phase(PHASE_ASSEMBLE);
+			link_executable(runtime_path);
+			stop_phase(PHASE_ASSEMBLE);
+			req->output = estrdup(get_class_name());
+		} else {
+			req->output = emalloc(strlen(get_class_name())
+					+ sizeof(CLASS_EXT));
+			sprintf(req->output, "%s%s", get_class_name(), CLASS_EXT);
+			start_phase(PHASE_OUTPUT);
+			if (req->in_memory) {
+				req->image = build_class_file(&req->image_len);
+				stop_phase(PHASE_OUTPUT);
+			} else {
+				/* replace, rather than overwrite, an earlier class file,
+				 * since it may be linked to an entry in the cache */
+				unlink(req->output);
+				if (req->use_jasmin && req->defer) {
+					make_code_file();
+					stop_phase(PHASE_OUTPUT);
+					free(req->output);
+					req->output = keep_code_file();
+					req->cache_key = key;
+					key = NULL;
+				} else if (req->use_jasmin) {
+					make_code_file();
+					stop_phase(PHASE_OUTPUT);
+					start_phase(PHASE_ASSEMBLE);
+					assemble(jasmin_path);
+					stop_phase(PHASE_ASSEMBLE);
+				} else {
+					make_class_file();
+					stop_phase(PHASE_OUTPUT);
+				}
+				if (key != NULL) {
+					cache_store(cache_dir, key, req->output);
+				}
+			}
+		}
 
 #ifdef DEBUG_CODEGEN
-    list_code();
+		list_code();
 #endif
+	}
+
+report:
+	if (req->timed) {
+		print_time_report(geterrstream(), req->src_name, req->time_json);
+	}
 
+release:
 	/* release all allocated resources */
-	fclose(src_file);
-	freeprogname();
+	seterrjmp(NULL);
+	release_scanner();
+	if (src_file != NULL) {
+		fclose(src_file);
+	}
+	if (quiet != NULL) {
+		fclose(quiet);
+		quiet = NULL;
+	}
+	routine_cache = NULL;
 	freesrcname();
+	free(key);
 	release_symbol_table();
 	release_code_generation();
+	release_unit_arena();
 
-#ifdef DEBUG_PARSER
-	printf("Success!\n");
-#endif
+	return status;
+}
+
+/* --- incremental compilation --------------------------------------------- */
+
+/*
+ * The code of a routine depends only on its tokens, on the class name, and on
+ * the signatures of the subroutines that it calls.  Before a routine is
+ * parsed, its tokens are skimmed up to the start of the next routine, and
+ * hashed with the signatures of the names they use, as found in the global
+ * symbol table, to form its key in the cache.  On a hit, the code is loaded
+ * and the routine is not parsed; on a miss, the scanner is reset to the start
+ * of the routine, which is parsed as usual, and its code is stored once the
+ * program has compiled.  Positions are not hashed, so that editing one
+ * routine does not invalidate the routines after it.
+ */
+
+/**
+ * Reuses the code of the routine that starts at the current token from the
+ * cache, if it is there.
+ *
+ * @param[out] char **key
+ * 			receives the key of the routine on a miss, or NULL if the routine
+ * 			cannot be cached
+ *
+ * @return
+ * 		the routine, with its code, on a hit; or NULL on a miss, in which case
+ * 		the current token is still the first of the routine
+ */
+AstNode *reuse_routine(char **key)
+{
+	jmp_buf env, *outer;
+	Boolean is_main, found;
+	char *k, *name;
+	unsigned char *data;
+	size_t len;
+	FILE *errs;
+	Token start;
+	ScanMark mark;
+	CacheDigest d;
+	SourcePos pos;
+	AstNode *node;
+	Body *body;
+	IDPropt *prop;
+
+	*key = NULL;
+	if (routine_cache == NULL) {
+		return NULL;
+	}
+
+	start = token;
+	pos = position;
+	mark_scanner(&mark);
+	is_main = (token.type == TOK_MAIN);
+	d = routine_digest;
+
+	/* a scanner error ends the skim quietly, and is reported when the routine
+	 * is parsed */
+	errs = seterrstream(quiet);
+	outer = seterrjmp(&env);
+	if (setjmp(env) == 0) {
+		found = skim_routine(&d, is_main);
+	} else {
+		found = FALSE;
+	}
+	seterrjmp(outer);
+	seterrstream(errs);
+
+	if (!found) {
+		token = start;
+		reset_scanner(&mark);
+		return NULL;
+	}
+
+	k = digest_key(&d);
+	name = body_name(is_main ? "main" : start.lexeme);
+	data = cache_fetch_data(routine_cache, k, name, &len);
+	free(name);
+	if (data != NULL) {
+		node = ast_node(AST_SUBDEF, pos);
+		body = load_body(data, len, &node->subdef.prop);
+		free(data);
+		if (body != NULL && is_main && body->idprop == NULL) {
+			node->subdef.name = unit_strdup("main");
+		} else if (body != NULL && !is_main && body->idprop != NULL) {
+			/* enter the subroutine as its definition would have */
+			name = (char *) get_name(start.sym);
+			prop = idpropt(node->subdef.prop.type, 0,
+					node->subdef.prop.nparams, node->subdef.prop.params);
+			if (insert_name(start.sym, prop)) {
+				node->subdef.name = name;
+			}
+		}
+		if (node->subdef.name != NULL) {
+			node->subdef.code = body;
+			node->subdef.width = body->variables_width;
+			reused++;
+			free(k);
+			return node;
+		}
+	}
+
+	*key = unit_strdup(k);
+	built++;
+	free(k);
+	token = start;
+	reset_scanner(&mark);
+
+	return NULL;
+}
+
+/**
+ * Hashes the tokens of the routine that starts at the current token, up to the
+ * start of the next routine: "main", or a name followed by "(" and a type,
+ * which cannot occur in the body of a routine.  Main ends at the end of the
+ * source text.
+ *
+ * @param[in] CacheDigest *d
+ * 			the key of the routine so far
+ * @param[in] Boolean is_main
+ * 			whether the routine is main
+ *
+ * @return
+ * 		whether the end of the routine was found, in which case the current
+ * 		token is the first after it
+ */
+Boolean skim_routine(CacheDigest *d, Boolean is_main)
+{
+	Token t, peek;
+	ScanMark after;
+	Boolean first, next;
+
+	update_digest(d, (is_main ? "main" : "sub"), (is_main ? 5 : 4));
+	t = token;
+	for (first = TRUE; t.type != TOK_EOF; first = FALSE) {
+		if (!is_main && !first && t.type == TOK_MAIN) {
+			token = t;
+			return TRUE;
+		}
+		if (!is_main && !first && t.type == TOK_ID) {
+			mark_scanner(&after);
+			get_token(&peek);
+			next = FALSE;
+			if (peek.type == TOK_LPAREN) {
+				get_token(&peek);
+				next = (peek.type == TOK_INT || peek.type == TOK_BOOL);
+			}
+			reset_scanner(&after);
+			if (next) {
+				token = t;
+				return TRUE;
+			}
+		}
+		hash_token(d, &t);
+		get_token(&t);
+	}
+	token = t;
+
+	return is_main;
+}
+
+/**
+ * Adds a token to the key of a routine.  A name is hashed with the signature
+ * of the subroutine it names, if any, so that the routine is compiled again
+ * when the signature of a subroutine that it calls changes.
+ *
+ * @param[in] CacheDigest *d
+ * 			the key of the routine so far
+ * @param[in] Token *t
+ * 			the token
+ */
+void hash_token(CacheDigest *d, Token *t)
+{
+	IDPropt *prop;
+
+	update_digest(d, &t->type, sizeof(t->type));
+	switch (t->type) {
+		case TOK_ID:
+			update_digest(d, t->lexeme, t->len + 1);
+			if (find_name(t->sym, &prop)
+					&& IS_CALLABLE_TYPE(prop->type)) {
+				update_digest(d, &prop->type, sizeof(prop->type));
+				update_digest(d, &prop->nparams, sizeof(prop->nparams));
+				update_digest(d, prop->params,
+						prop->nparams * sizeof(ValType));
+			} else {
+				update_digest(d, "", 1);
+			}
+			break;
+		case TOK_NUM:
+			update_digest(d, &t->value, sizeof(t->value));
+			break;
+		case TOK_STR:
+			update_digest(d, t->string, strlen(t->string) + 1);
+			break;
+		default:
+			break;
+	}
+}
+
+/**
+ * Stores the code of the routines that were compiled in the cache, and counts
+ * the routines in its statistics.
+ *
+ * @param[in] AstNode *program
+ * 			the program
+ */
+void store_routines(AstNode *program)
+{
+	AstNode *s;
+
+	for (s = program->program.subdefs; s; s = s->next) {
+		store_routine(s);
+	}
+	store_routine(program->program.main);
+	cache_count_routines(routine_cache, reused, built);
+}
+
+/**
+ * Stores the code of a routine in the cache, if it was compiled.
+ *
+ * @param[in] AstNode *node
+ * 			the routine
+ */
+void store_routine(AstNode *node)
+{
+	char *name;
+	unsigned char *data;
+	size_t len;
+
+	if (node->subdef.key == NULL) {
+		return;
+	}
+	data = save_body(node->subdef.code, &len);
+	name = body_name(node->subdef.name);
+	cache_store_data(routine_cache, node->subdef.key, name, data, len);
+	free(name);
+	free(data);
+}
+
+/**
+ * Returns the name under which the code of a routine is stored in its entry in
+ * the cache.
+ *
+ * @param[in] const char *routine
+ * 			the name of the routine
+ *
+ * @return
+ * 		the name, which the caller must free
+ */
+char *body_name(const char *routine)
+{
+	char *name;
+
+	name = emalloc(strlen(routine) + sizeof(BODY_EXT));
+	sprintf(name, "%s%s", routine, BODY_EXT);
 
-	return EXIT_SUCCESS;
+	return name;
+}
+
+/* --- time report ---------------------------------------------------------- */
+
+/**
+ * Scans the whole source text once, on its own, to time the scanner apart
+ * from the parser that drives it, and to count its tokens; then returns the
+ * scanner to the start.  A scanning error ends the pass quietly, and is
+ * reported by the parser.
+ */
+void time_scanning(void)
+{
+	jmp_buf env, *outer;
+	ScanMark mark;
+	FILE *errs;
+	Token t;
+	volatile unsigned long ntokens;
+
+	mark_scanner(&mark);
+	ntokens = 0;
+	errs = seterrstream(quiet);
+	outer = seterrjmp(&env);
+	start_phase(PHASE_SCAN);
+	if (setjmp(env) == 0) {
+		for (get_token(&t); t.type != TOK_EOF; get_token(&t)) {
+			ntokens++;
+		}
+	}
+	stop_phase(PHASE_SCAN);
+	count_source(position.line, ntokens);
+	seterrjmp(outer);
+	seterrstream(errs);
+	reset_scanner(&mark);
 }
 
 /* --- parser routines ------------------------------------------------------ */
@@ -210,60 +790,75 @@ int main(int argc, char *argv[])
 /*
  * program = "program" id ":" { subdef } "main" ":" body .
  */
-void parse_program(void)
+AstNode *parse_program(void)
 {
-	char *class_name;
+	char *class_name, *key;
+	unsigned int sym;
 	SourcePos origin;
+	AstNode *program, *main_body, **subdefs;
 
 	DBG_start("<program>");
 
-	/* TODO: For code generation, set the class name inside this function, and
-	 * also handle initialising and closing the "main" function.  But from the
-	 * perspective of simple parsing, this function is complete.
-	 */
-
 	origin.line = 1;
 	origin.col = 0;
 	if (token.type == TOK_EOF) {
 		//abort_cp(&origin, ERR_EXPECT, TOK_PROGRAM);
 	}
+	program = ast_node(AST_PROGRAM, position);
 	expect(TOK_PROGRAM);
 
-	expect_id(&class_name);
-	set_class_name(class_name);
+	expect_id(&class_name, &sym);
+	program->program.name = class_name;
+
+	/* the code of a routine refers to the class by name */
+	if (routine_cache != NULL) {
+		init_digest(&routine_digest);
+		update_digest(&routine_digest, class_name, strlen(class_name) + 1);
+	}
 
 	expect(TOK_COLON);
 
+	subdefs = &program->program.subdefs;
 	while (token.type == TOK_ID) {
-		parse_subdef();
+		if ((*subdefs = reuse_routine(&key)) == NULL) {
+			*subdefs = parse_subdef();
+			(*subdefs)->subdef.key = key;
+		}
+		subdefs = &(*subdefs)->next;
 	}
 
-	expect(TOK_MAIN);
-	expect(TOK_COLON);
-
-	init_subroutine_codegen("main", NULL);
-	parse_body();
-	gen_1(JVM_RETURN);
-	close_subroutine_codegen(get_variables_width());
+	if ((main_body = reuse_routine(&key)) == NULL) {
+		main_body = ast_node(AST_SUBDEF, position);
+		main_body->subdef.name = unit_strdup("main");
+		main_body->subdef.key = key;
+		expect(TOK_MAIN);
+		expect(TOK_COLON);
 
-	free(class_name);
+		parse_body(main_body);
+		main_body->subdef.width = get_variables_width();
+	}
+	program->program.main = main_body;
 
 	DBG_end("</program>");
+
+	return program;
 }
 
 /**
  * subdef = id "(" type id {"," type id} ")" ["->" type] ":" body -$
  */
-void parse_subdef(void)
+AstNode *parse_subdef(void)
 {
 	DBG_start("<subdef>");
 
 	char *id, *subid;
+	unsigned int sym, subsym;
 	SourcePos subpos, pos;
 	ValType t1, *params;
 	Variable *head, *temp, *newvar;
 	unsigned int count, i, width;
 	IDPropt *prop;
+	AstNode *node, **tail;
 
 	subpos = position;
 	count = 0;
@@ -271,14 +866,16 @@ void parse_subdef(void)
 	t1 = 0;
 	id = NULL;
 	return_type = TYPE_NONE;
+	node = ast_node(AST_SUBDEF, subpos);
 
-	expect_id(&subid);
+	expect_id(&subid, &subsym);
+	node->subdef.name = subid;
 	expect(TOK_LPAREN);
 
 	parse_type(&t1);
 	pos = position;
-	expect_id(&id);
-	head = variable(id, t1, pos);
+	expect_id(&id, &sym);
+	head = variable(id, sym, t1, pos);
 	head->next = NULL;
 	count = 1;
 	temp = head;
@@ -288,8 +885,8 @@ void parse_subdef(void)
 		t1 = 0;
 		parse_type(&t1);
 		pos = position;
-		expect_id(&id);
-		newvar = variable(id, t1, pos);
+		expect_id(&id, &sym);
+		newvar = variable(id, sym, t1, pos);
 		newvar->next = NULL;
 		temp->next = newvar;
 		temp = newvar;
@@ -297,7 +894,7 @@ void parse_subdef(void)
 	}
 
 	expect(TOK_RPAREN);
-	params = emalloc(count * sizeof(Variable));
+	params = unit_alloc(count * sizeof(ValType));
 	temp = head;
 	for (i = 0; i < count; i++) {
 		params[i] = temp->type;
@@ -312,30 +909,31 @@ void parse_subdef(void)
 	return_type = t1;
 	width = get_variables_width();
 	prop = idpropt(t1, width, count, params);
+	node->subdef.prop = *prop;
 
-	if (open_subroutine(subid, prop)) {
+	if (open_subroutine(subsym, prop)) {
+		tail = &node->subdef.params;
 		while (head != NULL) {
 			temp = head;
 			prop = NULL;
-			if (find_name(temp->id, &prop)) {
+			if (find_name(temp->sym, &prop)) {
 				position = temp->pos;
 				//abort_c(ERR_MULTIPLE_DEFINITION, temp->id);
 			}
 			prop = NULL;
 			width = get_variables_width();
 			prop = idpropt(temp->type, width, 0, NULL);
-			if (!insert_name(temp->id, prop)) {
+			if (!insert_name(temp->sym, prop)) {
 				position = temp->pos;
 				//abort_c(ERR_MULTIPLE_DEFINITION, temp->id);
 			}
+			*tail = reference(AST_VARDEF, temp->id, prop, temp->pos);
+			tail = &(*tail)->next;
 			head = head->next;
-			free(temp);
-			temp = NULL;
 		}
 		expect(TOK_COLON);
-		init_subroutine_codegen(subid, prop);
-		parse_body();
-		close_subroutine_codegen(get_variables_width());
+		parse_body(node);
+		node->subdef.width = get_variables_width();
 		close_subroutine();
 		return_type = TYPE_NONE;
 	} else {
@@ -344,20 +942,30 @@ void parse_subdef(void)
 	}
 
 	DBG_end("</subdef>");
+
+	return node;
 }
 
 /**
  * body = {vardef} statements -$
+ * @param routine
+ * 		the subroutine or main node that receives the body
  */
-void parse_body(void)
+void parse_body(AstNode *routine)
 {
+	AstNode **vars;
+
 	DBG_start("<body>");
 
+	vars = &routine->subdef.vars;
 	while (token.type == TOK_BOOL || token.type == TOK_INT) {
-		parse_vardef();
+		*vars = parse_vardef();
+		while (*vars) {
+			vars = &(*vars)->next;
+		}
 	}
 
-	parse_statements();
+	routine->subdef.body = parse_statements();
 
 	DBG_end("</body>");
 }
@@ -392,137 +1000,165 @@ void parse_type(ValType *t0)
 
 /**
  * vardef = type id {"," id} ";" -$
+ * @return
+ * 		the list of variable definitions
  */
-void parse_vardef(void)
+AstNode *parse_vardef(void)
 {
 	char *id;
+	unsigned int sym;
 	ValType t1;
 	IDPropt *prop;
 	SourcePos pos;
 	unsigned int width;
+	AstNode *list, **tail;
 
 	DBG_start("<vardef>");
 
 	t1 = 0;
 	parse_type(&t1);
 	pos = position;
-	expect_id(&id);
+	expect_id(&id, &sym);
 
-	if (find_name(id, &prop)) {
+	if (find_name(sym, &prop)) {
 		position = pos;
 		//abort_c(ERR_MULTIPLE_DEFINITION, id);
 	}
 	width = get_variables_width();
 	prop = idpropt(t1, width, 0, NULL);
 
-	if (!insert_name(id, prop)) {
+	if (!insert_name(sym, prop)) {
 		position = pos;
 		//abort_c(ERR_MULTIPLE_DEFINITION, id);
 	}
+	list = reference(AST_VARDEF, id, prop, pos);
+	tail = &list->next;
 
 	while (token.type == TOK_COMMA) {
 		get_token(&token);
 		pos = position;
-		expect_id(&id);
+		expect_id(&id, &sym);
 
-		if (find_name(id, &prop)) {
+		if (find_name(sym, &prop)) {
 			position = pos;
 			//abort_c(ERR_MULTIPLE_DEFINITION, id);
 		}
 
 		width = get_variables_width();
 		prop = idpropt(t1, width, 0, NULL);
-		if (!insert_name(id, prop)) {
+		if (!insert_name(sym, prop)) {
 			position = pos;
 			//abort_c(ERR_MULTIPLE_DEFINITION, id);
 		}
+		*tail = reference(AST_VARDEF, id, prop, pos);
+		tail = &(*tail)->next;
 	}
 
 	expect(TOK_SEMICOLON);
 
 	DBG_end("</vardef>");
+
+	return list;
 }
 
 /**
  * statements = "chillax" | statement {";" statement} -$
+ * @return
+ * 		the list of statements, which is empty for "chillax"
  */
-void parse_statements(void)
+AstNode *parse_statements(void)
 {
+	AstNode *list, **tail;
+
 	DBG_start("<statements>");
 
+	list = NULL;
 	if (token.type == TOK_CHILLAX) {
 		get_token(&token);
 	} else {
-		parse_statement();
+		list = parse_statement();
+		tail = &list->next;
 		while (token.type == TOK_SEMICOLON) {
 			get_token(&token);
-			parse_statement();
+			*tail = parse_statement();
+			tail = &(*tail)->next;
 		}
 	}
 
 	DBG_end("</statements>");
+
+	return list;
 }
 
 /**
  * statement = assign | call | if | input | output | return | while -$
  */
-void parse_statement(void)
+AstNode *parse_statement(void)
 {
+	AstNode *node;
+
 	DBG_start("<statement>");
 
+	node = NULL;
 	switch (token.type) {
 		case TOK_LET:
-			parse_assign();
+			node = parse_assign();
 			break;
 		case TOK_ID:
-			parse_call();
+			node = parse_call();
 			break;
 		case TOK_IF:
-			parse_if();
+			node = parse_if();
 			break;
 		case TOK_INPUT:
-			parse_input();
+			node = parse_input();
 			break;
 		case TOK_OUTPUT:
-			parse_output();
+			node = parse_output();
 			break;
 		case TOK_RETURN:
-			parse_return();
+			node = parse_return();
 			break;
 		case TOK_WHILE:
-			parse_while();
+			node = parse_while();
 			break;
 		default:
 			abort_c(ERR_EXPECTED_STATEMENT);
 	}
 
 	DBG_end("</statement>");
+
+	return node;
 }
 
 /**
  * assign = "let" id [index] "=" (expr | "array" simple) -$
  */
-void parse_assign(void)
+AstNode *parse_assign(void)
 {
 	char *id;
+	unsigned int sym;
 	ValType t1, proptype, original_proptype;
 	IDPropt *prop;
 	bool indexed;
 	SourcePos idpos, pos;
+	AstNode *node, *target, *expr;
 
 	DBG_start("<assign>");
 
+	node = ast_node(AST_ASSIGN, position);
 	expect(TOK_LET);
 	idpos = position;
-	expect_id(&id);
+	expect_id(&id, &sym);
 	indexed = false;
 
-	if (!find_name(id, &prop)) {
+	if (!find_name(sym, &prop)) {
 		position = idpos;
-		//abort_c(ERR_UNKNOWN_IDENTIFIER, id);
+		abort_c(ERR_UNKNOWN_IDENTIFIER, id);
 	}
 	proptype = prop->type;
 	original_proptype = proptype;
+	target = reference(AST_VAR, id, prop, idpos);
 
 	if (IS_CALLABLE_TYPE(prop->type)) {
 		position = idpos;
@@ -537,15 +1173,20 @@ void parse_assign(void)
 		proptype ^= TYPE_ARRAY;
 
 		indexed = true;
-		parse_index(id);
+		target->kind = AST_INDEX;
+		target->type = proptype;
+		target->ref.index = parse_index(id);
 	}
+	node->assign.target = target;
 
 	expect(TOK_EQ);
 	pos = position;
 	t1 = proptype;
 
 	if (STARTS_EXPR(token.type)) {
-		parse_expr(&t1);
+		expr = parse_expr();
+		t1 = expr->type;
+		node->assign.expr = expr;
 
 		if (indexed) {
 			if (!IS_ARRAY(t1)) {
@@ -573,33 +1214,40 @@ void parse_assign(void)
 
 		get_token(&token);
 		pos = position;
-		parse_simple(&t1);
+		expr = parse_simple();
+		t1 = expr->type;
 		chktypes(t1, TYPE_INTEGER, &pos, "for array size of '%s'", id);
+		node->kind = AST_ALLOC;
+		node->assign.expr = expr;
 	} else {
 		//abort_c(ERR_EXPECTED_EXPRESSION_OR_ARRAY_ALLOCATION);
 	}
 
 	DBG_end("</assign>");
+
+	return node;
 }
 
 /**
  * call = id arglist -$
  */
-void parse_call(void)
+AstNode *parse_call(void)
 {
 	ValType type;
 	IDPropt *prop;
 	char *id;
+	unsigned int sym;
 	SourcePos idpos;
+	AstNode *node;
 
 	DBG_start("<call>");
 
 	idpos = position;
-	expect_id(&id);
+	expect_id(&id, &sym);
 
-	if (!find_name(id, &prop)) {
+	if (!find_name(sym, &prop)) {
 		position = idpos;
-		//abort_c(ERR_UNKNOWN_IDENTIFIER, id);
+		abort_c(ERR_UNKNOWN_IDENTIFIER, id);
 	}
 
 	if (IS_FUNCTION(prop->type)) {
@@ -617,177 +1265,188 @@ void parse_call(void)
 		}
 	}
 
-	parse_arglist(id, idpos);
-	gen_call(id, prop);
+	node = reference(AST_CALL, id, prop, idpos);
+	SET_RETURN_TYPE(node->type);
+	node->ref.args = parse_arglist(id, prop);
 
 	DBG_end("</call>");
+
+	return node;
 }
 
 /**
  * id = "if" expr ":" statements {"elif" expr ":" statements}
  * 		["else" ":" statements] "end" -$
  */
-void parse_if(void)
+AstNode *parse_if(void)
 {
-	ValType t1;
 	SourcePos pos;
-	int l1, l2, l3;
+	AstNode *node, *elif, **alt;
 
 	DBG_start("<if>");
 
-	l1 = get_label();
-	l2 = get_label();
-	l3 = get_label();
-
+	node = ast_node(AST_IF, position);
 	expect(TOK_IF);
 	pos = position;
-	parse_expr(&t1);
-	gen_2_label(JVM_IFEQ, l1); //false, go to l1
-	chktypes(t1, TYPE_BOOLEAN, &pos, "for 'if' guard");
+	node->branch.cond = parse_expr();
+	chktypes(node->branch.cond->type, TYPE_BOOLEAN, &pos, "for 'if' guard");
 	expect(TOK_COLON);
-	parse_statements();
-	gen_2_label(JVM_GOTO, l3);
+	node->branch.body = parse_statements();
 
-	gen_label(l1);
+	alt = &node->branch.alt;
 	while (token.type == TOK_ELIF) {
-		gen_label(l2);
+		elif = ast_node(AST_IF, position);
 		get_token(&token);
 		pos = position;
-		parse_expr(&t1);
-		gen_2_label(JVM_IFEQ, l2); 
-		chktypes(t1, TYPE_BOOLEAN, &pos, "for 'elif' guard");
+		elif->branch.cond = parse_expr();
+		chktypes(elif->branch.cond->type, TYPE_BOOLEAN, &pos,
+		         "for 'elif' guard");
 		expect(TOK_COLON);
-		parse_statements();
-		gen_2_label(JVM_GOTO, l3);
+		elif->branch.body = parse_statements();
+		*alt = elif;
+		alt = &elif->branch.alt;
 	}
 
 	if (token.type == TOK_ELSE) {
 		DBG_start("<else>");
 		get_token(&token);
 		expect(TOK_COLON);
-		parse_statements();
+		*alt = parse_statements();
 		DBG_end("</else>");
 	}
 
-	gen_label(l3);
-
 	expect(TOK_END);
 
 	DBG_end("</if>");
+
+	return node;
 }
 
 /**
  * input = "input" "(" id [index] ")" -$
  */
-void parse_input(void)
+AstNode *parse_input(void)
 {
 	DBG_start("<input>");
 
 	char *id;
+	unsigned int sym;
 	IDPropt *prop;
 	SourcePos pos;
+	AstNode *node, *target;
 
+	node = ast_node(AST_INPUT, position);
 	expect(TOK_INPUT);
 	expect(TOK_LPAREN);
 	pos = position;
-	expect_id(&id);
+	expect_id(&id, &sym);
 
-	if (!find_name(id, &prop)) {
+	if (!find_name(sym, &prop)) {
 		position = pos;
-		//abort_c(ERR_UNKNOWN_IDENTIFIER, id);
+		abort_c(ERR_UNKNOWN_IDENTIFIER, id);
 	}
+	target = reference(AST_VAR, id, prop, pos);
 
 	if (token.type == TOK_LBRACK) {
 		if (!IS_ARRAY(prop->type)) {
 			position = pos;
 			//abort_c(ERR_NOT_AN_ARRAY, id);
 		}
-		parse_index(id);
+		target->kind = AST_INDEX;
+		SET_BASE_TYPE(target->type);
+		target->ref.index = parse_index(id);
 	} else if (IS_ARRAY(prop->type)) {
 		position = pos;
 		//abort_c(ERR_EXPECTED_SCALAR);
 	}
-
-	if (IS_INTEGER_TYPE(prop->type)) {
-		gen_read(TYPE_INTEGER);
-	} else {
-		gen_read(TYPE_BOOLEAN);
-	} 
-
-	if (IS_ARRAY_TYPE(prop->type)) {
-		gen_1(JVM_IASTORE);
-	} else {
-		gen_2(JVM_ISTORE, prop->offset);
-	}
+	node->assign.target = target;
 
 	expect(TOK_RPAREN);
 
 	DBG_end("</input>");
+
+	return node;
 }
 
 /**
  * output = "output" "(" (string | expr) {".." (string | expr)} ")" -$
  */
-void parse_output(void)
+AstNode *parse_output(void)
 {
-	ValType t1;
 	SourcePos pos;
+	AstNode *node, *item, **tail;
 
 	DBG_start("<output>");
 
+	node = ast_node(AST_OUTPUT, position);
+	tail = &node->unary.expr;
 	pos = position;
 	expect(TOK_OUTPUT);
 	expect(TOK_LPAREN);
 
+	item = NULL;
 	if (token.type == TOK_STR) {
-		gen_print_string(token.string);
+		item = ast_node(AST_STRING, position);
+		item->string = token.string;
 		parse_string();
 	} else if (STARTS_EXPR(token.type)) {
-		parse_expr(&t1);
-		gen_print(t1);
-		if (IS_ARRAY(t1)) {
+		item = parse_expr();
+		if (IS_ARRAY(item->type)) {
 			position = pos;
 			//abort_c(ERR_ILLEGAL_ARRAY_OPERATION, "'output'");
 		}
 	} else {
 		//abort_c(ERR_EXPECTED_EXPRESSION_OR_STRING);
 	}
+	if (item) {
+		*tail = item;
+		tail = &item->next;
+	}
 
 	while (token.type == TOK_DOTDOT) {
 		pos = position;
 		get_token(&token);
+		item = NULL;
 		if (token.type == TOK_STR) {
-			gen_print_string(token.string);
+			item = ast_node(AST_STRING, position);
+			item->string = token.string;
 			parse_string();
 		} else if (STARTS_EXPR(token.type)) {
-			parse_expr(&t1);
-			gen_print(t1);
-			if (IS_ARRAY(t1)) {
+			item = parse_expr();
+			if (IS_ARRAY(item->type)) {
 				position = pos;
 				//abort_c(ERR_ILLEGAL_ARRAY_OPERATION, "'output'");
 			}
 		} else {
 			//abort_c(ERR_EXPECTED_EXPRESSION_OR_STRING);
 		}
+		if (item) {
+			*tail = item;
+			tail = &item->next;
+		}
 	}
 
 	expect(TOK_RPAREN);
 
 	DBG_end("</output>");
+
+	return node;
 }
 
 /**
  * return = "return" [expr] -$
  */
-void parse_return(void)
+AstNode *parse_return(void)
 {
 	ValType t1, t2;
 	SourcePos pos;
+	AstNode *node;
 
 	DBG_start("<return>");
 
 	t1 = 0;
 	pos = position;
+	node = ast_node(AST_RETURN, pos);
 	expect(TOK_RETURN);
 
 	if (IS_PROCEDURE(return_type)) {
@@ -799,12 +1458,8 @@ void parse_return(void)
 			//abort_c(ERR_RETURN_EXPRESSION_NOT_ALLOWED);
 		} else if (IS_FUNCTION(return_type)) {
 			pos = position;
-			parse_expr(&t1);
-			if (IS_ARRAY_TYPE(return_type)) {
-				gen_1(JVM_ARETURN);
-			} else {
-				gen_1(JVM_IRETURN);
-			}
+			node->unary.expr = parse_expr();
+			t1 = node->unary.expr->type;
 			t2 = return_type;
 			SET_RETURN_TYPE(t2);
 			SET_RETURN_TYPE(t1);
@@ -815,68 +1470,65 @@ void parse_return(void)
 		abort_c(ERR_MISSING_RETURN_EXPRESSION);
 	} else if (IS_PROCEDURE(return_type)) {
 		//abort_c(ERR_RETURN_EXPRESSION_NOT_ALLOWED);
-	} else {
-		gen_1(JVM_RETURN);
 	}
 
 	DBG_end("</return>");
+
+	return node;
 }
 
 /**
  * while = "while" expr ":" statements "end" -$
  */
-void parse_while(void)
+AstNode *parse_while(void)
 {
-	ValType t1;
 	SourcePos pos;
-	int l1, l2;
+	AstNode *node;
 
 	DBG_start("<while>");
 
-	l1 = get_label();
-	l2 = get_label();
-
+	node = ast_node(AST_WHILE, position);
 	expect(TOK_WHILE);
 	pos = position;
-	gen_label(l1);
-	parse_expr(&t1);
-	gen_2_label(JVM_IFEQ, l2);
-	chktypes(t1, TYPE_BOOLEAN, &pos, "for 'while' guard");
+	node->branch.cond = parse_expr();
+	chktypes(node->branch.cond->type, TYPE_BOOLEAN, &pos, "for 'while' guard");
 	expect(TOK_COLON);
-	parse_statements();
+	node->branch.body = parse_statements();
 	expect(TOK_END);
-	gen_2_label(JVM_GOTO, l1);
 
-	gen_label(l2);
 	DBG_end("</while>");
+
+	return node;
 }
 
 /**
  * arglist = "(" expr {"," expr} ")" -$
  * @param id
  * 		the id of the function
- * @param idpos
- * 		the position of the id
+ * @param prop
+ * 		the properties of the function, as found by the caller
+ * @return
+ * 		the list of arguments
  */
-void parse_arglist(char *id, SourcePos idpos)
+AstNode *parse_arglist(char *id, IDPropt *prop)
 {
 	ValType t1;
 	unsigned int i;
-	IDPropt *prop;
 	SourcePos pos;
+	AstNode *args, **tail;
 
 	DBG_start("<arglist>");
 
-	if (!find_name(id, &prop)) {
-		position = idpos;
-		//abort_c(ERR_UNKNOWN_IDENTIFIER, id);
-	}
 	i = 0;
+	args = NULL;
+	tail = &args;
 
 	expect(TOK_LPAREN);
 	if (STARTS_EXPR(token.type)) {
 		pos = position;
-		parse_expr(&t1);
+		*tail = parse_expr();
+		t1 = (*tail)->type;
+		tail = &(*tail)->next;
 		if (!IS_ARRAY_TYPE(t1) && !IS_ARRAY_TYPE(prop->params[i])) {
 			if (!((IS_INTEGER_TYPE(t1) && IS_INTEGER_TYPE(prop->params[i])) ||
 			      (IS_BOOLEAN_TYPE(t1) && IS_BOOLEAN_TYPE(prop->params[i])) ||
@@ -897,7 +1549,9 @@ void parse_arglist(char *id, SourcePos idpos)
 			}
 			get_token(&token);
 			pos = position;
-			parse_expr(&t1);
+			*tail = parse_expr();
+			t1 = (*tail)->type;
+			tail = &(*tail)->next;
 			if (!IS_ARRAY_TYPE(t1) && !IS_ARRAY_TYPE(prop->params[i])) {
 				if (!((IS_INTEGER_TYPE(t1) &&
 				       IS_INTEGER_TYPE(prop->params[i])) ||
@@ -922,48 +1576,51 @@ void parse_arglist(char *id, SourcePos idpos)
 	expect(TOK_RPAREN);
 
 	DBG_end("</arglist>");
+
+	return args;
 }
 
 /**
  * index = "[" simple "]" -$
  * @param id
  * 		the id of the array
+ * @return
+ * 		the index expression
  */
-void parse_index(char *id)
+AstNode *parse_index(char *id)
 {
-	ValType t1;
-	IDPropt *prop;
 	SourcePos pos;
+	AstNode *index;
 
 	DBG_start("<index>");
 
-	find_name(id, &prop);
 	expect(TOK_LBRACK);
 	pos = position;
-	if (token.type == TOK_NUM) {
-		gen_2(JVM_ALOAD, prop->offset);
-	}
-	parse_simple(&t1);
-	chktypes(t1, TYPE_INTEGER, &pos, "for array index of '%s'", id);
+	index = parse_simple();
+	chktypes(index->type, TYPE_INTEGER, &pos, "for array index of '%s'", id);
 	expect(TOK_RBRACK);
 
 	DBG_end("</index>");
+
+	return index;
 }
 
 /**
  * expr = simple [relop simple] -$
- * @param t0
- * 		the type of the expression
+ * @return
+ * 		the expression, with its type
  */
-void parse_expr(ValType *t0)
+AstNode *parse_expr(void)
 {
 	ValType t1, t2;
 	TokenType toktype;
 	SourcePos pos;
+	AstNode *node, *right;
 
 	DBG_start("<expr>");
 
-	parse_simple(&t1);
+	node = parse_simple();
+	t1 = node->type;
 	if (IS_RELOP(token.type)) {
 		toktype = token.type;
 
@@ -972,7 +1629,8 @@ void parse_expr(ValType *t0)
 		}
 		pos = position;
 		parse_relop();
-		parse_simple(&t2);
+		right = parse_simple();
+		t2 = right->type;
 
 		if (IS_ARRAY(t2)) {
 			position = pos;
@@ -981,32 +1639,19 @@ void parse_expr(ValType *t0)
 
 		if (toktype == TOK_EQ || toktype == TOK_NE) {
 			chktypes(t1, t2, &pos, "for operator %s", get_token_string(toktype));
-			if (toktype == TOK_EQ) {
-				gen_cmp(JVM_IF_ICMPEQ);
-			} else if (toktype == TOK_NE) {
-				gen_cmp(JVM_IF_ICMPNE);
-			}
 		} else {
 			chktypes(t1, TYPE_INTEGER, &pos, "for operator %s",
 			         get_token_string(toktype));
 			chktypes(t2, TYPE_INTEGER, &pos, "for operator %s",
 			         get_token_string(toktype));
-			if (toktype == TOK_GE) {
-				gen_cmp(JVM_IF_ICMPGE);
-			} else if (toktype == TOK_GT) {
-				gen_cmp(JVM_IF_ICMPGT);
-			} else if (toktype == TOK_LE) {
-				gen_cmp(JVM_IF_ICMPLE);
-			} else if (toktype == TOK_LT) {
-				gen_cmp(JVM_IF_ICMPLT);
-			}
 		}
-		*t0 = TYPE_BOOLEAN;
-	} else {
-		*t0 = t1;
+		node = binary(toktype, node, right, pos);
+		node->type = TYPE_BOOLEAN;
 	}
 
 	DBG_end("</expr>");
+
+	return node;
 }
 
 /**
@@ -1019,72 +1664,72 @@ void parse_relop(void)
 
 /**
  * simple = ["-"] term {addop term}
- * @param t0
- * 		the type of the expression
+ * @return
+ * 		the expression, with its type
  */
-void parse_simple(ValType *t0)
+AstNode *parse_simple(void)
 {
-	ValType t1;
 	SourcePos pos, pos2;
 	TokenType toktype;
+	AstNode *node, *right;
 
 	DBG_start("<simple>");
 
-	t1 = 0;
 	if (token.type == TOK_MINUS) {
 		pos = position;
 		get_token(&token);
 		pos2 = pos;
-		parse_term(t0);
-		gen_1(JVM_INEG);
-		if (IS_ARRAY(*t0)) {
+		node = unary(TOK_MINUS, parse_term(), pos);
+		if (IS_ARRAY(node->unary.expr->type)) {
 			position = pos;
 			//abort_c(ERR_ILLEGAL_ARRAY_OPERATION, "unary minus");
 		}
-		pos = position;
 		pos2.col++;
-		chktypes(*t0, TYPE_INTEGER, &pos2, "for unary minus");
+		chktypes(node->unary.expr->type, TYPE_INTEGER, &pos2,
+		         "for unary minus");
+		node->type = TYPE_INTEGER;
 	} else {
-		parse_term(t0);
+		node = parse_term();
 		if (IS_ADDOP(token.type)) {
-			if (IS_ARRAY(*t0)) {
+			if (IS_ARRAY(node->type)) {
 				//abort_c(ERR_ILLEGAL_ARRAY_OPERATION,get_token_string(token.type));
 			}
 		}
+	}
 
-		while (IS_ADDOP(token.type)) {
-			toktype = token.type;
-			pos = position;
-			get_token(&token);
-			parse_term(&t1);
-			if (IS_ARRAY(t1)) {
-				position = pos;
-				//abort_c(ERR_ILLEGAL_ARRAY_OPERATION, get_token_string(toktype));
-			}
-			if (toktype == TOK_OR) {
-				chktypes(*t0, TYPE_BOOLEAN, &pos, "for operator %s",
+	while (IS_ADDOP(token.type)) {
+		toktype = token.type;
+		pos = position;
+		get_token(&token);
+		right = parse_term();
+		if (IS_ARRAY(right->type)) {
+			position = pos;
+			//abort_c(ERR_ILLEGAL_ARRAY_OPERATION, get_token_string(toktype));
+		}
+		if (toktype == TOK_OR) {
+			chktypes(node->type, TYPE_BOOLEAN, &pos, "for operator %s",
+			         get_token_string(toktype));
+			chktypes(right->type, TYPE_BOOLEAN, &pos, "for operator %s",
+			         get_token_string(toktype));
+			node = binary(toktype, node, right, pos);
+			node->type = TYPE_BOOLEAN;
+		} else {
+			if (!IS_INTEGER_TYPE(node->type)) {
+				chktypes(node->type, TYPE_INTEGER, &pos, "for operator %s",
 				         get_token_string(toktype));
-				chktypes(t1, TYPE_BOOLEAN, &pos, "for operator %s",
+			}
+			if (!IS_INTEGER_TYPE(right->type)) {
+				chktypes(right->type, TYPE_INTEGER, &pos, "for operator %s",
 				         get_token_string(toktype));
-				gen_1(JVM_IOR);
-			} else {
-				if (!IS_INTEGER_TYPE(*t0)) {
-					chktypes(*t0, TYPE_INTEGER, &pos, "for operator %s",
-					         get_token_string(toktype));
-				}
-				if (!IS_INTEGER_TYPE(t1)) {
-					chktypes(t1, TYPE_INTEGER, &pos, "for operator %s",
-					         get_token_string(toktype));
-				}
-				if (toktype == TOK_PLUS) {
-					gen_1(JVM_IADD);
-				} else if (toktype == TOK_MINUS) {
-					gen_1(JVM_ISUB);
-				}
 			}
+			node = binary(toktype, node, right, pos);
+			node->type = TYPE_INTEGER;
 		}
 	}
+
 	DBG_end("</simple>");
+
+	return node;
 }
 
 /**
@@ -1101,20 +1746,20 @@ void parse_addop(void)
 
 /**
  * term = factor {mulop factor} -$ ?
- * @param t0
- * 		the type of the expression
+ * @return
+ * 		the expression, with its type
  */
-void parse_term(ValType *t0)
+AstNode *parse_term(void)
 {
-	ValType t1;
 	SourcePos pos;
 	TokenType toktype;
+	AstNode *node, *right;
 
 	DBG_start("<term>");
 
-	parse_factor(t0);
+	node = parse_factor();
 	if (IS_MULOP(token.type)) {
-		if (IS_ARRAY(*t0)) {
+		if (IS_ARRAY(node->type)) {
 			//abort_c(ERR_ILLEGAL_ARRAY_OPERATION, get_token_string(token.type));
 		}
 	}
@@ -1123,34 +1768,32 @@ void parse_term(ValType *t0)
 		toktype = token.type;
 		pos = position;
 		parse_mulop();
-		parse_factor(&t1);
+		right = parse_factor();
 
-		if (IS_ARRAY(t1)) {
+		if (IS_ARRAY(right->type)) {
 			position = pos;
 			//abort_c(ERR_ILLEGAL_ARRAY_OPERATION, get_token_string(toktype));
 		}
 		if (toktype == TOK_AND) {
-			chktypes(*t0, TYPE_BOOLEAN, &pos, "for operator %s",
+			chktypes(node->type, TYPE_BOOLEAN, &pos, "for operator %s",
 			         get_token_string(toktype));
-			chktypes(t1, TYPE_BOOLEAN, &pos, "for operator %s",
+			chktypes(right->type, TYPE_BOOLEAN, &pos, "for operator %s",
 			         get_token_string(toktype));
-			gen_1(JVM_IAND);
+			node = binary(toktype, node, right, pos);
+			node->type = TYPE_BOOLEAN;
 		} else {
-			chktypes(*t0, TYPE_INTEGER, &pos, "for operator %s",
+			chktypes(node->type, TYPE_INTEGER, &pos, "for operator %s",
 			         get_token_string(toktype));
-			chktypes(t1, TYPE_INTEGER, &pos, "for operator %s",
+			chktypes(right->type, TYPE_INTEGER, &pos, "for operator %s",
 			         get_token_string(toktype));
-			if (toktype == TOK_MUL) {
-				gen_1(JVM_IMUL);
-			} else if (toktype == TOK_DIV) {
-				gen_1(JVM_IDIV);
-			} else if (toktype == TOK_REM) {
-				gen_1(JVM_IREM);
-			}
+			node = binary(toktype, node, right, pos);
+			node->type = TYPE_INTEGER;
 		}
 	}
 
 	DBG_end("</term>");
+
+	return node;
 }
 
 /**
@@ -1164,26 +1807,29 @@ void parse_mulop(void)
 /**
  * factor = id [index | arglist] | num | "(" expr ")" | "not" factor
  * 			| "true" | "false" --$
- * @param t0
- * 		the type of the expression
+ * @return
+ * 		the expression, with its type
  */
-void parse_factor(ValType *t0)
+AstNode *parse_factor(void)
 {
 	char *id;
+	unsigned int sym;
 	IDPropt *prop;
 	SourcePos pos, pos_not;
+	AstNode *node;
 
 	DBG_start("<factor>");
 
 	id = NULL;
+	node = NULL;
 
 	switch (token.type) {
 		case TOK_ID:
 			pos = position;
-			expect_id(&id);
-			if (!find_name(id, &prop)) {
+			expect_id(&id, &sym);
+			if (!find_name(sym, &prop)) {
 				position = pos;
-				//abort_c(ERR_UNKNOWN_IDENTIFIER, id);
+				abort_c(ERR_UNKNOWN_IDENTIFIER, id);
 			}
 
 			if (token.type == TOK_LBRACK) {
@@ -1191,57 +1837,54 @@ void parse_factor(ValType *t0)
 					position = pos;
 					//abort_c(ERR_NOT_AN_ARRAY, id);
 				}
-				*t0 = prop->type & 6;
-				parse_index(id);
-				gen_1(JVM_IALOAD);
+				node = reference(AST_INDEX, id, prop, pos);
+				node->type = prop->type & 6;
+				node->ref.index = parse_index(id);
 			} else if (token.type == TOK_LPAREN) {
 				if (!IS_FUNCTION(prop->type)) {
 					position = pos;
 					//abort_c(ERR_NOT_A_FUNCTION, id);
 				}
-				*t0 = (prop->type & 6) ^ TYPE_CALLABLE;
-				parse_arglist(id, pos);
-				gen_call(id,prop);
+				node = reference(AST_CALL, id, prop, pos);
+				SET_RETURN_TYPE(node->type);
+				node->ref.args = parse_arglist(id, prop);
 			} else {
-				*t0 = prop->type;
-				if (IS_ARRAY_TYPE(*t0)) {
-					gen_2(JVM_ALOAD, prop->offset);
-				} else {
-					gen_2(JVM_ILOAD, prop->offset);
-				}
+				node = reference(AST_VAR, id, prop, pos);
 			}
 			break;
 		case TOK_NUM:
-			gen_2(JVM_LDC, token.value);
-			*t0 = TYPE_INTEGER;
+			node = ast_node(AST_NUM, position);
+			node->value = token.value;
+			node->type = TYPE_INTEGER;
 			get_token(&token);
 			break;
 		case TOK_LPAREN:
 			expect(TOK_LPAREN);
-			parse_expr(t0);
+			node = parse_expr();
 			expect(TOK_RPAREN);
 			break;
 		case TOK_NOT:
 			pos_not = position;
 			expect(TOK_NOT);
 			pos = position;
-			parse_factor(t0);
-			if (IS_ARRAY_TYPE(*t0)) {
+			node = unary(TOK_NOT, parse_factor(), pos_not);
+			if (IS_ARRAY_TYPE(node->unary.expr->type)) {
 				position = pos_not;
 				//abort_c(ERR_ILLEGAL_ARRAY_OPERATION, "'not'");
 			}
-			chktypes(*t0, TYPE_BOOLEAN, &pos, "for 'not'");
-			gen_2(JVM_LDC, 1);
-			gen_1(JVM_IXOR);
+			chktypes(node->unary.expr->type, TYPE_BOOLEAN, &pos, "for 'not'");
+			node->type = TYPE_BOOLEAN;
 			break;
 		case TOK_TRUE:
-			gen_2(JVM_LDC, 1);
-			*t0 = TYPE_BOOLEAN;
+			node = ast_node(AST_BOOL, position);
+			node->value = TRUE;
+			node->type = TYPE_BOOLEAN;
 			expect(TOK_TRUE);
 			break;
 		case TOK_FALSE:
-			gen_2(JVM_LDC, 0);
-			*t0 = TYPE_BOOLEAN;
+			node = ast_node(AST_BOOL, position);
+			node->value = FALSE;
+			node->type = TYPE_BOOLEAN;
 			expect(TOK_FALSE);
 			break;
 		default:
@@ -1249,6 +1892,8 @@ void parse_factor(ValType *t0)
 	}
 
 	DBG_end("</factor>");
+
+	return node;
 }
 
 /**
@@ -1326,11 +1971,15 @@ void expect(TokenType type)
  *
  * @param[in] char **id
  * 			pointer to the pointer of the id to be inspected
+ * @param[in] unsigned int *sym
+ * 			pointer to the number of the id, as the scanner interned it
  */
-void expect_id(char **id)
+void expect_id(char **id, unsigned int *sym)
 {
 	if (token.type == TOK_ID) {
-		*id = estrdup(token.lexeme);
+		/* the interned name lasts as long as the compilation */
+		*id = (char *) get_name(token.sym);
+		*sym = token.sym;
 		get_token(&token);
 	} else {
 		abort_c(ERR_EXPECT, TOK_ID);
@@ -1362,7 +2011,7 @@ IDPropt *idpropt(ValType type,
                  unsigned int nparams,
                  ValType *params)
 {
-	IDPropt *ip = emalloc(sizeof(*ip));
+	IDPropt *ip = unit_alloc(sizeof(*ip));
 
 	ip->type = type;
 	ip->offset = offset;
@@ -1377,6 +2026,8 @@ IDPropt *idpropt(ValType type,
  *
  * @param[in] char *id
  * 			The id of the Variable
+ * @param[in] unsigned int sym
+ * 			The number of the id
  * @param[in] ValType type
  * 			The type of the Variable
  * @param[in] SourcePos pos
@@ -1385,11 +2036,12 @@ IDPropt *idpropt(ValType type,
  * @return
  * 		A pointer to the new Variable
  */
-Variable *variable(char *id, ValType type, SourcePos pos)
+Variable *variable(char *id, unsigned int sym, ValType type, SourcePos pos)
 {
-	Variable *vp = emalloc(sizeof(*vp));
+	Variable *vp = unit_alloc(sizeof(*vp));
 
 	vp->id = id;
+	vp->sym = sym;
 	vp->type = type;
 	vp->pos = pos;
 	vp->next = NULL;
@@ -1398,12 +2050,88 @@ Variable *variable(char *id, ValType type, SourcePos pos)
 }
 #endif
 
+/**
+ * Creates a new node that refers to an identifier: a variable definition, a
+ * variable or array element, or a call
+ *
+ * @param[in] AstKind kind
+ * 			The kind of node
+ * @param[in] char *id
+ * 			The identifier, which is not copied
+ * @param[in] IDPropt *prop
+ * 			The properties of the identifier, which are copied
+ * @param[in] SourcePos pos
+ * 			The position of the identifier
+ *
+ * @return
+ * 		A pointer to the new node, with the type of the identifier
+ */
+AstNode *reference(AstKind kind, char *id, IDPropt *prop, SourcePos pos)
+{
+	AstNode *np = ast_node(kind, pos);
+
+	np->ref.id = id;
+	np->ref.prop = *prop;
+	np->type = prop->type;
+
+	return np;
+}
+
+/**
+ * Creates a new binary operator node
+ *
+ * @param[in] TokenType op
+ * 			The operator
+ * @param[in] AstNode *left
+ * 			The left operand
+ * @param[in] AstNode *right
+ * 			The right operand
+ * @param[in] SourcePos pos
+ * 			The position of the operator
+ *
+ * @return
+ * 		A pointer to the new node
+ */
+AstNode *binary(TokenType op, AstNode *left, AstNode *right, SourcePos pos)
+{
+	AstNode *np = ast_node(AST_BINARY, pos);
+
+	np->binary.op = op;
+	np->binary.left = left;
+	np->binary.right = right;
+
+	return np;
+}
+
+/**
+ * Creates a new unary operator node
+ *
+ * @param[in] TokenType op
+ * 			The operator, either unary minus or "not"
+ * @param[in] AstNode *expr
+ * 			The operand
+ * @param[in] SourcePos pos
+ * 			The position of the operator
+ *
+ * @return
+ * 		A pointer to the new node
+ */
+AstNode *unary(TokenType op, AstNode *expr, SourcePos pos)
+{
+	AstNode *np = ast_node(AST_UNARY, pos);
+
+	np->unary.op = op;
+	np->unary.expr = expr;
+
+	return np;
+}
+
 /* --- error handling routines --------------------------------------------- */
 
 /**
  * handles all errors for parsing and type checking
  */
-void _abort_cp(SourcePos *posp, Error err, va_list args)
+_Noreturn void _abort_cp(SourcePos *posp, Error err, va_list args)
 {
 	char expstr[MAX_MSG_LEN], *s;
 	int t;
@@ -1440,6 +2168,7 @@ void _abort_cp(SourcePos *posp, Error err, va_list args)
 			break;
 		default:
 			err = ERR_UNREACHABLE;
+			s = "unknown error";
 	}
 
 	switch (err) {
@@ -1518,7 +2247,7 @@ void _abort_cp(SourcePos *posp, Error err, va_list args)
 /**
  * handles errors
  */
-void abort_c(Error err, ...)
+_Noreturn void abort_c(Error err, ...)
 {
 	va_list args;
 
@@ -1530,7 +2259,7 @@ void abort_c(Error err, ...)
 /**
  * handles errors and appends position
  */
-void abort_cp(SourcePos *posp, Error err, ...)
+_Noreturn void abort_cp(SourcePos *posp, Error err, ...)
 {
 	va_list args;
 
@@ -1543,7 +2272,7 @@ void abort_cp(SourcePos *posp, Error err, ...)
 
 #ifdef DEBUG_PARSER
 
-static int indent = 0;
+static _Thread_local int indent = 0;
 
 void _debug_info(const char *fmt, va_list args)
 {
@@ -1593,4 +2322,10 @@ void debug_info(const char *fmt, ...)
 	va_end(args);
 }
 
+/* a compilation that fails leaves the indentation where it failed */
+void debug_reset(void)
+{
+	indent = 0;
+}
+
 #endif /* DEBUG_PARSER */
@@ -0,0 +1,194 @@
+/**
+ * @file    amplclient.c
+ *
+ * A thin client for the AMPL-2023 compile server (amplc --server).  It sends
+ * one compile request for a source file, or for source text read from standard
+ * input, and reports the reply as amplc would have: the diagnostics go to
+ * standard error, and the exit status is that of the compilation.  The paths of
+ * the files produced are written to standard output.  The path of the socket is
+ * taken from the AMPLC_SERVER environment variable.
+ *
+ * @date    2026-10-16
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "boolean.h"
+#include "error.h"
+
+/* --- type definitions and constants --------------------------------------- */
+
+#define USAGE "usage: %s [--target=jvm | --target=x86_64] [--jasmin]" \
+	" <filename | ->\n       %s --shutdown"
+
+#define STDIN_NAME      "<stdin>"
+#define READ_CHUNK_SIZE (65536)
+
+/* --- function prototypes -------------------------------------------------- */
+
+static int connect_server(void);
+static char *read_all(FILE *in, size_t *len);
+static int read_reply(FILE *in);
+
+/* --- main routine --------------------------------------------------------- */
+
+int main(int argc, char *argv[])
+{
+	int i, fd, status;
+	char *src_name, *source, cwd[PATH_MAX];
+	size_t len;
+	Boolean shutdown;
+	FILE *in, *out;
+
+	setprogname(argv[0]);
+
+	src_name = NULL;
+	shutdown = FALSE;
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--shutdown") == 0) {
+			shutdown = TRUE;
+		} else if (strcmp(argv[i], "--jasmin") == 0
+				|| strcmp(argv[i], "--target=jvm") == 0
+				|| strcmp(argv[i], "--target=x86_64") == 0) {
+			/* passed on as is */
+		} else if ((argv[i][0] == '-' && argv[i][1] != '\0')
+				|| src_name != NULL) {
+			eprintf(USAGE, getprogname(), getprogname());
+		} else {
+			src_name = argv[i];
+		}
+	}
+	if ((src_name == NULL) == !shutdown) {
+		eprintf(USAGE, getprogname(), getprogname());
+	}
+
+	fd = connect_server();
+	if ((in = fdopen(fd, "r")) == NULL
+			|| (out = fdopen(dup(fd), "w")) == NULL) {
+		eprintf("Could not set up connection:");
+	}
+
+	/* send the request */
+	if (shutdown) {
+		fprintf(out, "shutdown\n");
+		fclose(out);
+		fclose(in);
+		freeprogname();
+		return EXIT_SUCCESS;
+	}
+	if (getcwd(cwd, sizeof(cwd)) == NULL) {
+		eprintf("Could not get the working directory:");
+	}
+	fprintf(out, "cwd %s\n", cwd);
+	for (i = 1; i < argc; i++) {
+		if (argv[i][0] == '-' && argv[i][1] != '\0') {
+			fprintf(out, "option %s\n", argv[i]);
+		}
+	}
+	if (strcmp(src_name, "-") == 0) {
+		source = read_all(stdin, &len);
+		fprintf(out, "source %lu %s\n", (unsigned long) len, STDIN_NAME);
+		fwrite(source, 1, len, out);
+		free(source);
+	} else {
+		fprintf(out, "file %s\n", src_name);
+	}
+	if (fflush(out) != 0) {
+		eprintf("Could not send request:");
+	}
+
+	status = read_reply(in);
+
+	fclose(out);
+	fclose(in);
+	freeprogname();
+
+	return status;
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+/**
+ * Connects to the server at the socket named by the environment.
+ */
+static int connect_server(void)
+{
+	int fd;
+	char *path;
+	struct sockaddr_un addr;
+
+	if ((path = getenv("AMPLC_SERVER")) == NULL) {
+		eprintf("AMPLC_SERVER environment variable not set");
+	}
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		eprintf("Socket path too long: '%s'", path);
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+
+	if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+		eprintf("Could not create socket:");
+	}
+	if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+		eprintf("Could not connect to server at '%s':", path);
+	}
+
+	return fd;
+}
+
+/**
+ * Reads a stream to its end into newly allocated memory.
+ */
+static char *read_all(FILE *in, size_t *len)
+{
+	char *buf;
+	size_t size;
+
+	size = READ_CHUNK_SIZE;
+	*len = 0;
+	buf = emalloc(size);
+	while (!feof(in)) {
+		if (*len == size) {
+			size *= 2;
+			buf = erealloc(buf, size);
+		}
+		*len += fread(buf + *len, 1, size - *len, in);
+		if (ferror(in)) {
+			eprintf("Could not read source text:");
+		}
+	}
+
+	return buf;
+}
+
+/**
+ * Reads the reply, reports it, and returns the exit status that it carries.
+ */
+static int read_reply(FILE *in)
+{
+	int status, c;
+	long n;
+	char line[PATH_MAX + 16], *p;
+
+	if (fscanf(in, "status %d\n", &status) != 1) {
+		eprintf("Malformed reply from server");
+	}
+	while ((p = fgets(line, sizeof(line), in)) != NULL
+			&& strncmp(line, "output ", 7) == 0) {
+		fputs(line + 7, stdout);
+	}
+	if (p == NULL || sscanf(line, "diagnostics %ld", &n) != 1) {
+		eprintf("Malformed reply from server");
+	}
+	while (n-- > 0 && (c = getc(in)) != EOF) {
+		putc(c, stderr);
+	}
+
+	return status;
+}
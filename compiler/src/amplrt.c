@@ -0,0 +1,196 @@
+/**
+ * @file    amplrt.c
+ * @brief   The runtime for AMPL-2023 programs compiled for the x86-64 target:
+ *          input, output, array allocation, and exceptions.
+ *
+ * The functions behave like the runtime support code of the JVM target.
+ * Output is fully buffered and flushed at exit.  Input is read token by token:
+ * white space is every byte up to and including the space character, an
+ * integer is an optional sign followed by decimal digits, and a Boolean is
+ * "true" or "false" in any case.  A malformed token is an input mismatch, and
+ * reading past the end of the input is an error of its own.  An exception is
+ * reported with the name of the JVM exception class, and terminates the program
+ * with exit status 1, as an uncaught exception does on the JVM.
+ *
+ * @date    2026-10-16
+ */
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define OUTPUT_BUFFER_SIZE 65536
+
+#define INPUT_MISMATCH  "java/util/InputMismatchException"
+#define NO_SUCH_ELEMENT "java/util/NoSuchElementException"
+#define NEGATIVE_SIZE   "java/lang/NegativeArraySizeException"
+#define OUT_OF_MEMORY   "java/lang/OutOfMemoryError"
+#define NULL_POINTER    "java/lang/NullPointerException"
+
+/* --- function prototypes -------------------------------------------------- */
+
+/* called by the generated code */
+void ampl_main(void);
+void ampl_rt_print_int(int32_t value);
+void ampl_rt_print_bool(int32_t value);
+void ampl_rt_print_string(const char *s);
+int32_t ampl_rt_read_int(void);
+int32_t ampl_rt_read_bool(void);
+int32_t *ampl_rt_new_array(int64_t size);
+void ampl_rt_throw(const char *exception);
+void ampl_rt_null_pointer(void);
+
+static int skip_space(void);
+static int read_word(const char *word);
+
+/* --- main routine --------------------------------------------------------- */
+
+int main(void)
+{
+	static char buffer[OUTPUT_BUFFER_SIZE];
+
+	setvbuf(stdout, buffer, _IOFBF, sizeof(buffer));
+	ampl_main();
+	fflush(stdout);
+
+	return EXIT_SUCCESS;
+}
+
+/* --- runtime interface ---------------------------------------------------- */
+
+void ampl_rt_print_int(int32_t value)
+{
+	printf("%d", (int) value);
+}
+
+void ampl_rt_print_bool(int32_t value)
+{
+	fputs(value ? "true" : "false", stdout);
+}
+
+void ampl_rt_print_string(const char *s)
+{
+	fputs(s, stdout);
+}
+
+/**
+ * Reads an integer, accumulated as a negative number against a limit, so that
+ * the minimum integer can be read and overflow is caught.
+ */
+int32_t ampl_rt_read_int(void)
+{
+	int c, negative, d;
+	int32_t n, limit;
+
+	c = skip_space();
+	negative = (c == '-');
+	limit = (negative ? INT32_MIN : -INT32_MAX);
+	if (c == '-' || c == '+') {
+		c = getchar();
+	}
+	if (c < '0' || c > '9') {
+		ampl_rt_throw(INPUT_MISMATCH);
+	}
+
+	n = 0;
+	do {
+		d = c - '0';
+		if (n < limit / 10 || n * 10 < limit + d) {
+			ampl_rt_throw(INPUT_MISMATCH);
+		}
+		n = n * 10 - d;
+		c = getchar();
+	} while (c >= '0' && c <= '9');
+
+	if (c > ' ') {
+		ampl_rt_throw(INPUT_MISMATCH);
+	}
+
+	return (negative ? n : -n);
+}
+
+int32_t ampl_rt_read_bool(void)
+{
+	int c;
+
+	c = skip_space() | ('a' - 'A');
+	if (c == 't' && read_word("true")) {
+		return 1;
+	} else if (c == 'f' && read_word("false")) {
+		return 0;
+	}
+	ampl_rt_throw(INPUT_MISMATCH);
+	return 0;
+}
+
+int32_t *ampl_rt_new_array(int64_t size)
+{
+	int64_t *array;
+
+	if (size < 0) {
+		ampl_rt_throw(NEGATIVE_SIZE);
+	}
+	if ((array = calloc(1, sizeof(int64_t) + size * sizeof(int32_t))) == NULL) {
+		ampl_rt_throw(OUT_OF_MEMORY);
+	}
+	array[0] = size;
+
+	return (int32_t *) (array + 1);
+}
+
+void ampl_rt_throw(const char *exception)
+{
+	const char *p;
+
+	fflush(stdout);
+	fputs("Exception in thread \"main\" ", stderr);
+	for (p = exception; *p; p++) {
+		fputc(*p == '/' ? '.' : *p, stderr);
+	}
+	fputc('\n', stderr);
+
+	exit(EXIT_FAILURE);
+}
+
+/** An array variable that was never allocated holds a null reference. */
+void ampl_rt_null_pointer(void)
+{
+	ampl_rt_throw(NULL_POINTER);
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+/**
+ * Skips white space, and returns the first byte of the next token.
+ */
+static int skip_space(void)
+{
+	int c;
+
+	while ((c = getchar()) != EOF && c <= ' ')
+		;
+	if (c == EOF) {
+		ampl_rt_throw(NO_SUCH_ELEMENT);
+	}
+
+	return c;
+}
+
+/**
+ * Checks that the rest of the token is the rest of a lower-case word, in any
+ * case.
+ */
+static int read_word(const char *word)
+{
+	int c;
+
+	for (word++; *word; word++) {
+		if ((getchar() | ('a' - 'A')) != *word) {
+			return 0;
+		}
+	}
+	c = getchar();
+
+	return (c == EOF || c <= ' ');
+}
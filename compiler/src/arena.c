@@ -0,0 +1,178 @@
+/**
+ * @file    arena.c
+ * @brief   A bump-pointer arena allocator.
+ *
+ * Space is handed out from large blocks.  When the current block is full, a
+ * new block is chained in front of it; requests that are larger than a block
+ * get a block of their own, chained behind the current block, so that the
+ * space left in the current block is still used.  Individual allocations are
+ * never released; all blocks are freed together by <code>arena_free</code>.
+ *
+ * Each thread also has an arena for the compilation that it runs, so that the
+ * many small, long-lived allocations of the scanner, the parser, the symbol
+ * table, and the code generator need not be tracked, and freed, one by one.
+ *
+ * @date    2026-10-16
+ */
+
+#include "arena.h"
+#include "error.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define BLOCK_SIZE 65536
+
+/** the alignment of every allocation */
+#define ALIGNMENT sizeof(union { long l; double d; void *p; })
+
+/** a block of arena memory; the usable space follows the header */
+typedef struct block Block;
+struct block {
+	Block  *next; /**< the previously filled block */
+	size_t  size; /**< the usable size             */
+	size_t  used; /**< the number of bytes in use  */
+};
+
+/** an arena container */
+struct arena {
+	Block *blocks; /**< the current block, at the head of the chain */
+};
+
+/** the size of the block header, rounded up to keep the space aligned */
+#define HEADER_SIZE ((sizeof(Block) + ALIGNMENT - 1) & ~(ALIGNMENT - 1))
+
+/** the start of the usable space of a block */
+#define BLOCK_DATA(b) ((char *) (b) + HEADER_SIZE)
+
+/* --- global static variables ---------------------------------------------- */
+
+static _Thread_local Arena *unit; /**< the arena of the compilation */
+
+/* --- function prototypes -------------------------------------------------- */
+
+static void *carve(Arena *a, size_t size);
+static Arena *unit_arena(void);
+
+/* --- arena interface ------------------------------------------------------ */
+
+Arena *arena_init(void)
+{
+	Arena *a;
+
+	a = emalloc(sizeof(Arena));
+	a->blocks = NULL;
+
+	return a;
+}
+
+void *arena_alloc(Arena *a, size_t size)
+{
+	void *p;
+
+	p = carve(a, size);
+	memset(p, 0, size);
+
+	return p;
+}
+
+char *arena_strdup(Arena *a, const char *s)
+{
+	size_t n;
+	char *t;
+
+	n = strlen(s) + 1;
+	t = carve(a, n);
+	memcpy(t, s, n);
+
+	return t;
+}
+
+void arena_free(Arena *a)
+{
+	Block *b, *next;
+
+	if (a == NULL) {
+		return;
+	}
+
+	for (b = a->blocks; b; b = next) {
+		next = b->next;
+		free(b);
+	}
+	free(a);
+}
+
+/* --- compilation arena interface ------------------------------------------ */
+
+void *unit_alloc(size_t size)
+{
+	return arena_alloc(unit_arena(), size);
+}
+
+char *unit_strdup(const char *s)
+{
+	return unit_strndup(s, strlen(s));
+}
+
+char *unit_strndup(const char *s, size_t n)
+{
+	char *t;
+
+	t = carve(unit_arena(), n + 1);
+	memcpy(t, s, n);
+	t[n] = '\0';
+
+	return t;
+}
+
+void release_unit_arena(void)
+{
+	arena_free(unit);
+	unit = NULL;
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+/**
+ * Returns uninitialised, aligned space in an arena, for the callers that fill
+ * it at once.
+ */
+static void *carve(Arena *a, size_t size)
+{
+	Block *b;
+	size_t bsize;
+	void *p;
+
+	size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+
+	if ((b = a->blocks) != NULL && b->size - b->used >= size) {
+		p = BLOCK_DATA(b) + b->used;
+		b->used += size;
+		return p;
+	}
+
+	bsize = (size > BLOCK_SIZE ? size : BLOCK_SIZE);
+	b = emalloc(HEADER_SIZE + bsize);
+	b->size = bsize;
+	b->used = size;
+	if (size > BLOCK_SIZE && a->blocks != NULL) {
+		/* full at once, so keep filling the current block */
+		b->next = a->blocks->next;
+		a->blocks->next = b;
+	} else {
+		b->next = a->blocks;
+		a->blocks = b;
+	}
+
+	return BLOCK_DATA(b);
+}
+
+static Arena *unit_arena(void)
+{
+	if (unit == NULL) {
+		unit = arena_init();
+	}
+
+	return unit;
+}
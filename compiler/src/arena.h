@@ -0,0 +1,103 @@
+/**
+ * @file    arena.h
+ * @brief   A bump-pointer arena allocator, for data structures whose parts are
+ *          all released at the same time.
+ * @date    2026-10-16
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/** an arena container */
+typedef struct arena Arena;
+
+/**
+ * Initialise an empty arena.  Memory is only reserved on the first
+ * allocation.
+ *
+ * @return
+ *     a pointer to the new arena
+ */
+Arena *arena_init(void);
+
+/**
+ * Allocate zero-initialised space in the specified arena.  The space is
+ * suitably aligned for any type, and remains valid until the arena is freed.
+ * If memory cannot be allocated, the program terminates.
+ *
+ * @param[in]  a
+ *     a pointer to the arena
+ * @param[in]  size
+ *     the number of bytes to allocate
+ * @return
+ *     a pointer to the allocated space
+ */
+void *arena_alloc(Arena *a, size_t size);
+
+/**
+ * Copy a string into the specified arena.
+ *
+ * @param[in]  a
+ *     a pointer to the arena
+ * @param[in]  s
+ *     the string to copy
+ * @return
+ *     a pointer to the copy
+ */
+char *arena_strdup(Arena *a, const char *s);
+
+/**
+ * Release the specified arena, and all the space allocated in it.
+ *
+ * @param[in]  a
+ *     a pointer to the arena
+ */
+void arena_free(Arena *a);
+
+/**
+ * Allocate zero-initialised space in the arena of the compilation on the
+ * calling thread.  The identifiers, strings, symbol table properties, syntax
+ * tree, and the code references of a compilation all live here, and are
+ * released together by <code>release_unit_arena</code> once it is done.  The
+ * arena is created on the first allocation.
+ *
+ * @param[in]  size
+ *     the number of bytes to allocate
+ * @return
+ *     a pointer to the allocated space
+ */
+void *unit_alloc(size_t size);
+
+/**
+ * Copy a string into the arena of the compilation on the calling thread.
+ *
+ * @param[in]  s
+ *     the string to copy
+ * @return
+ *     a pointer to the copy
+ */
+char *unit_strdup(const char *s);
+
+/**
+ * Copy the first <code>n</code> characters of a string, which need not be
+ * terminated, into the arena of the compilation on the calling thread, and
+ * terminate the copy.
+ *
+ * @param[in]  s
+ *     the characters to copy
+ * @param[in]  n
+ *     the number of characters to copy
+ * @return
+ *     a pointer to the copy
+ */
+char *unit_strndup(const char *s, size_t n);
+
+/**
+ * Release the arena of the compilation on the calling thread, and everything
+ * allocated in it.
+ */
+void release_unit_arena(void);
+
+#endif /* ARENA_H */
@@ -0,0 +1,156 @@
+/**
+ * @file    ast.c
+ * @brief   Construction and dumping of the abstract syntax tree for AMPL-2023.
+ * @date    2026-10-16
+ */
+
+#include "ast.h"
+#include "arena.h"
+
+#include <assert.h>
+
+/* --- function prototypes -------------------------------------------------- */
+
+static void dump_node(FILE *out, AstNode *node, int depth);
+static void dump_list(FILE *out, const char *label, AstNode *list, int depth);
+static void dump_ref(FILE *out, AstNode *node);
+
+/* --- syntax tree interface ------------------------------------------------ */
+
+AstNode *ast_node(AstKind kind, SourcePos pos)
+{
+	AstNode *node;
+
+	node = unit_alloc(sizeof(AstNode));
+	node->kind = kind;
+	node->pos = pos;
+
+	return node;
+}
+
+void dump_ast(FILE *out, AstNode *node)
+{
+	dump_node(out, node, 0);
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+static void dump_node(FILE *out, AstNode *node, int depth)
+{
+	fprintf(out, "%*s", 2 * depth, "");
+
+	switch (node->kind) {
+		case AST_PROGRAM:
+			fprintf(out, "program %s\n", node->program.name);
+			dump_list(out, NULL, node->program.subdefs, depth + 1);
+			dump_node(out, node->program.main, depth + 1);
+			break;
+		case AST_SUBDEF:
+			fprintf(out, "subdef %s", node->subdef.name);
+			if (node->subdef.prop.type != TYPE_NONE) {
+				fprintf(out, " : %s",
+				        get_valtype_string(node->subdef.prop.type));
+			}
+			fprintf(out, " [width %u]\n", node->subdef.width);
+			dump_list(out, "params", node->subdef.params, depth + 1);
+			dump_list(out, "vars", node->subdef.vars, depth + 1);
+			dump_list(out, "body", node->subdef.body, depth + 1);
+			break;
+		case AST_VARDEF:
+			fprintf(out, "vardef ");
+			dump_ref(out, node);
+			fprintf(out, "\n");
+			break;
+		case AST_ASSIGN:
+		case AST_ALLOC:
+		case AST_INPUT:
+			fprintf(out, "%s\n", node->kind == AST_ASSIGN ? "assign"
+			                     : node->kind == AST_ALLOC ? "alloc" : "input");
+			dump_node(out, node->assign.target, depth + 1);
+			if (node->assign.expr) {
+				dump_node(out, node->assign.expr, depth + 1);
+			}
+			break;
+		case AST_CALL:
+			fprintf(out, "call ");
+			dump_ref(out, node);
+			fprintf(out, "\n");
+			dump_list(out, NULL, node->ref.args, depth + 1);
+			break;
+		case AST_IF:
+		case AST_WHILE:
+			fprintf(out, "%s\n", node->kind == AST_IF ? "if" : "while");
+			dump_node(out, node->branch.cond, depth + 1);
+			dump_list(out, "then", node->branch.body, depth + 1);
+			dump_list(out, "else", node->branch.alt, depth + 1);
+			break;
+		case AST_OUTPUT:
+			fprintf(out, "output\n");
+			dump_list(out, NULL, node->unary.expr, depth + 1);
+			break;
+		case AST_RETURN:
+			fprintf(out, "return\n");
+			if (node->unary.expr) {
+				dump_node(out, node->unary.expr, depth + 1);
+			}
+			break;
+		case AST_STRING:
+			fprintf(out, "string \"%s\"\n", node->string);
+			break;
+		case AST_BINARY:
+			fprintf(out, "%s : %s\n", get_token_string(node->binary.op),
+			        get_valtype_string(node->type));
+			dump_node(out, node->binary.left, depth + 1);
+			dump_node(out, node->binary.right, depth + 1);
+			break;
+		case AST_UNARY:
+			fprintf(out, "%s : %s\n", get_token_string(node->unary.op),
+			        get_valtype_string(node->type));
+			dump_node(out, node->unary.expr, depth + 1);
+			break;
+		case AST_NUM:
+			fprintf(out, "num %d\n", node->value);
+			break;
+		case AST_BOOL:
+			fprintf(out, "bool %s\n", node->value ? "true" : "false");
+			break;
+		case AST_VAR:
+			fprintf(out, "var ");
+			dump_ref(out, node);
+			fprintf(out, "\n");
+			break;
+		case AST_INDEX:
+			fprintf(out, "index ");
+			dump_ref(out, node);
+			fprintf(out, "\n");
+			dump_node(out, node->ref.index, depth + 1);
+			break;
+		default:
+			assert(FALSE);
+	}
+}
+
+static void dump_list(FILE *out, const char *label, AstNode *list, int depth)
+{
+	if (list == NULL) {
+		return;
+	}
+	if (label) {
+		fprintf(out, "%*s%s\n", 2 * depth, "", label);
+		depth++;
+	}
+	for (; list; list = list->next) {
+		dump_node(out, list, depth);
+	}
+}
+
+static void dump_ref(FILE *out, AstNode *node)
+{
+	ValType type;
+
+	type = (node->kind == AST_CALL ? node->ref.prop.type : node->type);
+	fprintf(out, "%s : %s", node->ref.id, get_valtype_string(type));
+	if (IS_VARIABLE(node->ref.prop.type)) {
+		fprintf(out, " @%u", node->ref.prop.offset);
+	}
+}
@@ -0,0 +1,131 @@
+/**
+ * @file    ast.h
+ * @brief   The abstract syntax tree for AMPL-2023, built by the parser and
+ *          lowered to JVM code in a separate pass.
+ *
+ * All nodes and the identifiers and strings they refer to are allocated in the
+ * arena of the compilation, and are released together with it by
+ * <code>release_unit_arena</code>.  Lists (of subroutines, variable
+ * definitions, statements, arguments, and output items) are linked through the
+ * <code>next</code> field of their nodes.
+ *
+ * @date    2026-10-16
+ */
+
+#ifndef AST_H
+#define AST_H
+
+#include <stdio.h>
+
+#include "error.h"
+#include "symboltable.h"
+#include "token.h"
+#include "valtypes.h"
+
+/** the kinds of nodes, one for each production that carries meaning */
+typedef enum {
+	AST_PROGRAM, /**< program: the class name, subroutines, and main     */
+	AST_SUBDEF,  /**< subdef, or the body of main                         */
+	AST_VARDEF,  /**< a parameter or a variable definition                */
+	AST_ASSIGN,  /**< assign, with an expression                          */
+	AST_ALLOC,   /**< assign, with an array allocation                    */
+	AST_CALL,    /**< call, or a function call in a factor                */
+	AST_IF,      /**< if; an elif is an if in the alternative             */
+	AST_INPUT,   /**< input                                               */
+	AST_OUTPUT,  /**< output                                              */
+	AST_RETURN,  /**< return                                              */
+	AST_WHILE,   /**< while                                               */
+	AST_STRING,  /**< a string in an output statement                     */
+	AST_BINARY,  /**< expr, simple, or term with a binary operator        */
+	AST_UNARY,   /**< unary minus in simple, or "not" in a factor         */
+	AST_NUM,     /**< a number literal                                    */
+	AST_BOOL,    /**< "true" or "false"                                   */
+	AST_VAR,     /**< a variable reference                                */
+	AST_INDEX    /**< an array element reference                          */
+} AstKind;
+
+/** a node in the abstract syntax tree */
+typedef struct ast_node AstNode;
+struct ast_node {
+	AstKind    kind;     /**< the kind of node                             */
+	ValType    type;     /**< the type of an expression, or TYPE_NONE      */
+	SourcePos  pos;      /**< the position of the node in the source       */
+	AstNode   *next;     /**< the next node in a list                      */
+	union {
+		/** AST_PROGRAM */
+		struct {
+			char    *name;    /**< the class name                      */
+			AstNode *subdefs; /**< the list of subroutines             */
+			AstNode *main;    /**< the body of main, as an AST_SUBDEF  */
+		} program;
+		/** AST_SUBDEF */
+		struct {
+			char          *name;   /**< the subroutine name               */
+			IDPropt        prop;   /**< the subroutine properties         */
+			AstNode       *params; /**< the list of parameters            */
+			AstNode       *vars;   /**< the list of variable definitions  */
+			AstNode       *body;   /**< the list of statements            */
+			unsigned int   width;  /**< the length of the local variables */
+			char          *key;    /**< its key in the cache, if compiled */
+			struct body_s *code;   /**< its code, once generated or found */
+		} subdef;
+		/** AST_VARDEF, AST_VAR, AST_INDEX, and AST_CALL */
+		struct {
+			char    *id;    /**< the identifier                           */
+			IDPropt  prop;  /**< a copy of the identifier properties      */
+			AstNode *index; /**< the index of an AST_INDEX                */
+			AstNode *args;  /**< the list of arguments of an AST_CALL     */
+		} ref;
+		/** AST_ASSIGN, AST_ALLOC, and AST_INPUT */
+		struct {
+			AstNode *target; /**< an AST_VAR or AST_INDEX                 */
+			AstNode *expr;   /**< the value or array size, if any         */
+		} assign;
+		/** AST_IF and AST_WHILE */
+		struct {
+			AstNode *cond; /**< the guard                                  */
+			AstNode *body; /**< the list of statements if the guard holds */
+			AstNode *alt;  /**< the list of statements otherwise, if any  */
+		} branch;
+		/** AST_BINARY */
+		struct {
+			TokenType op;    /**< the operator                            */
+			AstNode  *left;  /**< the left operand                        */
+			AstNode  *right; /**< the right operand                       */
+		} binary;
+		/** AST_UNARY, AST_OUTPUT, and AST_RETURN */
+		struct {
+			TokenType op;   /**< the operator of an AST_UNARY             */
+			AstNode  *expr; /**< the operand, output items, or result     */
+		} unary;
+		/** AST_NUM and AST_BOOL */
+		int value;
+		/** AST_STRING */
+		char *string;
+	};
+};
+
+/**
+ * Create a node of the specified kind.  All the fields except the kind and
+ * position are zeroed.
+ *
+ * @param[in]  kind
+ *     the kind of node
+ * @param[in]  pos
+ *     the position of the node in the source
+ * @return
+ *     a pointer to the new node
+ */
+AstNode *ast_node(AstKind kind, SourcePos pos);
+
+/**
+ * Write an indented representation of a syntax tree, one node per line.
+ *
+ * @param[in]  out
+ *     the output stream
+ * @param[in]  node
+ *     the root of the tree
+ */
+void dump_ast(FILE *out, AstNode *node);
+
+#endif /* AST_H */
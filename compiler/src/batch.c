@@ -0,0 +1,280 @@
+/**
+ * @file    batch.c
+ * @brief   Compilation of several source files at the same time, on a pool of
+ *          worker threads.
+ *
+ * The compiler units keep their state per thread, so every worker compiles on
+ * its own: it has its own symbol tables, code buffers, and compilation arena,
+ * and only takes the lock to claim the next file and to mark it done.  Files
+ * are claimed in order from a shared counter, so that an idle worker always
+ * picks up the next file that nobody has started, and a long file does not
+ * hold up the files queued behind it.  The calling thread reports the
+ * diagnostics of the files in order, as soon as each file and all the files
+ * before it are done.
+ *
+ * Jasmin output is assembled for all the files at once, after they have been
+ * compiled, since starting the JVM costs far more than assembling a file.
+ *
+ * @date    2026-10-16
+ */
+
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "batch.h"
+#include "boolean.h"
+#include "cache.h"
+#include "classfile.h"
+#include "codegen.h"
+#include "error.h"
+#include "libamplc.h"
+#include "timing.h"
+
+/* --- type definitions and constants --------------------------------------- */
+
+/** the compilation of one file */
+typedef struct {
+	Request  req;         /**< the compilation                       */
+	int      status;      /**< its exit status                       */
+	char    *diagnostics; /**< what it would have written to stderr  */
+	size_t   diag_len;    /**< the length of the diagnostics         */
+	Boolean  done;        /**< whether the compilation has finished  */
+} Job;
+
+/** the files to compile, and the state of the pool */
+typedef struct {
+	Job             *jobs;     /**< the compilations, in the order named */
+	int              njobs;    /**< the number of compilations           */
+	int              next;     /**< the next compilation to claim        */
+	pthread_mutex_t  lock;     /**< guards next and the done flags       */
+	pthread_cond_t   finished; /**< signalled when a compilation is done */
+} Batch;
+
+/* --- function prototypes -------------------------------------------------- */
+
+static void *work(void *arg);
+static void run_job(Job *job);
+static void assemble_batch(Batch *batch);
+static int fail_job(Job *job, const char *failure);
+static void cache_job(Job *job);
+
+/* --- batch interface ------------------------------------------------------ */
+
+int compile_batch(const Request *options, char **names, int n, int jobs)
+{
+	int i, status, nthreads;
+	pthread_t *threads;
+	Batch batch;
+
+	batch.jobs = emalloc(n * sizeof(Job));
+	batch.njobs = n;
+	batch.next = 0;
+	for (i = 0; i < n; i++) {
+		batch.jobs[i].req = *options;
+		batch.jobs[i].req.src_name = names[i];
+		batch.jobs[i].req.source = NULL;
+		batch.jobs[i].req.output = NULL;
+		batch.jobs[i].req.cache_key = NULL;
+		batch.jobs[i].req.defer = options->use_jasmin;
+		batch.jobs[i].diagnostics = NULL;
+		batch.jobs[i].diag_len = 0;
+		batch.jobs[i].done = FALSE;
+	}
+	pthread_mutex_init(&batch.lock, NULL);
+	pthread_cond_init(&batch.finished, NULL);
+
+	/* more workers than files would have nothing to do */
+	nthreads = (jobs < n ? jobs : n);
+	threads = emalloc(nthreads * sizeof(pthread_t));
+	for (i = 0; i < nthreads; i++) {
+		if (pthread_create(&threads[i], NULL, work, &batch) != 0) {
+			eprintf("Could not create worker thread:");
+		}
+	}
+
+	/* report in the order named, as soon as every earlier file is done */
+	for (i = 0; i < n; i++) {
+		pthread_mutex_lock(&batch.lock);
+		while (!batch.jobs[i].done) {
+			pthread_cond_wait(&batch.finished, &batch.lock);
+		}
+		pthread_mutex_unlock(&batch.lock);
+
+		fwrite(batch.jobs[i].diagnostics, 1, batch.jobs[i].diag_len, stderr);
+		free(batch.jobs[i].diagnostics);
+	}
+
+	for (i = 0; i < nthreads; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	pthread_cond_destroy(&batch.finished);
+	pthread_mutex_destroy(&batch.lock);
+	free(threads);
+
+	/* the assembly of the batch is reported apart from the compilations */
+	if (options->use_jasmin) {
+		init_timing(options->timed);
+		start_phase(PHASE_ASSEMBLE);
+		assemble_batch(&batch);
+		stop_phase(PHASE_ASSEMBLE);
+		if (options->timed) {
+			print_time_report(stderr, "the batch", options->time_json);
+		}
+	}
+
+	status = EXIT_SUCCESS;
+	for (i = 0; i < n; i++) {
+		if (status == EXIT_SUCCESS) {
+			status = batch.jobs[i].status;
+		}
+		free(batch.jobs[i].req.output);
+		free(batch.jobs[i].req.cache_key);
+	}
+	free(batch.jobs);
+
+	return status;
+}
+
+/* --- worker threads ------------------------------------------------------- */
+
+/**
+ * Claims and compiles files until there are none left.
+ */
+static void *work(void *arg)
+{
+	int i;
+	Batch *batch;
+
+	batch = (Batch *) arg;
+	for (;;) {
+		pthread_mutex_lock(&batch->lock);
+		i = batch->next++;
+		pthread_mutex_unlock(&batch->lock);
+		if (i >= batch->njobs) {
+			break;
+		}
+
+		run_job(&batch->jobs[i]);
+
+		pthread_mutex_lock(&batch->lock);
+		batch->jobs[i].done = TRUE;
+		pthread_cond_broadcast(&batch->finished);
+		pthread_mutex_unlock(&batch->lock);
+	}
+
+	return NULL;
+}
+
+/**
+ * Compiles a file, and collects its diagnostics.
+ */
+static void run_job(Job *job)
+{
+	FILE *diag;
+
+	if ((diag = open_memstream(&job->diagnostics, &job->diag_len)) == NULL) {
+		eprintf("Could not collect diagnostics:");
+	}
+	seterrstream(diag);
+	job->status = compile_request(&job->req);
+	seterrstream(NULL);
+	fclose(diag);
+}
+
+/* --- assembly ------------------------------------------------------------- */
+
+/**
+ * Assembles the Jasmin files of the files that compiled, with one invocation
+ * of the assembler.  If that fails, the files are assembled one at a time, so
+ * that each failure is reported against the file that caused it.  The Jasmin
+ * files are removed afterwards, as for a single compilation.  Files served
+ * from the cache have nothing to assemble, and the others are cached once
+ * they have been assembled.
+ */
+static void assemble_batch(Batch *batch)
+{
+	int i, k;
+	char **names, *jasmin_path;
+	const char *failure;
+	Job *job;
+
+	names = emalloc(batch->njobs * sizeof(char *));
+	for (i = k = 0; i < batch->njobs; i++) {
+		if (batch->jobs[i].status == EXIT_SUCCESS
+				&& !batch->jobs[i].req.cached) {
+			names[k++] = batch->jobs[i].req.output;
+		}
+	}
+
+	/* a compilation that succeeded has checked the environment */
+	jasmin_path = getenv("JASMIN_JAR");
+	if (k > 0 && assemble_files(jasmin_path, names, k, TRUE) != NULL) {
+		for (i = 0; i < batch->njobs; i++) {
+			job = &batch->jobs[i];
+			if (job->status == EXIT_SUCCESS && !job->req.cached
+					&& (failure = assemble_files(jasmin_path,
+							&job->req.output, 1, FALSE)) != NULL) {
+				job->status = fail_job(job, failure);
+			}
+		}
+	}
+
+	for (i = 0; i < batch->njobs; i++) {
+		if (batch->jobs[i].status == EXIT_SUCCESS
+				&& batch->jobs[i].req.cache_key != NULL) {
+			cache_job(&batch->jobs[i]);
+		}
+	}
+
+#ifndef DEBUG_CODEGEN
+	for (i = 0; i < k; i++) {
+		unlink(names[i]);
+	}
+#endif
+	free(names);
+}
+
+/**
+ * Reports an error in a file after its compilation, as the compilation would
+ * have, and returns the exit status of the error.
+ */
+static int fail_job(Job *job, const char *failure)
+{
+	jmp_buf env;
+	int status;
+
+	setsrcname(job->req.src_name);
+	if ((status = setjmp(env)) == 0) {
+		seterrjmp(&env);
+		eprintf("%s", failure);
+	}
+	seterrjmp(NULL);
+	freesrcname();
+
+	return status;
+}
+
+/**
+ * Stores the class file assembled from the Jasmin file of a compilation in
+ * the cache.
+ */
+static void cache_job(Job *job)
+{
+	char *output, *dot;
+	const char *cache_dir;
+
+	if ((cache_dir = get_cache_dir()) == NULL) {
+		return;
+	}
+	output = emalloc(strlen(job->req.output) + sizeof(CLASS_EXT));
+	strcpy(output, job->req.output);
+	if ((dot = strrchr(output, '.')) != NULL) {
+		*dot = '\0';
+	}
+	strcat(output, CLASS_EXT);
+	cache_store(cache_dir, job->req.cache_key, output);
+	free(output);
+}
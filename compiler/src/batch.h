@@ -0,0 +1,34 @@
+/**
+ * @file    batch.h
+ * @brief   Compilation of several source files at the same time, on a pool of
+ *          worker threads.
+ * @date    2026-10-16
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "libamplc.h"
+
+/**
+ * Compile a number of source files on a pool of worker threads, each file
+ * with the options of the specified request.  The diagnostics of each file
+ * are collected while it compiles, and written to the standard error stream
+ * in the order in which the files are named, whatever the order in which
+ * they finish.
+ *
+ * @param[in]  options
+ *     the options of every compilation; its source is ignored
+ * @param[in]  names
+ *     the names of the source files
+ * @param[in]  n
+ *     the number of source files
+ * @param[in]  jobs
+ *     the number of worker threads
+ * @return
+ *     <code>EXIT_SUCCESS</code> if every file compiled, or the exit status of
+ *     the first file, in the order named, that did not
+ */
+int compile_batch(const Request *options, char **names, int n, int jobs);
+
+#endif /* BATCH_H */
@@ -0,0 +1,627 @@
+/**
+ * @file    cache.c
+ * @brief   A content-addressed cache of compiled class files.
+ *
+ * The key of a compilation is the SHA-256 hash of the source text, the
+ * identity of the compiler (its format version, and the size and modification
+ * time of its executable, so that a rebuilt compiler does not reuse the
+ * output of the old one), and the options that change the output.
+ *
+ * The cache also holds the code of single routines, for the incremental
+ * compilation of a source file of which only some routines have changed.
+ *
+ * The statistics are kept in a small text file in the cache directory, which
+ * is locked while it is updated, so that the counts of concurrent
+ * compilations add up.
+ *
+ * @date    2026-10-16
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "boolean.h"
+#include "cache.h"
+#include "error.h"
+
+/* --- type definitions and constants --------------------------------------- */
+
+/** the version of the cache format; change it along with the output */
+#define CACHE_FORMAT  "amplc-cache-1"
+
+#define STATS_NAME    "stats"          /* the statistics file               */
+#define TMP_TEMPLATE  "tmp.XXXXXX"     /* the template of temporary names   */
+#define HASH_LEN      32               /* the length of a SHA-256 hash      */
+#define KEY_LEN       (2 * HASH_LEN)   /* the length of a key in hex digits */
+#define HEADER_SIZE   1024             /* the maximum length of the header  */
+#define COPY_SIZE     65536            /* the size of the copy buffer       */
+
+/** the statistics of a cache */
+typedef struct {
+	unsigned long long hits;     /**< the number of lookups that hit      */
+	unsigned long long misses;   /**< the number of lookups that missed   */
+	unsigned long long saved;    /**< the bytes of output served on a hit */
+	unsigned long long r_hits;   /**< the number of routines reused       */
+	unsigned long long r_misses; /**< the number of routines compiled     */
+} CacheStats;
+
+/* --- function prototypes -------------------------------------------------- */
+
+static void sha256_init(CacheDigest *s);
+static void sha256_update(CacheDigest *s, const void *data, size_t len);
+static void sha256_final(CacheDigest *s, unsigned char hash[HASH_LEN]);
+static void sha256_block(CacheDigest *s, const unsigned char *p);
+static char *entry_file(const char *dir, const char *key, char **name);
+static void store_entry(const char *dir, const char *key, const char *name,
+		const char *from, const void *data, size_t len);
+static char *path_in(const char *dir, const char *name);
+static Boolean copy_file(const char *from, const char *to, mode_t mode);
+static Boolean write_file(const char *to, const void *data, size_t len,
+		mode_t mode);
+static Boolean place(const char *from, const char *to, Boolean linked);
+static void update_stats(const char *dir, const CacheStats *delta);
+static void read_stats(int fd, CacheStats *stats);
+
+/* --- cache interface ------------------------------------------------------ */
+
+const char *get_cache_dir(void)
+{
+	const char *dir;
+
+	dir = getenv(CACHE_DIR_ENV);
+	return (dir != NULL && *dir != '\0' ? dir : NULL);
+}
+
+void init_digest(CacheDigest *d)
+{
+	int n;
+	char header[HEADER_SIZE];
+	struct stat sb;
+
+	/* an unknown executable hashes as if it had not changed */
+	if (stat("/proc/self/exe", &sb) != 0) {
+		memset(&sb, 0, sizeof(sb));
+	}
+	n = snprintf(header, sizeof(header), "%s\n%lu %lu %lld %lld\n",
+			CACHE_FORMAT, (unsigned long) sb.st_dev,
+			(unsigned long) sb.st_ino, (long long) sb.st_size,
+			(long long) sb.st_mtime);
+
+	sha256_init(d);
+	sha256_update(d, header, n);
+}
+
+void update_digest(CacheDigest *d, const void *data, size_t len)
+{
+	sha256_update(d, data, len);
+}
+
+char *digest_key(CacheDigest *d)
+{
+	int i;
+	char *key;
+	unsigned char hash[HASH_LEN];
+
+	sha256_final(d, hash);
+	key = emalloc(KEY_LEN + 1);
+	for (i = 0; i < HASH_LEN; i++) {
+		sprintf(key + 2 * i, "%02x", hash[i]);
+	}
+
+	return key;
+}
+
+char *cache_key(const char *src, size_t len, const Request *req)
+{
+	int n;
+	char header[HEADER_SIZE];
+	const char *jasmin_path;
+	CacheDigest d;
+
+	jasmin_path = (req->use_jasmin ? getenv("JASMIN_JAR") : NULL);
+	n = snprintf(header, sizeof(header), "%d %s\n%zu\n", req->use_jasmin,
+			(jasmin_path != NULL ? jasmin_path : "-"), len);
+	if (n < 0 || n >= HEADER_SIZE) {
+		n = HEADER_SIZE - 1;
+	}
+
+	init_digest(&d);
+	update_digest(&d, header, n);
+	update_digest(&d, src, len);
+
+	return digest_key(&d);
+}
+
+char *cache_fetch(const char *dir, const char *key)
+{
+	char *cached, *name;
+	struct stat sb;
+	CacheStats delta;
+
+	memset(&delta, 0, sizeof(delta));
+	if ((cached = entry_file(dir, key, &name)) == NULL) {
+		delta.misses = 1;
+		update_stats(dir, &delta);
+		return NULL;
+	}
+
+	/* an entry that cannot be placed is as good as missing */
+	if (stat(cached, &sb) != 0 || !place(cached, name, TRUE)) {
+		free(cached);
+		free(name);
+		delta.misses = 1;
+		update_stats(dir, &delta);
+		return NULL;
+	}
+	free(cached);
+	delta.hits = 1;
+	delta.saved = sb.st_size;
+	update_stats(dir, &delta);
+
+	return name;
+}
+
+void cache_store(const char *dir, const char *key, const char *output)
+{
+	const char *base;
+
+	base = strrchr(output, '/');
+	base = (base != NULL ? base + 1 : output);
+	store_entry(dir, key, base, output, NULL, 0);
+}
+
+void *cache_fetch_data(const char *dir, const char *key, const char *name,
+		size_t *len)
+{
+	int fd;
+	char *entry, *cached, *data;
+	struct stat sb;
+
+	/* the name is known, so that the entry need not be listed */
+	entry = path_in(dir, key);
+	cached = path_in(entry, name);
+	fd = open(cached, O_RDONLY);
+	free(cached);
+	free(entry);
+	if (fd == -1) {
+		return NULL;
+	}
+
+	data = NULL;
+	if (fstat(fd, &sb) == 0) {
+		data = emalloc(sb.st_size > 0 ? sb.st_size : 1);
+		if (read(fd, data, sb.st_size) != sb.st_size) {
+			free(data);
+			data = NULL;
+		}
+		*len = sb.st_size;
+	}
+	close(fd);
+
+	return data;
+}
+
+void cache_store_data(const char *dir, const char *key, const char *name,
+		const void *data, size_t len)
+{
+	store_entry(dir, key, name, NULL, data, len);
+}
+
+void cache_count_routines(const char *dir, unsigned long reused,
+		unsigned long built)
+{
+	CacheStats delta;
+
+	if (reused + built > 0) {
+		memset(&delta, 0, sizeof(delta));
+		delta.r_hits = reused;
+		delta.r_misses = built;
+		update_stats(dir, &delta);
+	}
+}
+
+void print_cache_stats(FILE *out, const char *dir)
+{
+	int fd;
+	unsigned long long entries, bytes, lookups;
+	char *cached, *name;
+	DIR *d;
+	struct dirent *e;
+	struct stat sb;
+	CacheStats stats;
+
+	/* the size of the cache, counting only whole entries */
+	entries = bytes = 0;
+	if ((d = opendir(dir)) != NULL) {
+		while ((e = readdir(d)) != NULL) {
+			if (strlen(e->d_name) == KEY_LEN
+					&& (cached = entry_file(dir, e->d_name, &name)) != NULL) {
+				if (stat(cached, &sb) == 0) {
+					entries++;
+					bytes += sb.st_size;
+				}
+				free(cached);
+				free(name);
+			}
+		}
+		closedir(d);
+	}
+
+	memset(&stats, 0, sizeof(stats));
+	name = path_in(dir, STATS_NAME);
+	if ((fd = open(name, O_RDONLY)) != -1) {
+		flock(fd, LOCK_SH);
+		read_stats(fd, &stats);
+		close(fd);
+	}
+	free(name);
+
+	lookups = stats.hits + stats.misses;
+	fprintf(out, "cache directory  %s\n", dir);
+	fprintf(out, "entries          %llu\n", entries);
+	fprintf(out, "size             %llu bytes\n", bytes);
+	fprintf(out, "lookups          %llu\n", lookups);
+	fprintf(out, "hits             %llu\n", stats.hits);
+	fprintf(out, "misses           %llu\n", stats.misses);
+	fprintf(out, "hit rate         %.1f%%\n",
+			(lookups > 0 ? 100.0 * stats.hits / lookups : 0.0));
+	fprintf(out, "bytes saved      %llu\n", stats.saved);
+
+	lookups = stats.r_hits + stats.r_misses;
+	fprintf(out, "routines reused  %llu\n", stats.r_hits);
+	fprintf(out, "routines built   %llu\n", stats.r_misses);
+	fprintf(out, "reuse rate       %.1f%%\n",
+			(lookups > 0 ? 100.0 * stats.r_hits / lookups : 0.0));
+}
+
+/* --- entries -------------------------------------------------------------- */
+
+/**
+ * Finds the output stored in an entry.  Returns its path, and sets name to
+ * its name; or returns NULL if there is no such entry.
+ */
+static char *entry_file(const char *dir, const char *key, char **name)
+{
+	char *entry, *cached;
+	DIR *d;
+	struct dirent *e;
+
+	entry = path_in(dir, key);
+	cached = NULL;
+	if ((d = opendir(entry)) != NULL) {
+		while ((e = readdir(d)) != NULL) {
+			if (e->d_name[0] != '.') {
+				*name = estrdup(e->d_name);
+				cached = path_in(entry, e->d_name);
+				break;
+			}
+		}
+		closedir(d);
+	}
+	free(entry);
+
+	return cached;
+}
+
+/**
+ * Stores an entry, as a copy of a file if from is not NULL, or with the given
+ * contents otherwise.  The entry is read-only, since outputs may be linked to
+ * it; if another compilation has stored it first, this copy is discarded.
+ */
+static void store_entry(const char *dir, const char *key, const char *name,
+		const char *from, const void *data, size_t len)
+{
+	char *tmp_dir, *tmp_file, *entry;
+	Boolean ok;
+
+	if (mkdir(dir, 0777) != 0 && errno != EEXIST) {
+		return;
+	}
+
+	tmp_dir = path_in(dir, TMP_TEMPLATE);
+	if (mkdtemp(tmp_dir) == NULL) {
+		free(tmp_dir);
+		return;
+	}
+	chmod(tmp_dir, 0755);
+	tmp_file = path_in(tmp_dir, name);
+	entry = path_in(dir, key);
+
+	ok = (from != NULL ? copy_file(from, tmp_file, 0444)
+			: write_file(tmp_file, data, len, 0444));
+	if (!ok || rename(tmp_dir, entry) != 0) {
+		unlink(tmp_file);
+		rmdir(tmp_dir);
+	}
+
+	free(entry);
+	free(tmp_file);
+	free(tmp_dir);
+}
+
+/**
+ * Returns the path of a name in a directory.
+ */
+static char *path_in(const char *dir, const char *name)
+{
+	char *path;
+
+	path = emalloc(strlen(dir) + strlen(name) + 2);
+	sprintf(path, "%s/%s", dir, name);
+
+	return path;
+}
+
+/* --- files ---------------------------------------------------------------- */
+
+/**
+ * Copies a file to a new file with the given mode.  Returns whether the copy
+ * succeeded; if not, the new file is removed.
+ */
+static Boolean copy_file(const char *from, const char *to, mode_t mode)
+{
+	int in, out;
+	ssize_t n;
+	Boolean ok;
+	char buf[COPY_SIZE];
+
+	if ((in = open(from, O_RDONLY)) == -1) {
+		return FALSE;
+	}
+	if ((out = open(to, O_WRONLY | O_CREAT | O_EXCL, mode)) == -1) {
+		close(in);
+		return FALSE;
+	}
+
+	ok = TRUE;
+	while (ok && (n = read(in, buf, sizeof(buf))) != 0) {
+		ok = (n > 0 && write(out, buf, n) == n);
+	}
+	close(in);
+	if (close(out) != 0 || !ok) {
+		unlink(to);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * Writes data to a new file with the given mode.  Returns whether the write
+ * succeeded; if not, the new file is removed.
+ */
+static Boolean write_file(const char *to, const void *data, size_t len,
+		mode_t mode)
+{
+	int out;
+	Boolean ok;
+
+	if ((out = open(to, O_WRONLY | O_CREAT | O_EXCL, mode)) == -1) {
+		return FALSE;
+	}
+	ok = (write(out, data, len) == (ssize_t) len);
+	if (close(out) != 0 || !ok) {
+		unlink(to);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * Places a file under another name, by a hard link if so requested and
+ * possible, or by a copy otherwise.  The file is placed under a temporary
+ * name, and renamed, so that it replaces the target in one step.
+ */
+static Boolean place(const char *from, const char *to, Boolean linked)
+{
+	int fd;
+	char *tmp, *slash;
+	Boolean ok;
+
+	/* the temporary file must be in the directory of the target */
+	slash = strrchr(to, '/');
+	if (slash == NULL) {
+		tmp = estrdup(TMP_TEMPLATE);
+	} else {
+		tmp = emalloc(slash - to + sizeof(TMP_TEMPLATE) + 1);
+		sprintf(tmp, "%.*s/%s", (int) (slash - to), to, TMP_TEMPLATE);
+	}
+
+	/* reserve a name, and replace the file that holds it */
+	if ((fd = mkstemp(tmp)) == -1) {
+		free(tmp);
+		return FALSE;
+	}
+	close(fd);
+	unlink(tmp);
+
+	ok = ((linked && link(from, tmp) == 0) || copy_file(from, tmp, 0666))
+		&& rename(tmp, to) == 0;
+
+	/* renaming a link onto another link to the same file does nothing */
+	unlink(tmp);
+	free(tmp);
+
+	return ok;
+}
+
+/* --- statistics ----------------------------------------------------------- */
+
+/**
+ * Adds counts to the statistics of the cache.  The statistics are not
+ * essential, so that an error in updating them is ignored.
+ */
+static void update_stats(const char *dir, const CacheStats *delta)
+{
+	int fd, n;
+	char *path, buf[HEADER_SIZE];
+	CacheStats stats;
+
+	if (mkdir(dir, 0777) != 0 && errno != EEXIST) {
+		return;
+	}
+	path = path_in(dir, STATS_NAME);
+	fd = open(path, O_RDWR | O_CREAT, 0666);
+	free(path);
+	if (fd == -1) {
+		return;
+	}
+
+	if (flock(fd, LOCK_EX) == 0) {
+		read_stats(fd, &stats);
+		stats.hits += delta->hits;
+		stats.misses += delta->misses;
+		stats.saved += delta->saved;
+		stats.r_hits += delta->r_hits;
+		stats.r_misses += delta->r_misses;
+		n = snprintf(buf, sizeof(buf), "hits %llu\nmisses %llu\nsaved %llu\n"
+				"routine_hits %llu\nroutine_misses %llu\n", stats.hits,
+				stats.misses, stats.saved, stats.r_hits, stats.r_misses);
+		if (ftruncate(fd, 0) == 0 && pwrite(fd, buf, n, 0) != n) {
+			ftruncate(fd, 0);
+		}
+	}
+	close(fd);
+}
+
+/**
+ * Reads the statistics from an open statistics file; a missing or damaged
+ * file counts as empty.
+ */
+static void read_stats(int fd, CacheStats *stats)
+{
+	int n;
+	ssize_t len;
+	char buf[HEADER_SIZE];
+
+	/* files written before routines were cached have only three counts */
+	memset(stats, 0, sizeof(*stats));
+	if ((len = pread(fd, buf, sizeof(buf) - 1, 0)) > 0) {
+		buf[len] = '\0';
+		n = sscanf(buf, "hits %llu misses %llu saved %llu routine_hits %llu "
+				"routine_misses %llu", &stats->hits, &stats->misses,
+				&stats->saved, &stats->r_hits, &stats->r_misses);
+		if (n != 3 && n != 5) {
+			memset(stats, 0, sizeof(*stats));
+		}
+	}
+}
+
+/* --- SHA-256 -------------------------------------------------------------- */
+
+#define ROR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static const uint32_t k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+	0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+	0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+	0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+	0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+	0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static void sha256_init(CacheDigest *s)
+{
+	static const uint32_t h0[8] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f,
+		0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+	};
+
+	memcpy(s->h, h0, sizeof(h0));
+	s->nblock = 0;
+	s->nbits = 0;
+}
+
+static void sha256_update(CacheDigest *s, const void *data, size_t len)
+{
+	const unsigned char *p;
+	size_t n;
+
+	p = (const unsigned char *) data;
+	s->nbits += (uint64_t) len * 8;
+	while (len > 0) {
+		if (s->nblock == 0 && len >= 64) {
+			sha256_block(s, p);
+			p += 64;
+			len -= 64;
+			continue;
+		}
+		n = 64 - s->nblock;
+		n = (len < n ? len : n);
+		memcpy(s->block + s->nblock, p, n);
+		s->nblock += n;
+		p += n;
+		len -= n;
+		if (s->nblock == 64) {
+			sha256_block(s, s->block);
+			s->nblock = 0;
+		}
+	}
+}
+
+static void sha256_final(CacheDigest *s, unsigned char hash[HASH_LEN])
+{
+	int i;
+	uint64_t nbits;
+	unsigned char pad[72];
+	size_t npad;
+
+	/* a one bit, zeroes up to 56 bytes into a block, and the length */
+	nbits = s->nbits;
+	npad = (s->nblock < 56 ? 56 - s->nblock : 120 - s->nblock);
+	memset(pad, 0, sizeof(pad));
+	pad[0] = 0x80;
+	for (i = 0; i < 8; i++) {
+		pad[npad + i] = (unsigned char) (nbits >> (56 - 8 * i));
+	}
+	sha256_update(s, pad, npad + 8);
+
+	for (i = 0; i < 8; i++) {
+		hash[4 * i]     = (unsigned char) (s->h[i] >> 24);
+		hash[4 * i + 1] = (unsigned char) (s->h[i] >> 16);
+		hash[4 * i + 2] = (unsigned char) (s->h[i] >> 8);
+		hash[4 * i + 3] = (unsigned char) s->h[i];
+	}
+}
+
+static void sha256_block(CacheDigest *s, const unsigned char *p)
+{
+	int i;
+	uint32_t w[64], a, b, c, d, e, f, g, h, t1, t2;
+
+	for (i = 0; i < 16; i++) {
+		w[i] = (uint32_t) p[4 * i] << 24 | (uint32_t) p[4 * i + 1] << 16
+			| (uint32_t) p[4 * i + 2] << 8 | (uint32_t) p[4 * i + 3];
+	}
+	for (i = 16; i < 64; i++) {
+		w[i] = w[i - 16] + w[i - 7]
+			+ (ROR(w[i - 15], 7) ^ ROR(w[i - 15], 18) ^ (w[i - 15] >> 3))
+			+ (ROR(w[i - 2], 17) ^ ROR(w[i - 2], 19) ^ (w[i - 2] >> 10));
+	}
+
+	a = s->h[0]; b = s->h[1]; c = s->h[2]; d = s->h[3];
+	e = s->h[4]; f = s->h[5]; g = s->h[6]; h = s->h[7];
+	for (i = 0; i < 64; i++) {
+		t1 = h + (ROR(e, 6) ^ ROR(e, 11) ^ ROR(e, 25)) + ((e & f) ^ (~e & g))
+			+ k[i] + w[i];
+		t2 = (ROR(a, 2) ^ ROR(a, 13) ^ ROR(a, 22))
+			+ ((a & b) ^ (a & c) ^ (b & c));
+		h = g; g = f; f = e; e = d + t1;
+		d = c; c = b; b = a; a = t1 + t2;
+	}
+	s->h[0] += a; s->h[1] += b; s->h[2] += c; s->h[3] += d;
+	s->h[4] += e; s->h[5] += f; s->h[6] += g; s->h[7] += h;
+}
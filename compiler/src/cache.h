@@ -0,0 +1,181 @@
+/**
+ * @file    cache.h
+ * @brief   A content-addressed cache of compiled class files, kept in the
+ *          directory named by the AMPLC_CACHE_DIR environment variable.
+ *
+ * An entry is keyed by a hash of the source text, the compiler, and the
+ * options that affect the output.  It is a directory, named by the key, that
+ * holds the output under the name that the compilation gave it.  Entries are
+ * built in a temporary directory and renamed into place, so that concurrent
+ * compilations may share a cache: a reader sees either a whole entry or none,
+ * and when two writers race, one entry wins and the other is discarded.
+ *
+ * Besides whole class files, the cache holds the code of single routines,
+ * under keys that the compiler computes with the digest functions below.
+ *
+ * @date    2026-10-16
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "libamplc.h"
+
+/** the environment variable that names the cache directory */
+#define CACHE_DIR_ENV "AMPLC_CACHE_DIR"
+
+/** the state of a key computation, which is a SHA-256 hash */
+typedef struct {
+	uint32_t      h[8];       /**< the hash so far                  */
+	unsigned char block[64];  /**< the partial block                */
+	size_t        nblock;     /**< the number of bytes in the block */
+	uint64_t      nbits;      /**< the number of bits hashed        */
+} CacheDigest;
+
+/**
+ * Get the cache directory.
+ *
+ * @return
+ *     the cache directory, or <code>NULL</code> if caching is disabled
+ */
+const char *get_cache_dir(void);
+
+/**
+ * Start the computation of a key.  The identity of the compiler is hashed
+ * first, so that a rebuilt compiler does not reuse the entries of the old one.
+ *
+ * @param[out] d
+ *     the digest to initialise
+ */
+void init_digest(CacheDigest *d);
+
+/**
+ * Add data to the computation of a key.
+ *
+ * @param[in]  d
+ *     the digest
+ * @param[in]  data
+ *     the data to hash
+ * @param[in]  len
+ *     the length of the data in bytes
+ */
+void update_digest(CacheDigest *d, const void *data, size_t len);
+
+/**
+ * Finish the computation of a key.  The digest cannot be updated afterwards.
+ *
+ * @param[in]  d
+ *     the digest
+ * @return
+ *     the key, as a string of hexadecimal digits, which the caller must free
+ */
+char *digest_key(CacheDigest *d);
+
+/**
+ * Compute the key of a compilation.
+ *
+ * @param[in]  src
+ *     the source text
+ * @param[in]  len
+ *     the length of the source text
+ * @param[in]  req
+ *     the compilation, whose options are part of the key
+ * @return
+ *     the key, as a string of hexadecimal digits, which the caller must free
+ */
+char *cache_key(const char *src, size_t len, const Request *req);
+
+/**
+ * Look up a compilation in the cache.  On a hit, the output is linked, or
+ * failing that, copied, into the current directory, replacing any file of
+ * the same name.  The lookup is counted in the statistics of the cache.
+ *
+ * @param[in]  dir
+ *     the cache directory
+ * @param[in]  key
+ *     the key of the compilation
+ * @return
+ *     the name of the output, which the caller must free, on a hit; or
+ *     <code>NULL</code> on a miss
+ */
+char *cache_fetch(const char *dir, const char *key);
+
+/**
+ * Store the output of a compilation in the cache.  Failure to store it is not
+ * an error, since the compilation has succeeded regardless.
+ *
+ * @param[in]  dir
+ *     the cache directory
+ * @param[in]  key
+ *     the key of the compilation
+ * @param[in]  output
+ *     the name of the output file, in the current directory
+ */
+void cache_store(const char *dir, const char *key, const char *output);
+
+/**
+ * Look up data, such as the code of a routine, in the cache.  Unlike
+ * <code>cache_fetch</code>, the lookup is not counted.
+ *
+ * @param[in]  dir
+ *     the cache directory
+ * @param[in]  key
+ *     the key of the data
+ * @param[in]  name
+ *     the name of the file that holds the data in the entry
+ * @param[out] len
+ *     the length of the data in bytes
+ * @return
+ *     the data, which the caller must free, on a hit; or <code>NULL</code> on
+ *     a miss
+ */
+void *cache_fetch_data(const char *dir, const char *key, const char *name,
+		size_t *len);
+
+/**
+ * Store data, such as the code of a routine, in the cache.  As for
+ * <code>cache_store</code>, failure to store it is not an error.
+ *
+ * @param[in]  dir
+ *     the cache directory
+ * @param[in]  key
+ *     the key of the data
+ * @param[in]  name
+ *     the name of the file that holds the data in the entry
+ * @param[in]  data
+ *     the data
+ * @param[in]  len
+ *     the length of the data in bytes
+ */
+void cache_store_data(const char *dir, const char *key, const char *name,
+		const void *data, size_t len);
+
+/**
+ * Count the routines of a compilation in the statistics of a cache.
+ *
+ * @param[in]  dir
+ *     the cache directory
+ * @param[in]  reused
+ *     the number of routines whose code was found in the cache
+ * @param[in]  built
+ *     the number of routines that were compiled
+ */
+void cache_count_routines(const char *dir, unsigned long reused,
+		unsigned long built);
+
+/**
+ * Print the statistics of a cache: its size, the hit rate and bytes saved
+ * over all the compilations that have used it, and the rate at which the code
+ * of routines was reused.
+ *
+ * @param[in]  out
+ *     the stream to print to
+ * @param[in]  dir
+ *     the cache directory
+ */
+void print_cache_stats(FILE *out, const char *dir);
+
+#endif /* CACHE_H */
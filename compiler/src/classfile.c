@@ -0,0 +1,802 @@
+/**
+ * @file    classfile.c
+ * @brief   A writer for JVM class files.
+ *
+ * The class file is built directly from the code arrays of the code generation
+ * unit.  Each method is encoded in two passes: the first pass enters all
+ * constants into the constant pool and determines the offsets of the labels,
+ * and the second pass writes the bytecode with the branch offsets resolved.
+ * The class file version is 45.3, which is also what Jasmin writes by default;
+ * this version does not require stack map frames.
+ *
+ * @date    2026-10-16
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+#include "boolean.h"
+#include "classfile.h"
+#include "codegen.h"
+#include "error.h"
+#include "hashtable.h"
+#include "jvm.h"
+
+/* --- type definitions and constants --------------------------------------- */
+
+/** a growable byte buffer */
+typedef struct {
+	unsigned char *data; /**< the bytes                  */
+	size_t         len;  /**< the number of bytes in use */
+	size_t         cap;  /**< the allocated size         */
+} Buffer;
+
+/* constant pool tags */
+#define CONSTANT_UTF8         1
+#define CONSTANT_INTEGER      3
+#define CONSTANT_CLASS        7
+#define CONSTANT_STRING       8
+#define CONSTANT_FIELDREF     9
+#define CONSTANT_METHODREF    10
+#define CONSTANT_NAMEANDTYPE  12
+
+/* opcodes that are only used in their encoded form */
+#define OP_ALOAD_0  0x2a
+#define OP_ASTORE_0 0x4b
+#define OP_ILOAD_0  0x1a
+#define OP_ISTORE_0 0x3b
+#define OP_LDC_W    0x13
+#define OP_NOP      0x00
+#define OP_WIDE     0xc4
+
+#define CLASS_MAGIC   0xcafebabe
+#define MINOR_VERSION 3
+#define MAJOR_VERSION 45
+#define MAX_CP_COUNT  65535
+#define MAX_CODE_LEN  65535
+#define NO_LABEL      UINT_MAX
+
+/* --- global static variables ---------------------------------------------- */
+
+static _Thread_local Buffer       pool;       /**< the constant pool entries */
+static _Thread_local unsigned int pool_count; /**< the next pool index       */
+static _Thread_local HashTab     *pool_index; /**< maps keys to pool indices */
+static _Thread_local Buffer       keys;       /**< the key being looked up   */
+static _Thread_local Buffer       text;       /**< an unescaped string       */
+static _Thread_local Buffer       scratch;    /**< measured, then discarded  */
+
+/* --- function prototypes -------------------------------------------------- */
+
+static void put_u1(Buffer *b, unsigned int v);
+static void put_u2(Buffer *b, unsigned int v);
+static void put_u4(Buffer *b, unsigned long v);
+static void put_bytes(Buffer *b, const void *bytes, size_t n);
+static void release_buffer(Buffer *b);
+static unsigned int cp_find(const char *key);
+static unsigned int cp_add(char *key);
+static char *make_key(int tag, const char *s1, size_t len1, const char *s2,
+		size_t len2, const char *s3);
+static unsigned int cp_utf8(const char *s, size_t n);
+static unsigned int cp_integer(int value);
+static unsigned int cp_class(const char *name, size_t n);
+static unsigned int cp_string(const char *s);
+static unsigned int cp_name_and_type(const char *name, size_t namelen,
+		const char *desc, size_t desclen);
+static unsigned int cp_member(int tag, const char *owner, size_t ownerlen,
+		const char *name, size_t namelen, const char *desc);
+static unsigned int cp_field(const char *ref);
+static unsigned int cp_method(const char *ref);
+static void write_method(Buffer *out, Body *b);
+static size_t encode_code(Body *b, Buffer *out, unsigned int *labels);
+static size_t encode_instruction(Buffer *out, size_t pc, Bytecode opcode,
+		Code *operand, unsigned int *labels);
+static unsigned int label_offset(unsigned int *labels, Label label);
+static const char *unescape(const char *s);
+static void keep(void *p);
+static unsigned int key_hash(void *key, unsigned int size);
+static int key_cmp(void *val1, void *val2);
+
+/* --- class file interface ------------------------------------------------- */
+
+void make_class_file(void)
+{
+	char *path;
+	const char *cname;
+	unsigned char *image;
+	size_t len;
+	FILE *class_file;
+
+	image = build_class_file(&len);
+
+	/* write the class file */
+	cname = get_class_name();
+	path = emalloc(strlen(cname) + sizeof(CLASS_EXT));
+	strcpy(path, cname);
+	strcat(path, CLASS_EXT);
+
+	if ((class_file = fopen(path, "wb")) == NULL) {
+		eprintf("Could not open class file:");
+	}
+	if (fwrite(image, 1, len, class_file) != len) {
+		eprintf("Could not write class file:");
+	}
+	if (fclose(class_file) != 0) {
+		eprintf("Could not write class file:");
+	}
+
+	free(path);
+	free(image);
+}
+
+unsigned char *build_class_file(size_t *len)
+{
+	int i, nfields;
+	unsigned int this_class, super_class;
+	const char *cname;
+	const Field *fields;
+	Body *b, *last;
+	Buffer image, rest;
+
+	pool.data = NULL;
+	pool.len = pool.cap = 0;
+	pool_count = 1;
+	if ((pool_index = ht_init(0.75f, key_hash, key_cmp)) == NULL) {
+		eprintf("Constant pool index could not be initialised");
+	}
+	rest.data = NULL;
+	rest.len = rest.cap = 0;
+
+	/* everything after the constant pool is built first, so that the
+	 * constant pool is complete by the time it is written
+	 */
+	cname = get_class_name();
+	this_class = cp_class(cname, strlen(cname));
+	super_class = cp_class("java/lang/Object", strlen("java/lang/Object"));
+	put_u2(&rest, ACC_PUBLIC | ACC_SUPER);
+	put_u2(&rest, this_class);
+	put_u2(&rest, super_class);
+	put_u2(&rest, 0);
+
+	fields = get_fields(&nfields);
+	put_u2(&rest, nfields);
+	for (i = 0; i < nfields; i++) {
+		put_u2(&rest, fields[i].access);
+		put_u2(&rest, cp_utf8(fields[i].name, strlen(fields[i].name)));
+		put_u2(&rest, cp_utf8(fields[i].descriptor,
+				strlen(fields[i].descriptor)));
+		put_u2(&rest, 0);
+	}
+
+	/* methods, in the order in which they were generated */
+	last = NULL;
+	for (i = 0, b = get_bodies(); b; b = b->next, i++) {
+		last = b;
+	}
+	put_u2(&rest, i);
+	for (b = last; b; b = b->prev) {
+		write_method(&rest, b);
+	}
+
+	put_u2(&rest, 0);
+
+	if (pool_count > MAX_CP_COUNT) {
+		eprintf("Too many constants for class file");
+	}
+
+	/* the header and the constant pool precede the rest */
+	image.data = NULL;
+	image.len = image.cap = 0;
+	put_u4(&image, CLASS_MAGIC);
+	put_u2(&image, MINOR_VERSION);
+	put_u2(&image, MAJOR_VERSION);
+	put_u2(&image, pool_count);
+	put_bytes(&image, pool.data, pool.len);
+	put_bytes(&image, rest.data, rest.len);
+
+	/* release resources */
+	free(pool.data);
+	free(rest.data);
+	release_buffer(&keys);
+	release_buffer(&text);
+	release_buffer(&scratch);
+	ht_free(pool_index, keep, keep);
+	pool_index = NULL;
+
+	*len = image.len;
+	return image.data;
+}
+
+/* --- method encoding ------------------------------------------------------ */
+
+/**
+ * Writes the method_info structure, including the Code attribute, of a method.
+ *
+ * @param[out] out the buffer to write to.
+ * @param[in]  b   the body of the method.
+ */
+static void write_method(Buffer *out, Body *b)
+{
+	int i;
+	Label max_label;
+	unsigned int *labels;
+	size_t code_len;
+
+	/* allocate the label table for this method */
+	max_label = 0;
+	for (i = 0; i < b->ip; i++) {
+		if ((b->code[i].type & CODE_LABEL) && b->code[i].label > max_label) {
+			max_label = b->code[i].label;
+		}
+	}
+	labels = emalloc((max_label + 1) * sizeof(unsigned int));
+	for (i = 0; i <= (int) max_label; i++) {
+		labels[i] = NO_LABEL;
+	}
+
+	/* pass 1: constants and label offsets */
+	code_len = encode_code(b, NULL, labels);
+	if (code_len > MAX_CODE_LEN) {
+		eprintf("Code of method '%s' is too large", b->name);
+	}
+
+	put_u2(out, b->access);
+	put_u2(out, cp_utf8(b->name, strlen(b->name)));
+	put_u2(out, cp_utf8(b->descriptor, strlen(b->descriptor)));
+	put_u2(out, 1);
+
+	/* Code attribute */
+	put_u2(out, cp_utf8("Code", strlen("Code")));
+	put_u4(out, 12 + code_len + 8 * b->ncatches);
+	put_u2(out, b->max_stack_depth);
+	put_u2(out, b->variables_width);
+	put_u4(out, code_len);
+
+	/* pass 2: the bytecode */
+	encode_code(b, out, labels);
+
+	/* exception table, with catch type 0 for a handler that catches all */
+	put_u2(out, b->ncatches);
+	for (i = 0; i < b->ncatches; i++) {
+		put_u2(out, label_offset(labels, b->catches[i].start));
+		put_u2(out, label_offset(labels, b->catches[i].end));
+		put_u2(out, label_offset(labels, b->catches[i].handler));
+		put_u2(out, 0);
+	}
+
+	put_u2(out, 0);  /* attributes count */
+
+	free(labels);
+}
+
+/**
+ * Encodes the code array of a method.  If no output buffer is specified, the
+ * offsets of the labels are recorded instead.
+ *
+ * @param[in]     b      the body of the method.
+ * @param[out]    out    the buffer to write to, or <code>NULL</code>.
+ * @param[in,out] labels the offsets of the labels, indexed by label.
+ * @return        the length of the encoded code.
+ */
+static size_t encode_code(Body *b, Buffer *out, unsigned int *labels)
+{
+	int i;
+	size_t pc;
+	Code *c, *operand;
+
+	pc = 0;
+	for (i = 0; i < b->ip; i++) {
+		c = &b->code[i];
+		switch (c->type & MASK_TYPE) {
+			case CODE_LABEL:
+				if (out == NULL) {
+					labels[c->label] = pc;
+				}
+				break;
+			case CODE_INSTRUCTION:
+				operand = NULL;
+				if (i + 1 < b->ip && (b->code[i+1].type & CODE_OPERAND)) {
+					operand = &b->code[++i];
+				}
+				pc += encode_instruction(out, pc, c->code, operand, labels);
+				break;
+			default:
+				eprintf("Unexpected item in code of method '%s': %x", b->name,
+						(unsigned int) c->type);
+		}
+	}
+
+	/* guard against a dangling label at the end of the code stream */
+	if (b->ip > 0 && (b->code[b->ip-1].type & MASK_TYPE) == CODE_LABEL) {
+		if (out) {
+			put_u1(out, OP_NOP);
+		}
+		pc++;
+	}
+
+	return pc;
+}
+
+/**
+ * Encodes a single instruction.
+ *
+ * @param[out] out     the buffer to write to, or <code>NULL</code>.
+ * @param[in]  pc      the offset of the instruction.
+ * @param[in]  opcode  the instruction.
+ * @param[in]  operand the operand of the instruction, or <code>NULL</code>.
+ * @param[in]  labels  the offsets of the labels, indexed by label.
+ * @return     the length of the encoded instruction.
+ */
+static size_t encode_instruction(Buffer *out, size_t pc, Bytecode opcode,
+		Code *operand, unsigned int *labels)
+{
+	unsigned int index;
+	size_t start;
+	long offset;
+
+	/* when measuring, write into a scratch buffer that is discarded */
+	if (out == NULL) {
+		scratch.len = 0;
+		out = &scratch;
+	}
+	start = out->len;
+
+	switch (opcode) {
+		case JVM_ALOAD:
+		case JVM_ASTORE:
+		case JVM_ILOAD:
+		case JVM_ISTORE:
+			if (operand->num <= 3) {
+				put_u1(out, operand->num + (opcode == JVM_ALOAD ? OP_ALOAD_0
+						: opcode == JVM_ASTORE ? OP_ASTORE_0
+						: opcode == JVM_ILOAD ? OP_ILOAD_0 : OP_ISTORE_0));
+			} else if (operand->num <= UCHAR_MAX) {
+				put_u1(out, get_opcode_value(opcode));
+				put_u1(out, operand->num);
+			} else {
+				put_u1(out, OP_WIDE);
+				put_u1(out, get_opcode_value(opcode));
+				put_u2(out, operand->num);
+			}
+			break;
+		case JVM_GOTO:
+		case JVM_IFEQ:
+		case JVM_IFNE:
+		case JVM_IFGE:
+		case JVM_IFGT:
+		case JVM_IF_ICMPEQ:
+		case JVM_IF_ICMPGE:
+		case JVM_IF_ICMPGT:
+		case JVM_IF_ICMPLE:
+		case JVM_IF_ICMPLT:
+		case JVM_IF_ICMPNE:
+			offset = 0;
+			if (out != &scratch) {
+				offset = (long) label_offset(labels, operand->label)
+					- (long) pc;
+				if (offset < SHRT_MIN || offset > SHRT_MAX) {
+					eprintf("Branch offset to label L%u out of range",
+							operand->label);
+				}
+			}
+			put_u1(out, get_opcode_value(opcode));
+			put_u2(out, (unsigned int) offset & 0xffff);
+			break;
+		case JVM_BIPUSH:
+			put_u1(out, get_opcode_value(opcode));
+			put_u1(out, (unsigned int) operand->num & 0xff);
+			break;
+		case JVM_SIPUSH:
+			put_u1(out, get_opcode_value(opcode));
+			put_u2(out, (unsigned int) operand->num & 0xffff);
+			break;
+		case JVM_LDC:
+			if ((operand->type & MASK_DATA_TYPE) == CODE_STRING) {
+				index = cp_string(unescape(operand->string));
+			} else {
+				index = cp_integer(operand->num);
+			}
+			if (index <= UCHAR_MAX) {
+				put_u1(out, get_opcode_value(JVM_LDC));
+				put_u1(out, index);
+			} else {
+				put_u1(out, OP_LDC_W);
+				put_u2(out, index);
+			}
+			break;
+		case JVM_GETSTATIC:
+		case JVM_PUTSTATIC:
+			put_u1(out, get_opcode_value(opcode));
+			put_u2(out, cp_field(operand->string));
+			break;
+		case JVM_INVOKESPECIAL:
+		case JVM_INVOKESTATIC:
+		case JVM_INVOKEVIRTUAL:
+			put_u1(out, get_opcode_value(opcode));
+			put_u2(out, cp_method(operand->string));
+			break;
+		case JVM_NEW:
+			put_u1(out, get_opcode_value(opcode));
+			put_u2(out, cp_class(operand->string,
+					strlen(operand->string)));
+			break;
+		case JVM_NEWARRAY:
+			put_u1(out, get_opcode_value(opcode));
+			put_u1(out, operand->atype);
+			break;
+		default:
+			put_u1(out, get_opcode_value(opcode));
+			break;
+	}
+
+	return out->len - start;
+}
+
+/* --- constant pool -------------------------------------------------------- */
+
+/**
+ * Returns the index of a constant pool entry, or 0, which is not a valid index,
+ * if the entry is not in the pool yet.  The key uniquely identifies the entry.
+ *
+ * @param[in] key the key of the entry.
+ * @return    the index of the entry, or 0.
+ */
+static unsigned int cp_find(const char *key)
+{
+	unsigned int *index;
+
+	index = ht_search(pool_index, (void *) key);
+
+	return (index ? *index : 0);
+}
+
+/**
+ * Returns the index for a new constant pool entry, of which the caller then
+ * writes the encoding to the pool.  The entries that it refers to must already
+ * be in the pool.
+ *
+ * @param[in] key the key of the entry, in the arena of the compilation.
+ * @return    the index of the entry.
+ */
+static unsigned int cp_add(char *key)
+{
+	unsigned int *index;
+
+	index = unit_alloc(sizeof(unsigned int));
+	*index = pool_count++;
+	if (ht_insert(pool_index, key, index) != EXIT_SUCCESS) {
+		eprintf("Could not add constant to constant pool index");
+	}
+
+	return *index;
+}
+
+/**
+ * Returns the key for a constant pool entry, consisting of the tag and up to
+ * three strings, separated by spaces.  The key is only valid until the next
+ * call, and must be copied to be kept.
+ */
+static char *make_key(int tag, const char *s1, size_t len1, const char *s2,
+		size_t len2, const char *s3)
+{
+	keys.len = 0;
+	put_u1(&keys, '0' + tag);
+	put_bytes(&keys, s1, len1);
+	put_u1(&keys, ' ');
+	put_bytes(&keys, s2, len2);
+	put_u1(&keys, ' ');
+	put_bytes(&keys, s3, (s3 ? strlen(s3) : 0));
+	put_u1(&keys, '\0');
+
+	return (char *) keys.data;
+}
+
+/**
+ * Returns the index of a UTF-8 entry.
+ *
+ * @param[in] s the string (not terminated).
+ * @param[in] n the length of the string.
+ * @return    the index of the entry.
+ */
+static unsigned int cp_utf8(const char *s, size_t n)
+{
+	const unsigned char *p, *end;
+	unsigned int index;
+	size_t len;
+	char *key;
+
+	key = make_key(CONSTANT_UTF8, s, n, NULL, 0, NULL);
+	if ((index = cp_find(key)) != 0) {
+		return index;
+	}
+	index = cp_add(unit_strdup(key));
+
+	/* modified UTF-8, treating the string as ISO-8859-1 */
+	end = (const unsigned char *) s + n;
+	for (len = n, p = (const unsigned char *) s; p < end; p++) {
+		len += (*p >= 0x80);
+	}
+	put_u1(&pool, CONSTANT_UTF8);
+	put_u2(&pool, len);
+	for (p = (const unsigned char *) s; p < end; p++) {
+		if (*p < 0x80) {
+			put_u1(&pool, *p);
+		} else {
+			put_u1(&pool, 0xc0 | (*p >> 6));
+			put_u1(&pool, 0x80 | (*p & 0x3f));
+		}
+	}
+
+	return index;
+}
+
+static unsigned int cp_integer(int value)
+{
+	unsigned int index;
+	char key[16];
+
+	snprintf(key, sizeof(key), "%c%d", '0' + CONSTANT_INTEGER, value);
+	if ((index = cp_find(key)) != 0) {
+		return index;
+	}
+	index = cp_add(unit_strdup(key));
+	put_u1(&pool, CONSTANT_INTEGER);
+	put_u4(&pool, (unsigned long) (unsigned int) value);
+
+	return index;
+}
+
+/**
+ * Returns the index of a class entry.
+ *
+ * @param[in] name the internal name of the class (not terminated).
+ * @param[in] n    the length of the name.
+ * @return    the index of the entry.
+ */
+static unsigned int cp_class(const char *name, size_t n)
+{
+	unsigned int index, name_index;
+	char *key;
+
+	key = make_key(CONSTANT_CLASS, name, n, NULL, 0, NULL);
+	if ((index = cp_find(key)) != 0) {
+		return index;
+	}
+
+	/* the entries that this entry refers to come first, and reuse the key */
+	key = unit_strdup(key);
+	name_index = cp_utf8(name, n);
+	index = cp_add(key);
+	put_u1(&pool, CONSTANT_CLASS);
+	put_u2(&pool, name_index);
+
+	return index;
+}
+
+static unsigned int cp_string(const char *s)
+{
+	unsigned int index, utf8_index;
+	size_t n;
+	char *key;
+
+	n = strlen(s);
+	key = make_key(CONSTANT_STRING, s, n, NULL, 0, NULL);
+	if ((index = cp_find(key)) != 0) {
+		return index;
+	}
+	key = unit_strdup(key);
+	utf8_index = cp_utf8(s, n);
+	index = cp_add(key);
+	put_u1(&pool, CONSTANT_STRING);
+	put_u2(&pool, utf8_index);
+
+	return index;
+}
+
+static unsigned int cp_name_and_type(const char *name, size_t namelen,
+		const char *desc, size_t desclen)
+{
+	unsigned int index, name_index, desc_index;
+	char *key;
+
+	key = make_key(CONSTANT_NAMEANDTYPE, name, namelen, desc, desclen, NULL);
+	if ((index = cp_find(key)) != 0) {
+		return index;
+	}
+	key = unit_strdup(key);
+	name_index = cp_utf8(name, namelen);
+	desc_index = cp_utf8(desc, desclen);
+	index = cp_add(key);
+	put_u1(&pool, CONSTANT_NAMEANDTYPE);
+	put_u2(&pool, name_index);
+	put_u2(&pool, desc_index);
+
+	return index;
+}
+
+/**
+ * Returns the index of a field or method reference.
+ *
+ * @param[in] tag      the constant pool tag of the reference.
+ * @param[in] owner    the internal name of the class (not terminated).
+ * @param[in] ownerlen the length of the class name.
+ * @param[in] name     the name of the member (not terminated).
+ * @param[in] namelen  the length of the member name.
+ * @param[in] desc     the descriptor of the member.
+ * @return    the index of the reference.
+ */
+static unsigned int cp_member(int tag, const char *owner, size_t ownerlen,
+		const char *name, size_t namelen, const char *desc)
+{
+	unsigned int index, class_index, nat_index;
+	char *key;
+
+	key = make_key(tag, owner, ownerlen, name, namelen, desc);
+	if ((index = cp_find(key)) != 0) {
+		return index;
+	}
+	key = unit_strdup(key);
+	class_index = cp_class(owner, ownerlen);
+	nat_index = cp_name_and_type(name, namelen, desc, strlen(desc));
+	index = cp_add(key);
+	put_u1(&pool, tag);
+	put_u2(&pool, class_index);
+	put_u2(&pool, nat_index);
+
+	return index;
+}
+
+/**
+ * Returns the index of a field reference written as in Jasmin, that is, as
+ * "owner/name descriptor".
+ */
+static unsigned int cp_field(const char *ref)
+{
+	const char *space, *slash;
+
+	if ((space = strchr(ref, ' ')) == NULL) {
+		eprintf("Malformed field reference '%s'", ref);
+	}
+	for (slash = space; slash > ref && *slash != '/'; slash--)
+		;
+	if (slash == ref) {
+		eprintf("Malformed field reference '%s'", ref);
+	}
+
+	return cp_member(CONSTANT_FIELDREF, ref, slash - ref, slash + 1,
+			space - slash - 1, space + 1);
+}
+
+/**
+ * Returns the index of a method reference written as in Jasmin, that is, as
+ * "owner/name(parameters)return".
+ */
+static unsigned int cp_method(const char *ref)
+{
+	const char *paren, *slash;
+
+	if ((paren = strchr(ref, '(')) == NULL) {
+		eprintf("Malformed method reference '%s'", ref);
+	}
+	for (slash = paren; slash > ref && *slash != '/'; slash--)
+		;
+	if (slash == ref) {
+		eprintf("Malformed method reference '%s'", ref);
+	}
+
+	return cp_member(CONSTANT_METHODREF, ref, slash - ref, slash + 1,
+			paren - slash - 1, paren);
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+static void put_u1(Buffer *b, unsigned int v)
+{
+	if (b->len + 1 > b->cap) {
+		b->cap = (b->cap ? b->cap * 2 : 64);
+		b->data = erealloc(b->data, b->cap);
+	}
+	b->data[b->len++] = v & 0xff;
+}
+
+static void put_u2(Buffer *b, unsigned int v)
+{
+	put_u1(b, v >> 8);
+	put_u1(b, v);
+}
+
+static void put_u4(Buffer *b, unsigned long v)
+{
+	put_u2(b, (v >> 16) & 0xffff);
+	put_u2(b, v & 0xffff);
+}
+
+static void put_bytes(Buffer *b, const void *bytes, size_t n)
+{
+	while (b->len + n > b->cap) {
+		b->cap = (b->cap ? b->cap * 2 : 64);
+		b->data = erealloc(b->data, b->cap);
+	}
+	if (n > 0) {
+		memcpy(b->data + b->len, bytes, n);
+	}
+	b->len += n;
+}
+
+static void release_buffer(Buffer *b)
+{
+	free(b->data);
+	b->data = NULL;
+	b->len = b->cap = 0;
+}
+
+/**
+ * Returns the offset of a label, which must have been defined in the method.
+ */
+static unsigned int label_offset(unsigned int *labels, Label label)
+{
+	if (labels[label] == NO_LABEL) {
+		eprintf("Undefined label L%u", label);
+	}
+	return labels[label];
+}
+
+/**
+ * Returns a copy of a string literal as stored by the scanner, with its escape
+ * sequences replaced by the characters they denote.  The copy is only valid
+ * until the next call.
+ *
+ * @param[in] s the string literal.
+ * @return    the unescaped string.
+ */
+static const char *unescape(const char *s)
+{
+	text.len = 0;
+	while (*s) {
+		if (*s == '\\' && s[1] != '\0') {
+			s++;
+			switch (*s) {
+				case 'n':
+					put_u1(&text, '\n');
+					break;
+				case 't':
+					put_u1(&text, '\t');
+					break;
+				default:
+					put_u1(&text, *s);
+					break;
+			}
+			s++;
+		} else {
+			put_u1(&text, *s++);
+		}
+	}
+	put_u1(&text, '\0');
+
+	return (const char *) text.data;
+}
+
+/* The keys and indices of the pool belong to the arena of the compilation. */
+static void keep(void *p)
+{
+	(void) p;
+}
+
+static unsigned int key_hash(void *key, unsigned int size)
+{
+	const unsigned char *s = key;
+	unsigned int hash = 0;
+
+	while (*s) {
+		hash = (hash << 5) | (hash >> 27);
+		hash += *s++;
+	}
+
+	return hash % size;
+}
+
+static int key_cmp(void *val1, void *val2)
+{
+	return strcmp((char *) val1, (char *) val2);
+}
@@ -0,0 +1,34 @@
+/**
+ * @file    classfile.h
+ * @brief   A writer for JVM class files, used instead of assembling Jasmin
+ *          output with an external assembler.
+ * @date    2026-10-16
+ */
+
+#ifndef CLASSFILE_H
+#define CLASSFILE_H
+
+#include <stddef.h>
+
+/** the extension of class files */
+#define CLASS_EXT ".class"
+
+/**
+ * Write the generated code of the current class to a class file in the
+ * current directory, named after the class.  The bodies of all the methods
+ * must have been closed by <code>close_subroutine_codegen</code>.
+ */
+void make_class_file(void);
+
+/**
+ * Build the class file of the current class in memory, as
+ * <code>make_class_file</code> would have written it.
+ *
+ * @param[out] len
+ *     the length of the class file
+ * @return
+ *     a pointer to newly allocated memory that contains the class file
+ */
+unsigned char *build_class_file(size_t *len);
+
+#endif /* CLASSFILE_H */
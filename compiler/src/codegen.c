@@ -6,189 +6,165 @@
  */
 
 #include <assert.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
+#include "arena.h"
 #include "boolean.h"
 #include "codegen.h"
 #include "error.h"
+#include "peephole.h"
 #include "valtypes.h"
 
 /* --- type definitions and constants --------------------------------------- */
 
-typedef enum {
-	CODE_LABEL       = 0x0001,
-	CODE_INSTRUCTION = 0x0002,
-	CODE_OPERAND     = 0x0004,
-	MASK_TYPE        = 0x000f,
-	CODE_INTEGER     = 0x0010,
-	CODE_ARRAY_TYPE  = 0x0020,
-	CODE_STRING      = 0x0040,
-	CODE_REFERENCE   = 0x0080,
-	MASK_DATA_TYPE   = 0x00f0,
-	CODE_ALLOCATED   = 0x0100,
-	MASK_ALLOCATION  = 0x0f00
-} CodeType;
-
 typedef struct {
-	const char *instr;
-	short       pop;
-	short       push;
+	const char   *instr;
+	unsigned char value;
+	short         pop;
+	short         push;
 } BC;
 
+/** a growing buffer for a saved body */
 typedef struct {
-	CodeType type;
-	union {
-		JVMatype  atype;
-		Bytecode  code;
-		Label     label;
-		int       num;
-		char     *string;
-	};
-} Code;
-
-typedef struct body_s Body;
-struct body_s {
-	char   *name;
-	IDPropt *idprop;
-	Code   *code;
-	int     ip;
-	int     max_stack_depth;
-	int     variables_width;
-	Body   *next;
-	Body   *prev;
-};
+	unsigned char *data; /**< the saved body so far  */
+	size_t         len;  /**< its length             */
+	size_t         size; /**< the size of the buffer */
+} SaveBuf;
+
+/** a cursor over a saved body that is being loaded */
+typedef struct {
+	const unsigned char *p;   /**< the next byte to read             */
+	const unsigned char *end; /**< the end of the saved body         */
+	Boolean              ok;  /**< whether everything read was there */
+} LoadBuf;
+
+/** the first word of a saved body */
+#define BODY_MAGIC 0x414d4231
+
+/* the most space that the descriptor of a subroutine takes: 1 for the '\0', 2
+ * for the '(' and ')' of the parameter list, and 2 for the return type and for
+ * each parameter, which may be of an array type
+ */
+#define DESCRIPTOR_SIZE(p) (5 + 2 * (p)->nparams)
 
 /* --- Jasmin output string literals ---------------------------------------- */
 
 char class_preamble[] =
 	".class public %s\n"
-	".super java/lang/Object\n\n"
-	".field private static final charsetName Ljava/lang/String;\n"
-	".field private static final usLocale Ljava/util/Locale;\n"
-	".field private static final scanner Ljava/util/Scanner;\n\n"
-	".method static public <clinit>()V\n"
-	".limit stack 5\n"
-	".limit locals 1 \n"
-	"\tldc	\"UTF-8\"\n"
-	"\tputstatic %s/charsetName Ljava/lang/String;\n"
-	"\tnew	java/util/Locale\n"
-	"\tdup\n"
-	"\tldc	\"en\"\n"
-	"\tldc	\"US\"\n"
-	"\tinvokespecial "
-	"java/util/Locale/<init>(Ljava/lang/String;Ljava/lang/String;)V\n"
-	"\tputstatic %s/usLocale Ljava/util/Locale;\n"
-	"\tnew	java/util/Scanner\n"
-	"\tdup\n"
-	"\tnew	java/io/BufferedInputStream\n"
-	"\tdup\n"
-	"\tgetstatic java/lang/System/in Ljava/io/InputStream;\n"
-	"\tinvokespecial"
-	" java/io/BufferedInputStream/<init>(Ljava/io/InputStream;)V\n"
-	"\tgetstatic %s/charsetName Ljava/lang/String;\n"
-	"\tinvokespecial "
-	"java/util/Scanner/<init>(Ljava/io/InputStream;Ljava/lang/String;)V\n"
-	"\tputstatic %s/scanner Ljava/util/Scanner;\n"
-	"\tgetstatic %s/scanner Ljava/util/Scanner;\n"
-	"\tgetstatic %s/usLocale Ljava/util/Locale;\n"
-	"\tinvokevirtual"
-	" java/util/Scanner/useLocale(Ljava/util/Locale;)Ljava/util/Scanner;\n"
-	"\tpop\n"
-	"\treturn\n"
-	".end method\n\n";
-
-char method_init[] =
-	".method public <init>()V\n"
-	"\taload_0\n"
-	"\tinvokespecial java/lang/Object/<init>()V\n"
-	"\treturn\n"
-	".end method\n\n";
-
-char method_readBoolean[] =
-	".method public static readBoolean()Z\n"
-	".limit stack 2\n"
-	".limit locals 1\n"
-	"\tgetstatic %s/scanner Ljava/util/Scanner;\n"
-	"\tinvokevirtual java/util/Scanner/next()Ljava/lang/String;\n"
-	"\tastore 0\n"
-	"\taload 0\n"
-	"\tldc	\"true\"\n"
-	"\tinvokevirtual java/lang/String/equalsIgnoreCase(Ljava/lang/String;)Z\n"
-	"\tifeq False\n"
-	"\ticonst_1\n"
-	"\tireturn\n"
-	"False:\n"
-	"\taload 0\n"
-	"\tldc	\"false\"\n"
-	"\tinvokevirtual java/lang/String/equalsIgnoreCase(Ljava/lang/String;)Z\n"
-	"\tifeq Exception\n"
-	"\ticonst_0\n"
-	"\tireturn\n"
-	"Exception:\n"
-	"\tnew	java/util/InputMismatchException\n"
-	"\tdup\n"
-	"\tinvokespecial java/util/InputMismatchException/<init>()V\n"
-	"\tathrow\n"
-	".end method\n\n";
-
-char method_readInt[] =
-	".method public static readInt()I\n"
-	".limit stack 1\n"
-	".limit locals 1\n"
-	"\tgetstatic %s/scanner Ljava/util/Scanner;\n"
-	"\tinvokevirtual java/util/Scanner/nextInt()I\n"
-	"\tireturn\n"
-	".end method\n\n";
-
-char  ref_print_boolean[] = "java/io/PrintStream/print(Z)V";
-char  ref_print_integer[] = "java/io/PrintStream/print(I)V";
-char  ref_print_stream[]  = "java/lang/System/out Ljava/io/PrintStream;";
-char  ref_print_string[]  = "java/io/PrintStream/print(Ljava/lang/String;)V";
-char *ref_read_boolean;   /* must be set in set_class_name */
-char *ref_read_integer;   /* must be set in set_class_name */
-
-#define REF_READ_BOOLEAN "/readBoolean()Z"
-#define REF_READ_INTEGER "/readInt()I"
+	".super java/lang/Object\n\n";
+
+_Thread_local char *ref_print_boolean;  /* must be set in set_class_name */
+_Thread_local char *ref_print_integer;  /* must be set in set_class_name */
+_Thread_local char *ref_print_string;   /* must be set in set_class_name */
+_Thread_local char *ref_read_boolean;   /* must be set in set_class_name */
+_Thread_local char *ref_read_integer;   /* must be set in set_class_name */
+_Thread_local char *ref_main_body;      /* must be set in set_class_name */
+
+/* the body of main and the output methods have a '$' in their names, so that
+ * they cannot clash with AMPL subroutines
+ */
+#define MAIN_BODY         "main$"
+#define REF_MAIN_BODY     MAIN_BODY "([Ljava/lang/String;)V"
+#define REF_PRINT_BOOLEAN "print$(Z)V"
+#define REF_PRINT_INTEGER "print$(I)V"
+#define REF_PRINT_STRING  "print$(Ljava/lang/String;)V"
+#define REF_READ_BOOLEAN  "readBoolean()Z"
+#define REF_READ_INTEGER  "readInt()I"
+#define REF_READ_BYTE     "readByte$()I"
+#define REF_SKIP_SPACE    "skipSpace$()I"
+#define REF_READ_WORD     "readWord$(Ljava/lang/String;)Z"
+
+/* the sizes of the standard input and output buffers, in bytes */
+#define INPUT_BUFFER_SIZE  65536
+#define OUTPUT_BUFFER_SIZE 65536
+
+/* --- runtime support ------------------------------------------------------ */
+
+/* the access flags of fields that are set once, and of those that change */
+#define ACC_CONSTANT (ACC_PRIVATE | ACC_STATIC | ACC_FINAL)
+#define ACC_VARIABLE (ACC_PRIVATE | ACC_STATIC)
+
+static const Field fields[] = {
+	{ "stdin",       "Ljava/io/InputStream;", ACC_CONSTANT },
+	{ "inputBuffer", "[B",                    ACC_CONSTANT },
+	{ "inputLength", "I",                     ACC_VARIABLE },
+	{ "inputPos",    "I",                     ACC_VARIABLE },
+	{ "out",         "Ljava/io/PrintStream;", ACC_CONSTANT }
+};
+
+#define NFIELDS (sizeof(fields) / sizeof(Field))
+
+/* references to the fields of the generated class; set in set_class_name */
+static _Thread_local char *ref_fields[NFIELDS];
+
+#define REF_STDIN        (ref_fields[0])
+#define REF_INPUT_BUFFER (ref_fields[1])
+#define REF_INPUT_LENGTH (ref_fields[2])
+#define REF_INPUT_POS    (ref_fields[3])
+#define REF_OUT          (ref_fields[4])
 
 /* --- global static variables ---------------------------------------------- */
 
 static BC instruction_set[] = {
-	{ "aload",         0, 1 },
-	{ "areturn",       1, 0 },
-	{ "astore",        1, 0 },
-	{ "getstatic",     0, 1 },
-	{ "goto",          0, 0 },
-	{ "iadd",          2, 1 },
-	{ "iaload",        2, 1 },
-	{ "iand",          2, 1 },
-	{ "iastore",       3, 0 },
-	{ "idiv",          2, 1 },
-	{ "ifeq",          1, 0 },
-	{ "if_icmpeq",     2, 0 },
-	{ "if_icmpge",     2, 0 },
-	{ "if_icmpgt",     2, 0 },
-	{ "if_icmple",     2, 0 },
-	{ "if_icmplt",     2, 0 },
-	{ "if_icmpne",     2, 0 },
-	{ "iload",         0, 1 },
-	{ "imul",          2, 1 },
-	{ "ineg",          1, 1 },
-	{ "invokestatic",  0, 1 },
-	{ "invokevirtual", 0, 0 },
-	{ "ior",           2, 1 },
-	{ "istore",        1, 0 },
-	{ "isub",          2, 1 },
-	{ "irem",          2, 1 },
-	{ "ireturn",       1, 0 },
-	{ "ixor",          2, 1 },
-	{ "ldc",           0, 1 },
-	{ "newarray",      1, 1 },
-	{ "return",        0, 0 },
-	{ "swap",          2, 2 }
+	{ "aload",         0x19, 0, 1 },
+	{ "areturn",       0xb0, 1, 0 },
+	{ "arraylength",   0xbe, 1, 1 },
+	{ "astore",        0x3a, 1, 0 },
+	{ "athrow",        0xbf, 1, 0 },
+	{ "baload",        0x33, 2, 1 },
+	{ "bipush",        0x10, 0, 1 },
+	{ "dup",           0x59, 1, 2 },
+	{ "getstatic",     0xb2, 0, 1 },
+	{ "goto",          0xa7, 0, 0 },
+	{ "iadd",          0x60, 2, 1 },
+	{ "iaload",        0x2e, 2, 1 },
+	{ "iand",          0x7e, 2, 1 },
+	{ "iastore",       0x4f, 3, 0 },
+	{ "iconst_m1",     0x02, 0, 1 },
+	{ "iconst_0",      0x03, 0, 1 },
+	{ "iconst_1",      0x04, 0, 1 },
+	{ "iconst_2",      0x05, 0, 1 },
+	{ "iconst_3",      0x06, 0, 1 },
+	{ "iconst_4",      0x07, 0, 1 },
+	{ "iconst_5",      0x08, 0, 1 },
+	{ "idiv",          0x6c, 2, 1 },
+	{ "ifeq",          0x99, 1, 0 },
+	{ "ifne",          0x9a, 1, 0 },
+	{ "ifge",          0x9c, 1, 0 },
+	{ "ifgt",          0x9d, 1, 0 },
+	{ "if_icmpeq",     0x9f, 2, 0 },
+	{ "if_icmpge",     0xa2, 2, 0 },
+	{ "if_icmpgt",     0xa3, 2, 0 },
+	{ "if_icmple",     0xa4, 2, 0 },
+	{ "if_icmplt",     0xa1, 2, 0 },
+	{ "if_icmpne",     0xa0, 2, 0 },
+	{ "iload",         0x15, 0, 1 },
+	{ "imul",          0x68, 2, 1 },
+	{ "ineg",          0x74, 1, 1 },
+	{ "invokespecial", 0xb7, 1, 0 },
+	{ "invokestatic",  0xb8, 0, 1 },
+	{ "invokevirtual", 0xb6, 0, 0 },
+	{ "ior",           0x80, 2, 1 },
+	{ "istore",        0x36, 1, 0 },
+	{ "isub",          0x64, 2, 1 },
+	{ "irem",          0x70, 2, 1 },
+	{ "ireturn",       0xac, 1, 0 },
+	{ "ixor",          0x82, 2, 1 },
+	{ "ldc",           0x12, 0, 1 },
+	{ "new",           0xbb, 0, 1 },
+	{ "newarray",      0xbc, 1, 1 },
+	{ "nop",           0x00, 0, 0 },
+	{ "pop",           0x57, 1, 0 },
+	{ "putstatic",     0xb3, 1, 0 },
+	{ "return",        0xb1, 0, 0 },
+	{ "sipush",        0x11, 0, 1 },
+	{ "swap",          0x5f, 2, 2 }
 };
 
 static const char *java_types[] = {
@@ -199,37 +175,77 @@ static const char *java_types[] = {
 #define INITIAL_SIZE 1024
 #define JASM_EXT     ".jasmin"
 
-static char   *class_name;    /**< the class name                             */
-static char   *function_name; /**< the name of current function               */
-static char   *jasm_name;     /**< the jasmin file name                       */
-static int     code_size;     /**< the current code array size                */
-static int     ip;            /**< the instruction pointer                    */
-static Body   *bodies;        /**< list of function bodies                    */
-static Code   *code;          /**< the generated code                         */
-static IDPropt *idprop;       /**< id properties of the current function      */
-
-int stack_depth, max_stack_depth;
+static _Thread_local char   *class_name;    /**< the class name               */
+static _Thread_local char   *function_name; /**< the current function         */
+static _Thread_local char   *descriptor;    /**< its descriptor               */
+static _Thread_local int     acc_flags;     /**< its access flags             */
+static _Thread_local char   *jasm_name;     /**< the jasmin file name         */
+static _Thread_local Boolean jasm_written;  /**< whether it has been written  */
+static _Thread_local int     code_size;     /**< the current code array size  */
+static _Thread_local int     ip;            /**< the instruction pointer      */
+static _Thread_local Body   *bodies;        /**< list of function bodies      */
+static _Thread_local Code   *code;          /**< the generated code           */
+static _Thread_local IDPropt *idprop;       /**< the current function's props */
+static _Thread_local Catch  *catches;       /**< its exception handlers       */
+static _Thread_local int     ncatches;      /**< the number of handlers       */
+static _Thread_local Boolean support;       /**< whether it is support      */
+static _Thread_local Label   next_label;    /**< the next label to hand out   */
+static _Thread_local Label   first_label;   /**< the first for this function  */
+static _Thread_local Body   *held;          /**< loaded bodies not yet added  */
+
+_Thread_local int stack_depth, max_stack_depth;
 
 /* --- function prototypes -------------------------------------------------- */
 
 static void ensure_space(int num_instr);
+static void free_code(Code *c, int n);
+static void link_body(Body *body);
+static void free_bodies(Body *list);
+static void put_int(SaveBuf *b, int value);
+static void put_string(SaveBuf *b, const char *string);
+static int get_int(LoadBuf *b);
+static char *get_string(LoadBuf *b);
 static void adjust_stack(BC *instr);
+static void gen_2_ref(Bytecode opcode, CodeType type, char *ref);
+static void gen_runtime(void);
+static char *make_descriptor(IDPropt *p);
+static size_t write_descriptor(char *desc, IDPropt *p);
+static char *make_ref(const char *member);
+static void open_method(const char *name, char *desc, int flags);
 
 /* --- code generation interface -------------------------------------------- */
 
 void init_code_generation(void)
 {
-	bodies = NULL;
+	unsigned int i;
+
+	bodies = held = NULL;
+	jasm_written = FALSE;
+
+	/* nothing is allocated until the class name is set */
+	class_name = jasm_name = NULL;
+	ref_print_boolean = ref_print_integer = ref_print_string = NULL;
+	ref_read_boolean = ref_read_integer = ref_main_body = NULL;
+	for (i = 0; i < NFIELDS; i++) {
+		ref_fields[i] = NULL;
+	}
+	function_name = descriptor = NULL;
+	code = NULL;
+	ip = 0;
+	catches = NULL;
+	next_label = 1;
 }
 
 void init_subroutine_codegen(const char *name, IDPropt *p)
 {
-	max_stack_depth = stack_depth = 0;
-	ip = 0;
-	code = emalloc(sizeof(Code) * INITIAL_SIZE);
-	code_size = INITIAL_SIZE;
-	function_name = estrdup(name);
+	if (p == NULL) {
+		open_method(MAIN_BODY, estrdup("([Ljava/lang/String;)V"),
+				ACC_PUBLIC | ACC_STATIC);
+	} else {
+		open_method(name, make_descriptor(p), ACC_PUBLIC | ACC_STATIC);
+	}
 	idprop = p;
+	support = FALSE;
 }
 
 void close_subroutine_codegen(int varwidth)
@@ -238,71 +254,160 @@ void close_subroutine_codegen(int varwidth)
 
 	body = emalloc(sizeof(Body));
 
+	if (ncatches == 0) {
+		peephole(code, &ip);
+	}
+
 	/* populate new body */
 	body->name = function_name;
+	body->descriptor = descriptor;
+	body->access = acc_flags;
 	body->idprop = idprop;
 	body->code = code;
 	body->ip = ip;
 	body->max_stack_depth = max_stack_depth;
 	body->variables_width = varwidth;
+	body->catches = catches;
+	body->ncatches = ncatches;
+	body->support = support;
+	body->labels = first_label;
+	body->nlabels = next_label - first_label;
+
+	/* the body owns the code of the method from now on */
+	function_name = descriptor = NULL;
+	code = NULL;
+	catches = NULL;
+
+	link_body(body);
+}
 
-	/* link into list */
-	if (bodies != NULL) {
-		bodies->prev = body;
-		body->next = bodies;
-		bodies = body;
-	}else{
-		bodies = body;
-		body->next = NULL;
-		body->prev = NULL;
+void add_body(Body *body)
+{
+	int i;
+
+	/* take the body off the held list */
+	if (body->prev != NULL) {
+		body->prev->next = body->next;
+	} else {
+		held = body->next;
+	}
+	if (body->next != NULL) {
+		body->next->prev = body->prev;
+	}
+
+	/* the labels were loaded relative to the first */
+	for (i = 0; i < body->ip; i++) {
+		if (body->code[i].type & CODE_LABEL) {
+			body->code[i].label += next_label;
+		}
+	}
+	for (i = 0; i < body->ncatches; i++) {
+		body->catches[i].start += next_label;
+		body->catches[i].end += next_label;
+		body->catches[i].handler += next_label;
 	}
+	body->labels = next_label;
+	next_label += body->nlabels;
+
+	link_body(body);
 }
 
 void set_class_name(char *cname)
 {
-	size_t class_name_len;
+	unsigned int i;
+	char *member;
 
 	class_name = estrdup(cname);
-	class_name_len = strlen(class_name);
 
-	jasm_name = emalloc(class_name_len + sizeof(JASM_EXT));
+	jasm_name = emalloc(strlen(class_name) + sizeof(JASM_EXT));
 	strcpy(jasm_name, class_name);
-	strncat(jasm_name, JASM_EXT, sizeof(JASM_EXT));
+	strcat(jasm_name, JASM_EXT);
+
+	ref_print_boolean = make_ref(REF_PRINT_BOOLEAN);
+	ref_print_integer = make_ref(REF_PRINT_INTEGER);
+	ref_print_string = make_ref(REF_PRINT_STRING);
+	ref_read_boolean = make_ref(REF_READ_BOOLEAN);
+	ref_read_integer = make_ref(REF_READ_INTEGER);
+	ref_main_body = make_ref(REF_MAIN_BODY);
+
+	for (i = 0; i < NFIELDS; i++) {
+		member = emalloc(strlen(fields[i].name) +
+				strlen(fields[i].descriptor) + 2);
+		sprintf(member, "%s %s", fields[i].name, fields[i].descriptor);
+		ref_fields[i] = make_ref(member);
+		free(member);
+	}
+
+	gen_runtime();
+}
 
-//#pragma GCC diagnostic ignored "-Wsizeof-pointer-memaccess"
-	ref_read_boolean = emalloc(class_name_len + sizeof(REF_READ_BOOLEAN));
-	strcpy(ref_read_boolean, class_name);
-	strncat(ref_read_boolean, REF_READ_BOOLEAN, sizeof(REF_READ_BOOLEAN));
+Body *get_bodies(void)
+{
+	return bodies;
+}
+
+const char *get_class_name(void)
+{
+	return class_name;
+}
 
-	ref_read_integer = emalloc(class_name_len + sizeof(REF_READ_INTEGER));
-	strcpy(ref_read_integer, class_name);
-	strncat(ref_read_integer, REF_READ_INTEGER, sizeof(REF_READ_INTEGER));
-//#pragma GCC diagnostic warning "-Wsizeof-pointer-memaccess"
+const Field *get_fields(int *nfields)
+{
+	*nfields = NFIELDS;
+	return fields;
 }
 
 void assemble(const char *jasmin_path)
 {
-	int status;
+	const char *failure;
+
+	if ((failure = assemble_files(jasmin_path, &jasm_name, 1, FALSE))
+			!= NULL) {
+		eprintf("%s", failure);
+	}
+}
+
+const char *assemble_files(const char *jasmin_path, char *const *names, int n,
+		Boolean quiet)
+{
+	int i, status, null;
 	pid_t pid;
+	char **args;
+
+	/* java -jar <jasmin_path> <names> */
+	args = emalloc((n + 4) * sizeof(char *));
+	args[0] = "java";
+	args[1] = "-jar";
+	args[2] = (char *) jasmin_path;
+	for (i = 0; i < n; i++) {
+		args[i + 3] = names[i];
+	}
+	args[n + 3] = NULL;
 
 	if ((pid = fork()) < 0) {
 		eprintf("Could not fork a new process for assembler");
 	} else if (pid == 0) {
-		if (execlp("java", "java", "-jar", jasmin_path, jasm_name,
-					(char *) NULL) < 0) {
+		if (quiet && (null = open("/dev/null", O_WRONLY)) >= 0) {
+			dup2(null, STDOUT_FILENO);
+			dup2(null, STDERR_FILENO);
+		}
+		if (execvp("java", args) < 0) {
 			eprintf("Could not exec Jasmin");
 		}
 	}
+	free(args);
 
 	if (waitpid(pid, &status, 0) < 0) {
 		eprintf("Error waiting for Jasmin");
 	} else {
 		if (WIFEXITED(status) && WEXITSTATUS(status) != EXIT_SUCCESS) {
-			eprintf("Jasmin reported failure");
+			return "Jasmin reported failure";
 		} else if (WIFSIGNALED(status) || WIFSTOPPED(status)) {
-			eprintf("Jasmin stopped or terminated abnormally");
+			return "Jasmin stopped or terminated abnormally";
 		}
 	}
+
+	return NULL;
 }
 
 void gen_1(Bytecode opcode)
@@ -328,49 +433,55 @@ void gen_2(Bytecode opcode, int operand)
 	adjust_stack(&instruction_set[opcode]);
 }
 
+void gen_const(int value)
+{
+	if (value >= -1 && value <= 5) {
+		gen_1(JVM_ICONST_0 + value);
+	} else if (value >= SCHAR_MIN && value <= SCHAR_MAX) {
+		gen_2(JVM_BIPUSH, value);
+	} else if (value >= SHRT_MIN && value <= SHRT_MAX) {
+		gen_2(JVM_SIPUSH, value);
+	} else {
+		gen_2(JVM_LDC, value);
+	}
+}
+
 void gen_call(char *fname, IDPropt *idprop)
 {
 	char *fpath;
-	unsigned int i;
+	int n;
 
 	ensure_space(2);
 
 	code[ip].type = CODE_INSTRUCTION;
 	code[ip++].code = JVM_INVOKESTATIC;
 
-	/* 6 + 2 * idprop->nparams:
-	 *  -- 1 for '\0'
-	 *  -- 2 for '(' and ')' of parameter list
-	 *  -- 1 for '.' separating class from method name
-	 *  -- 2 for return type, including possibility of array type
-	 * the multiplier of 2 includes the possibilities of array types
-	 */
-	fpath = emalloc(strlen(class_name) + strlen(fname) +
-			(6 + 2 * idprop->nparams) * sizeof(char));
-	strcpy(fpath, class_name);
-	strcat(fpath, ".");
-	strcat(fpath, fname);
-	strcat(fpath, "(");
-	for (i = 0; i < idprop->nparams; i++) {
-		if (IS_ARRAY_TYPE(idprop->params[i])) {
-			strcat(fpath, "[");
-		}
-		strcat(fpath, "I");
-	}
-	strcat(fpath, ")");
-	if (IS_ARRAY_TYPE(idprop->type)) {
-		strcat(fpath, "[");
-	}
-	if (idprop->type == TYPE_CALLABLE) {
-		strcat(fpath, "V");
-	} else {
-		strcat(fpath, "I");
-	}
+	/* the reference lives as long as the compilation, like the name */
+	fpath = unit_alloc(strlen(class_name) + strlen(fname)
+			+ DESCRIPTOR_SIZE(idprop) + 1);
+	n = sprintf(fpath, "%s/%s", class_name, fname);
+	write_descriptor(fpath + n, idprop);
 
-	code[ip].type = CODE_OPERAND | CODE_REFERENCE | CODE_ALLOCATED;
+	code[ip].type = CODE_OPERAND | CODE_REFERENCE;
 	code[ip++].string = fpath;
 
-	adjust_stack(&instruction_set[JVM_INVOKESTATIC]);
+	/* the arguments are popped, and only a function pushes its result */
+	stack_depth -= idprop->nparams;
+	if (!IS_PROCEDURE(idprop->type)) {
+		stack_depth++;
+	}
+	if (stack_depth > max_stack_depth) {
+		max_stack_depth = stack_depth;
+	}
+}
+
+void gen_catch_all(Label start, Label end, Label handler)
+{
+	catches = erealloc(catches, (ncatches + 1) * sizeof(Catch));
+	catches[ncatches].start = start;
+	catches[ncatches].end = end;
+	catches[ncatches].handler = handler;
+	ncatches++;
 }
 
 void gen_cmp(Bytecode opcode)
@@ -383,10 +494,10 @@ void gen_cmp(Bytecode opcode)
 	l1 = get_label();
 	l2 = get_label();
 	gen_2_label(opcode, l1);
-	gen_2(JVM_LDC, FALSE);
+	gen_const(FALSE);
 	gen_2_label(JVM_GOTO, l2);
 	gen_label(l1);
-	gen_2(JVM_LDC, TRUE);
+	gen_const(TRUE);
 	gen_label(l2);
 }
 
@@ -411,6 +522,19 @@ void gen_2_label(Bytecode opcode, Label label)
 	adjust_stack(&instruction_set[opcode]);
 }
 
+void gen_throw(const char *exception)
+{
+	char *init;
+
+	init = emalloc(strlen(exception) + sizeof("/<init>()V"));
+	sprintf(init, "%s/<init>()V", exception);
+
+	gen_2_ref(JVM_NEW, CODE_REFERENCE | CODE_ALLOCATED, estrdup(exception));
+	gen_1(JVM_DUP);
+	gen_2_ref(JVM_INVOKESPECIAL, CODE_REFERENCE | CODE_ALLOCATED, init);
+	gen_1(JVM_ATHROW);
+}
+
 void gen_newarray(JVMatype atype)
 {
 	ensure_space(2);
@@ -426,19 +550,10 @@ void gen_newarray(JVMatype atype)
 
 void gen_print(ValType type)
 {
-	ensure_space(5);
-
-	code[ip].type = CODE_INSTRUCTION;
-	code[ip++].code = JVM_GETSTATIC;
-
-	code[ip].type = CODE_OPERAND | CODE_REFERENCE;
-	code[ip++].string = ref_print_stream;
-
-	code[ip].type = CODE_INSTRUCTION;
-	code[ip++].code = JVM_SWAP;
+	ensure_space(2);
 
 	code[ip].type = CODE_INSTRUCTION;
-	code[ip++].code = JVM_INVOKEVIRTUAL;
+	code[ip++].code = JVM_INVOKESTATIC;
 
 	code[ip].type = CODE_OPERAND | CODE_REFERENCE;
 	if (IS_CALLABLE_TYPE(type)) {
@@ -452,36 +567,29 @@ void gen_print(ValType type)
 		assert(FALSE);
 	}
 
-	adjust_stack(&instruction_set[JVM_GETSTATIC]);
-	adjust_stack(&instruction_set[JVM_SWAP]);
-	adjust_stack(&instruction_set[JVM_INVOKEVIRTUAL]);
+	/* the value is popped, and nothing is pushed */
+	stack_depth--;
 }
 
 void gen_print_string(char *string)
 {
-	ensure_space(6);
-
-	code[ip].type = CODE_INSTRUCTION;
-	code[ip++].code = JVM_GETSTATIC;
-
-	code[ip].type = CODE_OPERAND | CODE_REFERENCE;
-	code[ip++].string = ref_print_stream;
+	ensure_space(4);
 
 	code[ip].type = CODE_INSTRUCTION;
 	code[ip++].code = JVM_LDC;
 
-	code[ip].type = CODE_OPERAND | CODE_STRING | CODE_ALLOCATED;
+	code[ip].type = CODE_OPERAND | CODE_STRING;
 	code[ip++].string = string;
 
 	code[ip].type = CODE_INSTRUCTION;
-	code[ip++].code = JVM_INVOKEVIRTUAL;
+	code[ip++].code = JVM_INVOKESTATIC;
 
 	code[ip].type = CODE_OPERAND | CODE_REFERENCE;
 	code[ip++].string = ref_print_string;
 
-	adjust_stack(&instruction_set[JVM_GETSTATIC]);
+	/* the string is pushed, and popped again by the call */
 	adjust_stack(&instruction_set[JVM_LDC]);
-	adjust_stack(&instruction_set[JVM_INVOKEVIRTUAL]);
+	stack_depth--;
 }
 
 void gen_read(ValType type)
@@ -505,8 +613,7 @@ void gen_read(ValType type)
 
 Label get_label(void)
 {
-	static Label label = 1;
-	return label++;
+	return next_label++;
 }
 
 const char *get_opcode_string(Bytecode opcode)
@@ -518,6 +625,200 @@ const char *get_opcode_string(Bytecode opcode)
 	}
 }
 
+unsigned char get_opcode_value(Bytecode opcode)
+{
+	assert((unsigned long) opcode < NBYTECODES);
+	return instruction_set[opcode].value;
+}
+
+/* --- saved bodies --------------------------------------------------------- */
+
+unsigned char *save_body(const Body *body, size_t *len)
+{
+	int i;
+	unsigned int k;
+	SaveBuf b;
+	const Code *c;
+
+	b.size = 256 + 2 * sizeof(int) * body->ip;
+	b.data = emalloc(b.size);
+	b.len = 0;
+
+	put_int(&b, BODY_MAGIC);
+	put_int(&b, body->idprop != NULL);
+	if (body->idprop != NULL) {
+		put_int(&b, body->idprop->type);
+		put_int(&b, body->idprop->nparams);
+		for (k = 0; k < body->idprop->nparams; k++) {
+			put_int(&b, body->idprop->params[k]);
+		}
+	}
+	put_string(&b, body->name);
+	put_string(&b, body->descriptor);
+	put_int(&b, body->access);
+	put_int(&b, body->max_stack_depth);
+	put_int(&b, body->variables_width);
+	put_int(&b, body->support);
+	put_int(&b, body->nlabels);
+
+	put_int(&b, body->ncatches);
+	for (i = 0; i < body->ncatches; i++) {
+		put_int(&b, body->catches[i].start - body->labels);
+		put_int(&b, body->catches[i].end - body->labels);
+		put_int(&b, body->catches[i].handler - body->labels);
+	}
+
+	put_int(&b, body->ip);
+	for (i = 0; i < body->ip; i++) {
+		c = &body->code[i];
+		put_int(&b, c->type & ~MASK_ALLOCATION);
+		switch (c->type & ~MASK_ALLOCATION) {
+			case CODE_INSTRUCTION:
+				put_int(&b, c->code);
+				break;
+			case CODE_LABEL:
+			case CODE_OPERAND | CODE_LABEL:
+				put_int(&b, c->label - body->labels);
+				break;
+			case CODE_OPERAND | CODE_INTEGER:
+				put_int(&b, c->num);
+				break;
+			case CODE_OPERAND | CODE_ARRAY_TYPE:
+				put_int(&b, c->atype);
+				break;
+			default:
+				put_string(&b, c->string);
+				break;
+		}
+	}
+
+	*len = b.len;
+	return b.data;
+}
+
+Body *load_body(const unsigned char *data, size_t len, IDPropt *prop)
+{
+	int i, n, type;
+	unsigned int k;
+	LoadBuf b;
+	Body *body;
+	IDPropt p;
+	Code *c;
+
+	b.p = data;
+	b.end = data + len;
+	b.ok = TRUE;
+	if (get_int(&b) != BODY_MAGIC) {
+		return NULL;
+	}
+
+	body = emalloc(sizeof(Body));
+	memset(body, 0, sizeof(Body));
+	p.params = NULL;
+
+	/* every count is checked against what is left, before it is used */
+	if (get_int(&b)) {
+		p.type = get_int(&b);
+		p.nparams = get_int(&b);
+		if (!b.ok || p.nparams > (size_t) (b.end - b.p) / sizeof(int)) {
+			goto fail;
+		}
+		p.params = unit_alloc((p.nparams + 1) * sizeof(ValType));
+		for (k = 0; k < p.nparams; k++) {
+			p.params[k] = get_int(&b);
+		}
+		body->idprop = prop;
+	}
+	body->name = get_string(&b);
+	body->descriptor = get_string(&b);
+	body->access = get_int(&b);
+	body->max_stack_depth = get_int(&b);
+	body->variables_width = get_int(&b);
+	body->support = get_int(&b);
+	body->nlabels = get_int(&b);
+
+	n = get_int(&b);
+	if (!b.ok || n < 0 || (size_t) n > (size_t) (b.end - b.p) / sizeof(int)) {
+		goto fail;
+	}
+	body->catches = (n > 0 ? emalloc(n * sizeof(Catch)) : NULL);
+	body->ncatches = n;
+	for (i = 0; i < n; i++) {
+		body->catches[i].start = get_int(&b);
+		body->catches[i].end = get_int(&b);
+		body->catches[i].handler = get_int(&b);
+		if (body->catches[i].start >= body->nlabels
+				|| body->catches[i].end >= body->nlabels
+				|| body->catches[i].handler >= body->nlabels) {
+			goto fail;
+		}
+	}
+
+	n = get_int(&b);
+	if (!b.ok || n < 0 || (size_t) n > (size_t) (b.end - b.p) / sizeof(int)) {
+		goto fail;
+	}
+	body->code = emalloc((n + 1) * sizeof(Code));
+	for (i = 0; i < n; i++) {
+		c = &body->code[i];
+		type = get_int(&b);
+		switch (type) {
+			case CODE_INSTRUCTION:
+				c->code = get_int(&b);
+				if ((unsigned long) c->code >= NBYTECODES) {
+					goto fail;
+				}
+				break;
+			case CODE_LABEL:
+			case CODE_OPERAND | CODE_LABEL:
+				c->label = get_int(&b);
+				if (c->label >= body->nlabels) {
+					goto fail;
+				}
+				break;
+			case CODE_OPERAND | CODE_INTEGER:
+				c->num = get_int(&b);
+				break;
+			case CODE_OPERAND | CODE_ARRAY_TYPE:
+				c->atype = get_int(&b);
+				break;
+			case CODE_OPERAND | CODE_STRING:
+			case CODE_OPERAND | CODE_REFERENCE:
+				if ((c->string = get_string(&b)) == NULL) {
+					goto fail;
+				}
+				type |= CODE_ALLOCATED;
+				break;
+			default:
+				goto fail;
+		}
+		c->type = type;
+		body->ip = i + 1;
+	}
+	if (!b.ok || b.p != b.end || body->name == NULL
+			|| body->descriptor == NULL) {
+		goto fail;
+	}
+
+	if (body->idprop != NULL) {
+		*prop = p;
+	}
+
+	/* hold the body until it is added */
+	body->prev = NULL;
+	body->next = held;
+	if (held != NULL) {
+		held->prev = body;
+	}
+	held = body;
+
+	return body;
+
+fail:
+	free_bodies(body);
+	return NULL;
+}
+
 /* --- code dumping --------------------------------------------------------- */
 
 static void dump_code(FILE *file);
@@ -553,10 +854,116 @@ void make_code_file(void)
 	dump_code(obj_file);
 
 	fclose(obj_file);
+	jasm_written = TRUE;
+}
+
+char *keep_code_file(void)
+{
+	jasm_written = FALSE;
+	return estrdup(jasm_name);
 }
 
 /* --- utility functions ---------------------------------------------------- */
 
+/**
+ * Links a body into the front of the list of method bodies.
+ */
+static void link_body(Body *body)
+{
+	if (bodies != NULL) {
+		bodies->prev = body;
+	}
+	body->next = bodies;
+	body->prev = NULL;
+	bodies = body;
+}
+
+/**
+ * Frees a list of method bodies.
+ */
+static void free_bodies(Body *list)
+{
+	Body *b, *d;
+
+	for (b = list; b; b = d) {
+		d = b->next;
+		free_code(b->code, b->ip);
+		free(b->name);
+		free(b->descriptor);
+		free(b->catches);
+		free(b);
+	}
+}
+
+/**
+ * Appends an integer to a saved body.
+ */
+static void put_int(SaveBuf *b, int value)
+{
+	if (b->len + sizeof(int) > b->size) {
+		b->size *= 2;
+		b->data = erealloc(b->data, b->size);
+	}
+	memcpy(b->data + b->len, &value, sizeof(int));
+	b->len += sizeof(int);
+}
+
+/**
+ * Appends a string to a saved body, preceded by its length.
+ */
+static void put_string(SaveBuf *b, const char *string)
+{
+	size_t n;
+
+	n = strlen(string);
+	put_int(b, (int) n);
+	while (b->len + n > b->size) {
+		b->size *= 2;
+		b->data = erealloc(b->data, b->size);
+	}
+	memcpy(b->data + b->len, string, n);
+	b->len += n;
+}
+
+/**
+ * Reads an integer from a saved body, or 0 if it has run out.
+ */
+static int get_int(LoadBuf *b)
+{
+	int value;
+
+	if (b->end - b->p < (ptrdiff_t) sizeof(int)) {
+		b->ok = FALSE;
+		return 0;
+	}
+	memcpy(&value, b->p, sizeof(int));
+	b->p += sizeof(int);
+
+	return value;
+}
+
+/**
+ * Reads a string from a saved body into newly allocated memory, or returns
+ * NULL if it has run out.
+ */
+static char *get_string(LoadBuf *b)
+{
+	int n;
+	char *string;
+
+	n = get_int(b);
+	if (!b->ok || n < 0 || b->end - b->p < n) {
+		b->ok = FALSE;
+		return NULL;
+	}
+	string = emalloc(n + 1);
+	memcpy(string, b->p, n);
+	string[n] = '\0';
+	b->p += n;
+
+	return string;
+}
+
 static void ensure_space(int num_instr)
 {
 	if (ip + num_instr > code_size) {
@@ -565,6 +972,24 @@ static void ensure_space(int num_instr)
 	}
 }
 
+/**
+ * Frees a code array, with the strings that its items own.
+ *
+ * @param[in] c the code array.
+ * @param[in] n the number of items in the code array.
+ */
+static void free_code(Code *c, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++) {
+		if (c[i].type & CODE_ALLOCATED) {
+			free(c[i].string);
+		}
+	}
+	free(c);
+}
+
 /**
  * Computes the net change in the stack depth caused by the instruction, and
  * updates the maximum stack depth if necessary.
@@ -581,36 +1006,464 @@ static void adjust_stack(BC *instr)
 }
 
 /**
- * Writes a method to the Jasmin output file.
+ * Generates an instruction with a reference or string constant operand.
  *
- * @param[in] file the output file.
- * @param[in] b    the body of the method
+ * @param[in] opcode the bytecode instruction.
+ * @param[in] type   the data type (and allocation) of the operand.
+ * @param[in] ref    the reference or string.
  */
-static void dump_method(FILE *file, Body *b)
+static void gen_2_ref(Bytecode opcode, CodeType type, char *ref)
 {
-	int i;
-	unsigned int k;
+	ensure_space(2);
 
-	if (strcmp(b->name, "main") == 0) {
+	code[ip].type = CODE_INSTRUCTION;
+	code[ip++].code = opcode;
 
-		fprintf(file, ".method public static main([Ljava/lang/String;)V\n");
+	code[ip].type = CODE_OPERAND | type;
+	code[ip++].string = ref;
 
-	} else {
+	adjust_stack(&instruction_set[opcode]);
+}
 
-		fprintf(file, ".method public static %s(", b->name);
-		for (k = 0; k < b->idprop->nparams; k++) {
-			if (IS_ARRAY(b->idprop->params[k])) {
-				fputs("[", file);
-			}
-			fputs("I", file);
-		}
-		fprintf(file, ")%s%s\n",
-				(IS_ARRAY_TYPE(b->idprop->type) ? "[" : ""),
-				(b->idprop->type == TYPE_CALLABLE ? "V" : "I"));
+/**
+ * Returns a newly allocated JVM method descriptor for a subroutine.
+ *
+ * @param[in] p the properties of the function or procedure identifier.
+ * @return    the method descriptor.
+ */
+static char *make_descriptor(IDPropt *p)
+{
+	char *desc;
+
+	desc = emalloc(DESCRIPTOR_SIZE(p));
+	write_descriptor(desc, p);
+
+	return desc;
+}
+
+/**
+ * Writes the JVM method descriptor for a subroutine, which takes at most
+ * <code>DESCRIPTOR_SIZE(p)</code> bytes.
+ *
+ * @param[out] desc the space for the descriptor.
+ * @param[in]  p    the properties of the function or procedure identifier.
+ * @return     the length of the descriptor.
+ */
+static size_t write_descriptor(char *desc, IDPropt *p)
+{
+	char *d;
+	unsigned int i;
 
+	d = desc;
+	*d++ = '(';
+	for (i = 0; i < p->nparams; i++) {
+		if (IS_ARRAY_TYPE(p->params[i])) {
+			*d++ = '[';
+		}
+		*d++ = 'I';
+	}
+	*d++ = ')';
+	if (IS_ARRAY_TYPE(p->type)) {
+		*d++ = '[';
 	}
+	*d++ = (p->type == TYPE_CALLABLE ? 'V' : 'I');
+	*d = '\0';
+
+	return d - desc;
+}
+
+/**
+ * Returns a newly allocated reference to a member of the generated class.
+ *
+ * @param[in] member the member name and descriptor.
+ * @return    the reference, qualified with the class name.
+ */
+static char *make_ref(const char *member)
+{
+	char *ref;
+
+	ref = emalloc(strlen(class_name) + strlen(member) + 2);
+	sprintf(ref, "%s/%s", class_name, member);
+
+	return ref;
+}
+
+/**
+ * Starts a new code array for a method.
+ *
+ * @param[in] name  the method name.
+ * @param[in] desc  the (allocated) method descriptor.
+ * @param[in] flags the access flags of the method.
+ */
+static void open_method(const char *name, char *desc, int flags)
+{
+	max_stack_depth = stack_depth = 0;
+	ip = 0;
+	code = emalloc(sizeof(Code) * INITIAL_SIZE);
+	code_size = INITIAL_SIZE;
+	function_name = estrdup(name);
+	descriptor = desc;
+	acc_flags = flags;
+	idprop = NULL;
+	catches = NULL;
+	ncatches = 0;
+	support = TRUE;
+	first_label = next_label;
+}
+
+/**
+ * Generates the methods of the runtime support code: the class initialiser
+ * that sets up the input scanner and the output buffer, the default
+ * constructor, the main method, and the methods for reading from standard input
+ * and writing to standard output.  Since the stack effects of the
+ * object-oriented instructions are not tracked exactly, the stack limits of
+ * these methods are set explicitly.
+ *
+ * Standard output is a print stream without automatic flushing, over a large
+ * buffer, so that output costs neither a lock on System.out nor a flush per
+ * item.  The main method calls the body of main, and flushes the buffer when
+ * the body returns or throws.
+ */
+static void gen_runtime(void)
+{
+	Label l1, l2, l3, l4, l5, l6, l7;
+
+	/* class initialiser */
+	open_method("<clinit>", estrdup("()V"), ACC_PUBLIC | ACC_STATIC);
+	gen_2_ref(JVM_GETSTATIC, CODE_REFERENCE,
+			"java/lang/System/in Ljava/io/InputStream;");
+	gen_2_ref(JVM_PUTSTATIC, CODE_REFERENCE, REF_STDIN);
+	gen_const(INPUT_BUFFER_SIZE);
+	gen_newarray(T_BYTE);
+	gen_2_ref(JVM_PUTSTATIC, CODE_REFERENCE, REF_INPUT_BUFFER);
+	gen_2_ref(JVM_NEW, CODE_REFERENCE, "java/io/PrintStream");
+	gen_1(JVM_DUP);
+	gen_2_ref(JVM_NEW, CODE_REFERENCE, "java/io/BufferedOutputStream");
+	gen_1(JVM_DUP);
+	gen_2_ref(JVM_NEW, CODE_REFERENCE, "java/io/FileOutputStream");
+	gen_1(JVM_DUP);
+	gen_2_ref(JVM_GETSTATIC, CODE_REFERENCE,
+			"java/io/FileDescriptor/out Ljava/io/FileDescriptor;");
+	gen_2_ref(JVM_INVOKESPECIAL, CODE_REFERENCE,
+			"java/io/FileOutputStream/<init>(Ljava/io/FileDescriptor;)V");
+	gen_const(OUTPUT_BUFFER_SIZE);
+	gen_2_ref(JVM_INVOKESPECIAL, CODE_REFERENCE,
+			"java/io/BufferedOutputStream/<init>(Ljava/io/OutputStream;I)V");
+	gen_const(FALSE);
+	gen_2_ref(JVM_INVOKESPECIAL, CODE_REFERENCE,
+			"java/io/PrintStream/<init>(Ljava/io/OutputStream;Z)V");
+	gen_2_ref(JVM_PUTSTATIC, CODE_REFERENCE, REF_OUT);
+	gen_1(JVM_RETURN);
+	max_stack_depth = 7;
+	close_subroutine_codegen(1);
+
+	/* default constructor */
+	open_method("<init>", estrdup("()V"), ACC_PUBLIC);
+	gen_2(JVM_ALOAD, 0);
+	gen_2_ref(JVM_INVOKESPECIAL, CODE_REFERENCE,
+			"java/lang/Object/<init>()V");
+	gen_1(JVM_RETURN);
+	max_stack_depth = 1;
+	close_subroutine_codegen(1);
+
+	/* main: run the body of main, and flush the output however it ends */
+	l1 = get_label();
+	l2 = get_label();
+	l3 = get_label();
+	open_method("main", estrdup("([Ljava/lang/String;)V"),
+			ACC_PUBLIC | ACC_STATIC);
+	gen_label(l1);
+	gen_2(JVM_ALOAD, 0);
+	gen_2_ref(JVM_INVOKESTATIC, CODE_REFERENCE, ref_main_body);
+	gen_label(l2);
+	gen_2_ref(JVM_GETSTATIC, CODE_REFERENCE, REF_OUT);
+	gen_2_ref(JVM_INVOKEVIRTUAL, CODE_REFERENCE,
+			"java/io/PrintStream/flush()V");
+	gen_1(JVM_RETURN);
+	gen_label(l3);
+	gen_2_ref(JVM_GETSTATIC, CODE_REFERENCE, REF_OUT);
+	gen_2_ref(JVM_INVOKEVIRTUAL, CODE_REFERENCE,
+			"java/io/PrintStream/flush()V");
+	gen_1(JVM_ATHROW);
+	gen_catch_all(l1, l2, l3);
+	max_stack_depth = 2;
+	close_subroutine_codegen(1);
+
+	/* print an integer, a Boolean, and a string */
+	open_method("print$", estrdup("(I)V"), ACC_PUBLIC | ACC_STATIC);
+	gen_2_ref(JVM_GETSTATIC, CODE_REFERENCE, REF_OUT);
+	gen_2(JVM_ILOAD, 0);
+	gen_2_ref(JVM_INVOKEVIRTUAL, CODE_REFERENCE,
+			"java/io/PrintStream/print(I)V");
+	gen_1(JVM_RETURN);
+	max_stack_depth = 2;
+	close_subroutine_codegen(1);
+
+	open_method("print$", estrdup("(Z)V"), ACC_PUBLIC | ACC_STATIC);
+	gen_2_ref(JVM_GETSTATIC, CODE_REFERENCE, REF_OUT);
+	gen_2(JVM_ILOAD, 0);
+	gen_2_ref(JVM_INVOKEVIRTUAL, CODE_REFERENCE,
+			"java/io/PrintStream/print(Z)V");
+	gen_1(JVM_RETURN);
+	max_stack_depth = 2;
+	close_subroutine_codegen(1);
+
+	open_method("print$", estrdup("(Ljava/lang/String;)V"),
+			ACC_PUBLIC | ACC_STATIC);
+	gen_2_ref(JVM_GETSTATIC, CODE_REFERENCE, REF_OUT);
+	gen_2(JVM_ALOAD, 0);
+	gen_2_ref(JVM_INVOKEVIRTUAL, CODE_REFERENCE,
+			"java/io/PrintStream/print(Ljava/lang/String;)V");
+	gen_1(JVM_RETURN);
+	max_stack_depth = 2;
+	close_subroutine_codegen(1);
+
+	/* read the next byte of input, or -1 at the end of the input */
+	l1 = get_label();
+	open_method("readByte$", estrdup("()I"), ACC_PUBLIC | ACC_STATIC);
+	gen_2_ref(JVM_GETSTATIC, CODE_REFERENCE, REF_INPUT_POS);
+	gen_2_ref(JVM_GETSTATIC, CODE_REFERENCE, REF_INPUT_LENGTH);
+	gen_2_label(JVM_IF_ICMPLT, l1);
+	gen_2_ref(JVM_GETSTATIC, CODE_REFERENCE, REF_STDIN);
+	gen_2_ref(JVM_GETSTATIC, CODE_REFERENCE, REF_INPUT_BUFFER);
+	gen_const(0);
+	gen_2_ref(JVM_GETSTATIC, CODE_REFERENCE, REF_INPUT_BUFFER);
+	gen_1(JVM_ARRAYLENGTH);
+	gen_2_ref(JVM_INVOKEVIRTUAL, CODE_REFERENCE,
+			"java/io/InputStream/read([BII)I");
+	gen_2_ref(JVM_PUTSTATIC, CODE_REFERENCE, REF_INPUT_LENGTH);
+	gen_const(0);
+	gen_2_ref(JVM_PUTSTATIC, CODE_REFERENCE, REF_INPUT_POS);
+	gen_2_ref(JVM_GETSTATIC, CODE_REFERENCE, REF_INPUT_LENGTH);
+	gen_2_label(JVM_IFGT, l1);
+	gen_const(-1);
+	gen_1(JVM_IRETURN);
+	gen_label(l1);
+	gen_2_ref(JVM_GETSTATIC, CODE_REFERENCE, REF_INPUT_BUFFER);
+	gen_2_ref(JVM_GETSTATIC, CODE_REFERENCE, REF_INPUT_POS);
+	gen_1(JVM_BALOAD);
+	gen_const(UCHAR_MAX);
+	gen_1(JVM_IAND);
+	gen_2_ref(JVM_GETSTATIC, CODE_REFERENCE, REF_INPUT_POS);
+	gen_const(1);
+	gen_1(JVM_IADD);
+	gen_2_ref(JVM_PUTSTATIC, CODE_REFERENCE, REF_INPUT_POS);
+	gen_1(JVM_IRETURN);
+	max_stack_depth = 4;
+	close_subroutine_codegen(1);
+
+	/* skip white space, and return the first byte of the next token */
+	l1 = get_label();
+	l2 = get_label();
+	open_method("skipSpace$", estrdup("()I"), ACC_PUBLIC | ACC_STATIC);
+	gen_label(l1);
+	gen_2_ref(JVM_INVOKESTATIC, CODE_REFERENCE | CODE_ALLOCATED,
+			make_ref(REF_READ_BYTE));
+	gen_2(JVM_ISTORE, 0);
+	gen_2(JVM_ILOAD, 0);
+	gen_const(' ');
+	gen_2_label(JVM_IF_ICMPGT, l2);
+	gen_2(JVM_ILOAD, 0);
+	gen_2_label(JVM_IFGE, l1);
+	gen_throw("java/util/NoSuchElementException");
+	gen_label(l2);
+	gen_2(JVM_ILOAD, 0);
+	gen_1(JVM_IRETURN);
+	max_stack_depth = 2;
+	close_subroutine_codegen(1);
+
+	/* check that the rest of the token is the rest of a lower-case word,
+	 * in any case
+	 */
+	l1 = get_label();
+	l2 = get_label();
+	l3 = get_label();
+	open_method("readWord$", estrdup("(Ljava/lang/String;)Z"),
+			ACC_PUBLIC | ACC_STATIC);
+	gen_const(1);
+	gen_2(JVM_ISTORE, 1);
+	gen_label(l1);
+	gen_2_ref(JVM_INVOKESTATIC, CODE_REFERENCE | CODE_ALLOCATED,
+			make_ref(REF_READ_BYTE));
+	gen_2(JVM_ISTORE, 2);
+	gen_2(JVM_ILOAD, 1);
+	gen_2(JVM_ALOAD, 0);
+	gen_2_ref(JVM_INVOKEVIRTUAL, CODE_REFERENCE,
+			"java/lang/String/length()I");
+	gen_2_label(JVM_IF_ICMPGE, l2);
+	gen_2(JVM_ILOAD, 2);
+	gen_const('a' - 'A');
+	gen_1(JVM_IOR);
+	gen_2(JVM_ALOAD, 0);
+	gen_2(JVM_ILOAD, 1);
+	gen_2_ref(JVM_INVOKEVIRTUAL, CODE_REFERENCE,
+			"java/lang/String/charAt(I)C");
+	gen_2_label(JVM_IF_ICMPNE, l3);
+	gen_2(JVM_ILOAD, 1);
+	gen_const(1);
+	gen_1(JVM_IADD);
+	gen_2(JVM_ISTORE, 1);
+	gen_2_label(JVM_GOTO, l1);
+	gen_label(l2);
+	gen_2(JVM_ILOAD, 2);
+	gen_const(' ');
+	gen_2_label(JVM_IF_ICMPGT, l3);
+	gen_const(TRUE);
+	gen_1(JVM_IRETURN);
+	gen_label(l3);
+	gen_const(FALSE);
+	gen_1(JVM_IRETURN);
+	max_stack_depth = 3;
+	close_subroutine_codegen(3);
+
+	/* read an integer: an optional sign and decimal digits, accumulated as
+	 * a negative number against a limit, so that the minimum integer can be
+	 * read and overflow is caught
+	 */
+	l1 = get_label();
+	l2 = get_label();
+	l3 = get_label();
+	l4 = get_label();
+	l5 = get_label();
+	l6 = get_label();
+	l7 = get_label();
+	open_method("readInt", estrdup("()I"), ACC_PUBLIC | ACC_STATIC);
+	gen_2_ref(JVM_INVOKESTATIC, CODE_REFERENCE | CODE_ALLOCATED,
+			make_ref(REF_SKIP_SPACE));
+	gen_2(JVM_ISTORE, 0);
+	gen_const(FALSE);
+	gen_2(JVM_ISTORE, 1);
+	gen_const(-INT_MAX);
+	gen_2(JVM_ISTORE, 3);
+	gen_2(JVM_ILOAD, 0);
+	gen_const('-');
+	gen_2_label(JVM_IF_ICMPNE, l1);
+	gen_const(TRUE);
+	gen_2(JVM_ISTORE, 1);
+	gen_const(INT_MIN);
+	gen_2(JVM_ISTORE, 3);
+	gen_2_label(JVM_GOTO, l2);
+	gen_label(l1);
+	gen_2(JVM_ILOAD, 0);
+	gen_const('+');
+	gen_2_label(JVM_IF_ICMPNE, l3);
+	gen_label(l2);
+	gen_2_ref(JVM_INVOKESTATIC, CODE_REFERENCE | CODE_ALLOCATED,
+			make_ref(REF_READ_BYTE));
+	gen_2(JVM_ISTORE, 0);
+	gen_label(l3);
+	gen_const(0);
+	gen_2(JVM_ISTORE, 2);
+	gen_2(JVM_ILOAD, 0);
+	gen_const('0');
+	gen_2_label(JVM_IF_ICMPLT, l6);
+	gen_2(JVM_ILOAD, 0);
+	gen_const('9');
+	gen_2_label(JVM_IF_ICMPGT, l6);
+	gen_label(l4);
+	gen_2(JVM_ILOAD, 0);
+	gen_const('0');
+	gen_1(JVM_ISUB);
+	gen_2(JVM_ISTORE, 4);
+	gen_2(JVM_ILOAD, 2);
+	gen_2(JVM_ILOAD, 3);
+	gen_const(10);
+	gen_1(JVM_IDIV);
+	gen_2_label(JVM_IF_ICMPLT, l6);
+	gen_2(JVM_ILOAD, 2);
+	gen_const(10);
+	gen_1(JVM_IMUL);
+	gen_2(JVM_ISTORE, 2);
+	gen_2(JVM_ILOAD, 2);
+	gen_2(JVM_ILOAD, 3);
+	gen_2(JVM_ILOAD, 4);
+	gen_1(JVM_IADD);
+	gen_2_label(JVM_IF_ICMPLT, l6);
+	gen_2(JVM_ILOAD, 2);
+	gen_2(JVM_ILOAD, 4);
+	gen_1(JVM_ISUB);
+	gen_2(JVM_ISTORE, 2);
+	gen_2_ref(JVM_INVOKESTATIC, CODE_REFERENCE | CODE_ALLOCATED,
+			make_ref(REF_READ_BYTE));
+	gen_2(JVM_ISTORE, 0);
+	gen_2(JVM_ILOAD, 0);
+	gen_const('0');
+	gen_2_label(JVM_IF_ICMPLT, l5);
+	gen_2(JVM_ILOAD, 0);
+	gen_const('9');
+	gen_2_label(JVM_IF_ICMPLE, l4);
+	gen_label(l5);
+	gen_2(JVM_ILOAD, 0);
+	gen_const(' ');
+	gen_2_label(JVM_IF_ICMPGT, l6);
+	gen_2(JVM_ILOAD, 1);
+	gen_2_label(JVM_IFEQ, l7);
+	gen_2(JVM_ILOAD, 2);
+	gen_1(JVM_IRETURN);
+	gen_label(l7);
+	gen_2(JVM_ILOAD, 2);
+	gen_1(JVM_INEG);
+	gen_1(JVM_IRETURN);
+	gen_label(l6);
+	gen_throw("java/util/InputMismatchException");
+	max_stack_depth = 3;
+	close_subroutine_codegen(5);
+
+	/* read a Boolean, accepting "true" or "false" in any case */
+	l1 = get_label();
+	l2 = get_label();
+	open_method("readBoolean", estrdup("()Z"), ACC_PUBLIC | ACC_STATIC);
+	gen_2_ref(JVM_INVOKESTATIC, CODE_REFERENCE | CODE_ALLOCATED,
+			make_ref(REF_SKIP_SPACE));
+	gen_const('a' - 'A');
+	gen_1(JVM_IOR);
+	gen_2(JVM_ISTORE, 0);
+	gen_2(JVM_ILOAD, 0);
+	gen_const('t');
+	gen_2_label(JVM_IF_ICMPNE, l1);
+	gen_2_ref(JVM_LDC, CODE_STRING, "true");
+	gen_2_ref(JVM_INVOKESTATIC, CODE_REFERENCE | CODE_ALLOCATED,
+			make_ref(REF_READ_WORD));
+	gen_2_label(JVM_IFEQ, l2);
+	gen_const(TRUE);
+	gen_1(JVM_IRETURN);
+	gen_label(l1);
+	gen_2(JVM_ILOAD, 0);
+	gen_const('f');
+	gen_2_label(JVM_IF_ICMPNE, l2);
+	gen_2_ref(JVM_LDC, CODE_STRING, "false");
+	gen_2_ref(JVM_INVOKESTATIC, CODE_REFERENCE | CODE_ALLOCATED,
+			make_ref(REF_READ_WORD));
+	gen_2_label(JVM_IFEQ, l2);
+	gen_const(FALSE);
+	gen_1(JVM_IRETURN);
+	gen_label(l2);
+	gen_throw("java/util/InputMismatchException");
+	max_stack_depth = 2;
+	close_subroutine_codegen(1);
+}
+
+/**
+ * Writes a method to the Jasmin output file.
+ *
+ * @param[in] file the output file.
+ * @param[in] b    the body of the method
+ */
+static void dump_method(FILE *file, Body *b)
+{
+	int i;
+
+	fprintf(file, ".method %s%s%s%s\n",
+			(b->access & ACC_PUBLIC ? "public " : ""),
+			(b->access & ACC_STATIC ? "static " : ""),
+			b->name, b->descriptor);
 	fprintf(file, ".limit stack %d\n", b->max_stack_depth);
 	fprintf(file, ".limit locals %d\n", b->variables_width);
+	for (i = 0; i < b->ncatches; i++) {
+		fprintf(file, ".catch all from L%d to L%d using L%d\n",
+				b->catches[i].start, b->catches[i].end,
+				b->catches[i].handler);
+	}
 
 	for (i = 0; i < b->ip; i++) {
 
@@ -627,10 +1480,21 @@ static void dump_method(FILE *file, Body *b)
 				fprintf(file, "\t%s", get_opcode_string(c.code));
 				switch (c.code) {
 					case JVM_ARETURN:
+					case JVM_ARRAYLENGTH:
+					case JVM_ATHROW:
+					case JVM_BALOAD:
+					case JVM_DUP:
 					case JVM_IADD:
 					case JVM_IALOAD:
 					case JVM_IAND:
 					case JVM_IASTORE:
+					case JVM_ICONST_M1:
+					case JVM_ICONST_0:
+					case JVM_ICONST_1:
+					case JVM_ICONST_2:
+					case JVM_ICONST_3:
+					case JVM_ICONST_4:
+					case JVM_ICONST_5:
 					case JVM_IDIV:
 					case JVM_IMUL:
 					case JVM_INEG:
@@ -639,6 +1503,8 @@ static void dump_method(FILE *file, Body *b)
 					case JVM_IREM:
 					case JVM_IRETURN:
 					case JVM_IXOR:
+					case JVM_NOP:
+					case JVM_POP:
 					case JVM_RETURN:
 					case JVM_SWAP:
 						/* emit linefeed */
@@ -687,39 +1553,63 @@ static void dump_method(FILE *file, Body *b)
 /**
  * Writes the preamble to the Jasmin output file.  The preamble consists of (i)
  * the class name and visibility specifier, (ii) the superclass, and (iii) the
- * default initialiser (constructor).
+ * static fields used by the runtime support code.
  *
  * @param[in] file the output file.
  * @param[in] name the name of the class.
  */
 static void dump_preamble(FILE *file, char *name)
 {
-	fprintf(file, class_preamble, name, name, name, name, name, name, name);
-	fputs(method_init, file);
-	fprintf(file, method_readInt, name);
-	fprintf(file, method_readBoolean, name);
+	unsigned int i;
+
+	fprintf(file, class_preamble, name);
+	for (i = 0; i < NFIELDS; i++) {
+		fprintf(file, ".field %s%s%s%s %s\n",
+				(fields[i].access & ACC_PRIVATE ? "private " : ""),
+				(fields[i].access & ACC_STATIC ? "static " : ""),
+				(fields[i].access & ACC_FINAL ? "final " : ""),
+				fields[i].name, fields[i].descriptor);
+	}
+	fprintf(file, "\n");
 }
 
 void release_code_generation(void)
 {
-	int i;
-	Body *b, *d;
+	unsigned int k;
 
 	/* remove Jasmin file */
 #ifndef DEBUG_CODEGEN
-	unlink(jasm_name);
+	if (jasm_written) {
+		unlink(jasm_name);
+	}
 #endif
 
-	/* free bodies */
-	for (b = bodies; b; b = d) {
-		d = b->next;
-		free(b->name);
-		free(b->code);
-		free(b);
+	free_bodies(bodies);
+	free_bodies(held);
+	bodies = held = NULL;
+
+	/* free the method that was left open, if any */
+	if (code != NULL) {
+		free_code(code, ip);
+		free(function_name);
+		free(descriptor);
+		free(catches);
+		code = NULL;
 	}
 
 	/* free strings */
+	for (k = 0; k < NFIELDS; k++) {
+		free(ref_fields[k]);
+	}
+	free(ref_print_boolean);
+	free(ref_print_integer);
+	free(ref_print_string);
+	free(ref_read_boolean);
+	free(ref_read_integer);
+	free(ref_main_body);
+	free(jasm_name);
 	if (class_name) {
 		free(class_name);
 	}
+	init_code_generation();
 }
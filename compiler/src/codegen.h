@@ -8,12 +8,84 @@
 #ifndef CODEGEN_H
 #define CODEGEN_H
 
+#include <stddef.h>
 #include "jvm.h"
 #include "symboltable.h"
 #include "token.h"
 
 typedef unsigned int Label;
 
+/** the kinds of items in a code array, and the data types of operands */
+typedef enum {
+	CODE_LABEL       = 0x0001,
+	CODE_INSTRUCTION = 0x0002,
+	CODE_OPERAND     = 0x0004,
+	MASK_TYPE        = 0x000f,
+	CODE_INTEGER     = 0x0010,
+	CODE_ARRAY_TYPE  = 0x0020,
+	CODE_STRING      = 0x0040,
+	CODE_REFERENCE   = 0x0080,
+	MASK_DATA_TYPE   = 0x00f0,
+	CODE_ALLOCATED   = 0x0100,
+	MASK_ALLOCATION  = 0x0f00
+} CodeType;
+
+/** an item in a code array: a label, an instruction, or an operand */
+typedef struct {
+	CodeType type;
+	union {
+		JVMatype  atype;
+		Bytecode  code;
+		Label     label;
+		int       num;
+		char     *string;
+	};
+} Code;
+
+/** an exception handler that catches everything thrown in a range of code */
+typedef struct {
+	Label start;   /**< the label at the start of the range, inclusive */
+	Label end;     /**< the label at the end of the range, exclusive   */
+	Label handler; /**< the label at the start of the handler          */
+} Catch;
+
+/** the generated code of a method, with its descriptor and limits */
+typedef struct body_s Body;
+struct body_s {
+	char    *name;            /**< the method name                        */
+	char    *descriptor;      /**< the JVM method descriptor              */
+	int      access;          /**< the JVM access flags                   */
+	IDPropt *idprop;          /**< the subroutine properties, or NULL     */
+	Code    *code;            /**< the code array                         */
+	int      ip;              /**< the number of items in the code array  */
+	int      max_stack_depth; /**< the maximum operand stack depth        */
+	int      variables_width; /**< the length of the local variable array */
+	Catch   *catches;         /**< the exception handlers, or NULL        */
+	int      ncatches;        /**< the number of exception handlers       */
+	Boolean  support;         /**< whether it is runtime support code     */
+	Label    labels;          /**< the first label handed out for it      */
+	Label    nlabels;         /**< the number of labels handed out for it */
+	Body    *next;
+	Body    *prev;
+};
+
+/** a static field of the generated class */
+typedef struct {
+	const char *name;       /**< the field name       */
+	const char *descriptor; /**< the field descriptor */
+	int         access;     /**< the JVM access flags */
+} Field;
+
+/**
+ * Add a body loaded with <code>load_body</code> to the list of method bodies,
+ * as if its code had just been generated.  Its labels are renumbered from the
+ * next label to hand out.
+ *
+ * @param[in]  body
+ *     the loaded body
+ */
+void add_body(Body *body);
+
 /**
  * Assemble a Jasmin file.  The file must first be written by calling
  * <code>make_code_file</code>.
@@ -23,6 +95,25 @@ typedef unsigned int Label;
  */
 void assemble(const char *jasmin_path);
 
+/**
+ * Assemble a number of Jasmin files with one invocation of the assembler, so
+ * that the cost of starting the JVM is paid once for all of them.
+ *
+ * @param[in]  jasmin_path
+ *     the path to the Jasmin JAR file
+ * @param[in]  names
+ *     the names of the Jasmin files
+ * @param[in]  n
+ *     the number of Jasmin files
+ * @param[in]  quiet
+ *     whether to discard the output of the assembler
+ * @return
+ *     <code>NULL</code> if every file was assembled, or a description of the
+ *     failure otherwise
+ */
+const char *assemble_files(const char *jasmin_path, char *const *names, int n,
+		Boolean quiet);
+
 /**
  * Close the code generation for the current function or procedure.
  *
@@ -58,6 +149,16 @@ void gen_label(Label label);
  */
 void gen_2(Bytecode opcode, int value);
 
+/**
+ * Generate the shortest instruction that pushes an integer constant: one of
+ * the <code>iconst</code> instructions, <code>bipush</code>,
+ * <code>sipush</code>, or <code>ldc</code>.
+ *
+ * @param[in]  value
+ *     the constant
+ */
+void gen_const(int value);
+
 /**
  * Generate an instruction that takes a label.
  *
@@ -78,6 +179,20 @@ void gen_2_label(Bytecode opcode, Label label);
  */
 void gen_call(char *fname, IDPropt *idprop);
 
+/**
+ * Add an exception handler for everything thrown in a range of the current
+ * method.  Methods with exception handlers are not peephole optimised, since
+ * the optimiser does not know that the labels are in use.
+ *
+ * @param[in]  start
+ *     the label at the start of the range
+ * @param[in]  end
+ *     the label just after the end of the range
+ * @param[in]  handler
+ *     the label at the start of the handler
+ */
+void gen_catch_all(Label start, Label end, Label handler);
+
 /**
  * Generate an instruction sequence for handling the specified comparison,
  * ensuring that either zero or one is pushed onto the stack.
@@ -87,6 +202,15 @@ void gen_call(char *fname, IDPropt *idprop);
  */
 void gen_cmp(Bytecode opcode);
 
+/**
+ * Generate the instructions for creating and throwing an exception, which must
+ * have a constructor without parameters.
+ *
+ * @param[in]  exception
+ *     the internal name of the exception class
+ */
+void gen_throw(const char *exception);
+
 /**
  * Generate an instruction that creates a new array of the specified type.
  *
@@ -96,7 +220,8 @@ void gen_cmp(Bytecode opcode);
 void gen_newarray(JVMatype atype);
 
 /**
- * Generate the instructions for the displaying output on screen.
+ * Generate the instructions for the displaying output on screen.  Output
+ * goes through a buffer that is flushed when main ends.
  *
  * @param[in]  type
  *     the type of the value to be printed
@@ -107,7 +232,8 @@ void gen_print(ValType type);
  * Generate the instructions for displaying a string on screen.
  *
  * @param[in]  string
- *     the string to display
+ *     the string to display, which is not copied, and must live as long as the
+ *     compilation
  */
 void gen_print_string(char *string);
 
@@ -142,13 +268,52 @@ Label get_label(void);
  */
 const char *get_opcode_string(Bytecode opcode);
 
+/**
+ * Return the list of method bodies generated so far, including the methods of
+ * the runtime support code.
+ *
+ * @return
+ *     the first body in the list, or <code>NULL</code> if there is none
+ */
+Body *get_bodies(void);
+
+/**
+ * Return the name of the class being generated.
+ *
+ * @return
+ *     the class name set by <code>set_class_name</code>
+ */
+const char *get_class_name(void);
+
+/**
+ * Return the static fields used by the runtime support code.
+ *
+ * @param[out] nfields
+ *     the number of fields
+ * @return
+ *     the array of fields
+ */
+const Field *get_fields(int *nfields);
+
+/**
+ * Return the JVM opcode value (as used in a class file) of an opcode.
+ *
+ * @param[in]  opcode
+ *     the opcode for which to get the value
+ * @return
+ *     the one-byte opcode value
+ */
+unsigned char get_opcode_value(Bytecode opcode);
+
 /**
  * Initialise the code generation unit.
  */
 void init_code_generation(void);
 
 /**
- * Initialise the code array for a subroutine.
+ * Initialise the code array for a subroutine.  The body of main is generated
+ * as a method of its own, which the runtime support code calls from the
+ * actual main method.
  *
  * @param[in]  name
  *     the name of the function or procedure
@@ -157,6 +322,23 @@ void init_code_generation(void);
  */
 void init_subroutine_codegen(const char *name, IDPropt *p);
 
+/**
+ * Load a method body saved with <code>save_body</code>.  The body is held
+ * until it is added with <code>add_body</code>, or until code generation is
+ * released.
+ *
+ * @param[in]  data
+ *     the saved body
+ * @param[in]  len
+ *     the length of the saved body in bytes
+ * @param[out] prop
+ *     receives the subroutine properties, with an allocated parameter array,
+ *     if the body is that of a subroutine
+ * @return
+ *     the body, or <code>NULL</code> if the data is not a valid saved body
+ */
+Body *load_body(const unsigned char *data, size_t len, IDPropt *prop);
+
 /**
  * Print the generated code to screen.  This function is for debugging purposes
  * only.
@@ -164,10 +346,35 @@ void init_subroutine_codegen(const char *name, IDPropt *p);
 void list_code(void);
 
 /**
- * Open the object file, and write the generated code to it.
+ * Open the Jasmin file, and write the generated code to it.  This is only
+ * necessary when the Jasmin assembler is used instead of writing the class
+ * file directly with <code>make_class_file</code>.
  */
 void make_code_file(void);
 
+/**
+ * Keep the Jasmin file written by <code>make_code_file</code> when code
+ * generation is released, so that it can be assembled later.
+ *
+ * @return
+ *     the name of the Jasmin file, in newly allocated memory
+ */
+char *keep_code_file(void);
+
+/**
+ * Save a method body in a form that <code>load_body</code> can load in another
+ * compilation of the same class.  Labels are saved relative to the first
+ * label handed out for the body.
+ *
+ * @param[in]  body
+ *     the body to save
+ * @param[out] len
+ *     receives the length of the saved body in bytes
+ * @return
+ *     the saved body, in newly allocated memory
+ */
+unsigned char *save_body(const Body *body, size_t *len);
+
 /**
  * Set the name of the class file.  This must be called after
  * <code>init_code_generation</code>, but before any other code is emitted.
@@ -80,17 +80,38 @@
 
 /* --- error routines ------------------------------------------------------- */
 
-SourcePos position;
+_Thread_local SourcePos position;
 
 #ifndef __APPLE__
 static char *pname = NULL;
 #endif
-static char *sname = NULL;
+
+/* everything that belongs to a compilation is per thread */
+static _Thread_local char    *sname = NULL;
+static _Thread_local jmp_buf *errjmp = NULL; /* the recovery point, if any   */
+static _Thread_local pid_t    errpid;        /* the process that set it      */
+static _Thread_local FILE    *errstream;     /* the stream, if not stderr    */
+
+/* the allocations of the thread, for the time report */
+static _Thread_local AllocCounts allocs;
+
+/* the stream for messages; isatty may set errno, which must survive it */
+static FILE *errout(int *istty)
+{
+	int err = errno;
+	FILE *out = (errstream != NULL ? errstream : stderr);
+
+	*istty = isatty(fileno(out));
+	errno = err;
+
+	return out;
+}
 
 static void _weprintf(const char *pre, const SourcePos *pos, const char *fmt,
 		va_list args)
 {
-	int istty = isatty(2);
+	int istty;
+	FILE *out = errout(&istty);
 	const char *ac_end = (istty ? ASCII_RESET : "");
 	const char *ac_src = (istty ? ASCII_BOLD_WHITE : "");
 	const char *ac_pos = (istty ? ASCII_BOLD_WHITE : "");
@@ -99,79 +120,119 @@ static void _weprintf(const char *pre, const SourcePos *pos, const char *fmt,
 
 	fflush(stdout);
 	if (progname != NULL) {
-		fprintf(stderr, "%s:", progname);
+		fprintf(out, "%s:", progname);
 	}
 	if (srcname != NULL) {
-		fprintf(stderr, " %s%s:%s", ac_src, srcname, ac_end);
+		fprintf(out, " %s%s:%s", ac_src, srcname, ac_end);
 	}
 	if (pos != NULL) {
-		fprintf(stderr, "%s%d:%d%s:", ac_pos, pos->line, pos->col, ac_end);
+		fprintf(out, "%s%d:%d%s:", ac_pos, pos->line, pos->col, ac_end);
 	}
 	if (pre != NULL) {
-		fprintf(stderr, " %s ", pre);
+		fprintf(out, " %s ", pre);
 	}
 	else {
-		fprintf(stderr, " ");
+		fprintf(out, " ");
 	}
 
-	vfprintf(stderr, fmt, args);
+	vfprintf(out, fmt, args);
 
 	if (fmt[0] != '\0' && fmt[strlen(fmt)-1] == ':')
-		fprintf(stderr, " %s", strerror(errno));
-	fprintf(stderr, "\n");
+		fprintf(out, " %s", strerror(errno));
+	fprintf(out, "\n");
 }
 
-void eprintf(const char *fmt, ...)
+static _Noreturn void die(int status)
 {
-	int istty = isatty(2);
+	if (errjmp != NULL && getpid() == errpid) {
+		longjmp(*errjmp, status);
+	}
+	exit(status);
+}
+
+_Noreturn void eprintf(const char *fmt, ...)
+{
+	int istty;
 	va_list args;
-	const char *pre =
-		(istty ? ASCII_BOLD_RED "error:" ASCII_RESET : "error:");
+	const char *pre;
+
+	errout(&istty);
+	pre = (istty ? ASCII_BOLD_RED "error:" ASCII_RESET : "error:");
 
 	va_start(args, fmt);
 	_weprintf(pre, NULL, fmt, args);
 	va_end(args);
-	exit(2);
+	die(2);
 }
 
-void leprintf(const char *fmt, ...)
+_Noreturn void leprintf(const char *fmt, ...)
 {
-	int istty = isatty(2);
+	int istty;
 	va_list args;
-	const char *pre =
-		(istty ? ASCII_BOLD_RED "error:" ASCII_RESET : "error:");
+	const char *pre;
+
+	errout(&istty);
+	pre = (istty ? ASCII_BOLD_RED "error:" ASCII_RESET : "error:");
 
 	va_start(args, fmt);
 	_weprintf(pre, &position, fmt, args);
 	va_end(args);
-	exit(2);
+	die(2);
 }
 
 void weprintf(const char *fmt, ...)
 {
-	int istty = isatty(2);
+	int istty;
 	va_list args;
-	const char *pre =
-		(istty ? ASCII_BOLD_YELLOW "warning:" ASCII_RESET : "warning:");
+	const char *pre;
+
+	errout(&istty);
+	pre = (istty ? ASCII_BOLD_YELLOW "warning:" ASCII_RESET : "warning:");
 
 	va_start(args, fmt);
 	_weprintf(pre, NULL, fmt, args);
 	va_end(args);
 }
 
-void teprintf(const char *tag, const char *fmt, ...)
+_Noreturn void teprintf(const char *tag, const char *fmt, ...)
 {
 	va_list args;
 
 	va_start(args, fmt);
 	_weprintf(tag, &position, fmt, args);
 	va_end(args);
-	exit(3);
+	die(3);
+}
+
+jmp_buf *seterrjmp(jmp_buf *env)
+{
+	jmp_buf *prev = errjmp;
+
+	errjmp = env;
+	errpid = getpid();
+
+	return prev;
+}
+
+FILE *seterrstream(FILE *stream)
+{
+	FILE *prev = errstream;
+
+	errstream = stream;
+
+	return prev;
+}
+
+FILE *geterrstream(void)
+{
+	return (errstream != NULL ? errstream : stderr);
 }
 
 char *estrdup(const char *s)
 {
 	char *t;
+	allocs.mallocs++;
+	allocs.malloc_bytes += strlen(s) + 1;
 	t = malloc((strlen(s) + 1) * sizeof(char));
 	if (t == NULL)
 		eprintf("estrdup(\"%.20s\") failed:", s);
@@ -193,6 +254,8 @@ void *emalloc(size_t n)
 {
 	void *p;
 
+	allocs.mallocs++;
+	allocs.malloc_bytes += n;
 	p = malloc(n);
 	if (p == NULL)
 		eprintf("malloc of %u bytes failed:", n);
@@ -213,6 +276,8 @@ void *erealloc(void *vp, size_t n)
 {
 	void *p;
 
+	allocs.reallocs++;
+	allocs.realloc_bytes += n;
 	p = realloc(vp, n);
 	if (p == NULL)
 		eprintf("realloc of %u bytes failed:", n);
@@ -229,6 +294,11 @@ void *werealloc(void *vp, size_t n)
 	return p;
 }
 
+void getalloccounts(AllocCounts *counts)
+{
+	*counts = allocs;
+}
+
 #ifndef __APPLE__
 void setprogname(char *s)
 {
@@ -278,4 +348,5 @@ void freeprogname(void)
 void freesrcname(void)
 {
 	free(sname);
+	sname = NULL;
 }
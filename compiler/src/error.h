@@ -19,7 +19,17 @@
 #ifndef ERROR_H
 #define ERROR_H
 
+#include <setjmp.h>
 #include <stddef.h>
+#include <stdio.h>
+
+/** the allocations that a thread made through the allocation functions */
+typedef struct {
+	unsigned long mallocs;       /**< the allocations and duplications */
+	size_t        malloc_bytes;  /**< the bytes they asked for         */
+	unsigned long reallocs;      /**< the reallocations                */
+	size_t        realloc_bytes; /**< the new sizes they asked for     */
+} AllocCounts;
 
 /** a place (position) in the source file */
 typedef struct {
@@ -27,7 +37,7 @@ typedef struct {
 	int col;   /**< the column number */
 } SourcePos;
 
-extern SourcePos position;
+extern _Thread_local SourcePos position;
 
 /**
  * Display an error message on the standard error stream and exit.
@@ -37,7 +47,7 @@ extern SourcePos position;
  * @param[in]  ...
  *     the variable arguments to the format string
  */
-void eprintf(const char *fmt, ...);
+_Noreturn void eprintf(const char *fmt, ...);
 
 /**
  * Display an error message on the standard error stream, with the current
@@ -48,7 +58,7 @@ void eprintf(const char *fmt, ...);
  * @param[in]  ...
  *     the variable arguments to the format string
  */
-void leprintf(const char *fmt, ...);
+_Noreturn void leprintf(const char *fmt, ...);
 
 /**
  * Display an error message on the standard error stream, with a tag prepended,
@@ -61,7 +71,7 @@ void leprintf(const char *fmt, ...);
  * @param[in]  ...
  *     the variable arguments to the format string
  */
-void teprintf(const char *tag, const char *fmt, ...);
+_Noreturn void teprintf(const char *tag, const char *fmt, ...);
 
 /**
  * Display a warning message on the standard error stream.
@@ -73,6 +83,41 @@ void teprintf(const char *tag, const char *fmt, ...);
  */
 void weprintf(const char *fmt, ...);
 
+/**
+ * Set the point to which the functions that terminate the program on an error
+ * return instead, by calling <code>longjmp</code> with the exit status that
+ * they would have used.  This lets a long-running process survive an error in
+ * one compilation, provided that it releases the resources of the compilation
+ * itself.  A child process started with <code>fork</code> still terminates.
+ *
+ * @param[in]  env
+ *     the recovery point, or <code>NULL</code> to terminate on errors again
+ * @return
+ *     the previous recovery point, so that it can be restored
+ */
+jmp_buf *seterrjmp(jmp_buf *env);
+
+/**
+ * Set the stream to which the error and warning messages of the calling thread
+ * go, instead of the standard error stream.
+ *
+ * @param[in]  stream
+ *     the stream, or <code>NULL</code> for the standard error stream again
+ * @return
+ *     the previous stream, so that it can be restored
+ */
+FILE *seterrstream(FILE *stream);
+
+/**
+ * Return the stream to which the error and warning messages of the calling
+ * thread go.
+ *
+ * @return
+ *     the stream set by <code>seterrstream</code>, or the standard error
+ *     stream
+ */
+FILE *geterrstream(void);
+
 /**
  * Duplicate a string, and terminate the program with a message on the standard
  * error stream if the duplication fails.
@@ -147,6 +192,15 @@ void *erealloc(void *vp, size_t n);
  */
 void *werealloc(void *vp, size_t n);
 
+/**
+ * Return the allocations that the calling thread has made so far through the
+ * allocation and string duplication functions.
+ *
+ * @param[out] counts
+ *     receives the number of allocations and reallocations, and their sizes
+ */
+void getalloccounts(AllocCounts *counts);
+
 /**
  * Free the program name.
  */
@@ -0,0 +1,336 @@
+/**
+ * @file    fold.c
+ * @brief   Constant folding and algebraic simplification on the abstract
+ *          syntax tree, between type checking and lowering.
+ *
+ * Expressions are simplified bottom-up and in place: a node that folds takes
+ * over the contents of the constant or operand that replaces it, but keeps its
+ * place in the list it belongs to.  Arithmetic is done on unsigned integers,
+ * so that it wraps around exactly as the JVM's does.
+ *
+ * @date    2026-10-16
+ */
+
+#include "fold.h"
+#include "boolean.h"
+
+#include <assert.h>
+#include <limits.h>
+
+#define IS_CONSTANT(n) ((n)->kind == AST_NUM || (n)->kind == AST_BOOL)
+#define IS_RELOP(op)   ((op) >= TOK_EQ && (op) <= TOK_NE)
+
+/* --- function prototypes -------------------------------------------------- */
+
+static void fold_statements(AstNode *list);
+static void fold_statement(AstNode *node);
+static void fold_expr(AstNode *node);
+static void fold_unary(AstNode *node);
+static void fold_binary(AstNode *node);
+static Boolean has_effects(AstNode *node);
+static Boolean is_num(AstNode *node, int value);
+static int arith(TokenType op, int left, int right);
+static Boolean compare(TokenType op, int left, int right);
+static int wrap(unsigned int value);
+static void become(AstNode *node, AstNode *with);
+static void become_constant(AstNode *node, AstKind kind, int value);
+
+/* --- folding interface ---------------------------------------------------- */
+
+void fold_program(AstNode *program)
+{
+	AstNode *s;
+
+	for (s = program->program.subdefs; s; s = s->next) {
+		fold_statements(s->subdef.body);
+	}
+	fold_statements(program->program.main->subdef.body);
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+static void fold_statements(AstNode *list)
+{
+	for (; list; list = list->next) {
+		fold_statement(list);
+	}
+}
+
+static void fold_statement(AstNode *node)
+{
+	AstNode *item;
+
+	switch (node->kind) {
+		case AST_ASSIGN:
+		case AST_ALLOC:
+		case AST_INPUT:
+			fold_expr(node->assign.target);
+			if (node->assign.expr) {
+				fold_expr(node->assign.expr);
+			}
+			break;
+		case AST_CALL:
+			fold_expr(node);
+			break;
+		case AST_IF:
+		case AST_WHILE:
+			fold_expr(node->branch.cond);
+			fold_statements(node->branch.body);
+			fold_statements(node->branch.alt);
+			break;
+		case AST_OUTPUT:
+			for (item = node->unary.expr; item; item = item->next) {
+				if (item->kind != AST_STRING) {
+					fold_expr(item);
+				}
+			}
+			break;
+		case AST_RETURN:
+			if (node->unary.expr) {
+				fold_expr(node->unary.expr);
+			}
+			break;
+		default:
+			assert(FALSE);
+	}
+}
+
+static void fold_expr(AstNode *node)
+{
+	AstNode *arg;
+
+	switch (node->kind) {
+		case AST_NUM:
+		case AST_BOOL:
+		case AST_VAR:
+			break;
+		case AST_INDEX:
+			fold_expr(node->ref.index);
+			break;
+		case AST_CALL:
+			for (arg = node->ref.args; arg; arg = arg->next) {
+				fold_expr(arg);
+			}
+			break;
+		case AST_UNARY:
+			fold_expr(node->unary.expr);
+			fold_unary(node);
+			break;
+		case AST_BINARY:
+			fold_expr(node->binary.left);
+			fold_expr(node->binary.right);
+			fold_binary(node);
+			break;
+		default:
+			assert(FALSE);
+	}
+}
+
+/**
+ * Folds a negation or "not" of a constant, and cancels a double negation or
+ * double "not".
+ */
+static void fold_unary(AstNode *node)
+{
+	AstNode *expr;
+
+	expr = node->unary.expr;
+	if (expr->kind == AST_NUM) {
+		become_constant(node, AST_NUM, wrap(-(unsigned int) expr->value));
+	} else if (expr->kind == AST_BOOL) {
+		become_constant(node, AST_BOOL, !expr->value);
+	} else if (expr->kind == AST_UNARY && expr->unary.op == node->unary.op) {
+		become(node, expr->unary.expr);
+	}
+}
+
+/**
+ * Folds a binary operator on constants, unless it divides by zero, and
+ * otherwise applies the identities for a constant on either side.  An operand
+ * is only dropped if it has no effects; the right operand of "and" and "or"
+ * may be dropped regardless, since it would not have been evaluated.
+ */
+static void fold_binary(AstNode *node)
+{
+	AstNode *left, *right;
+	TokenType op;
+
+	left = node->binary.left;
+	right = node->binary.right;
+	op = node->binary.op;
+
+	if (IS_CONSTANT(left) && IS_CONSTANT(right)) {
+		if (IS_RELOP(op)) {
+			become_constant(node, AST_BOOL,
+					compare(op, left->value, right->value));
+			return;
+		}
+		if (left->kind == AST_NUM
+				&& !((op == TOK_DIV || op == TOK_REM) && right->value == 0)) {
+			become_constant(node, AST_NUM,
+					arith(op, left->value, right->value));
+			return;
+		}
+	}
+
+	switch (op) {
+		case TOK_AND:
+		case TOK_OR:
+			/* the value that decides the result: false for and, true for or */
+			if (left->kind == AST_BOOL) {
+				if (left->value == (op == TOK_OR)) {
+					become_constant(node, AST_BOOL, left->value);
+				} else {
+					become(node, right);
+				}
+			} else if (right->kind == AST_BOOL) {
+				if (right->value != (op == TOK_OR)) {
+					become(node, left);
+				} else if (!has_effects(left)) {
+					become_constant(node, AST_BOOL, right->value);
+				}
+			}
+			break;
+		case TOK_PLUS:
+			if (is_num(left, 0)) {
+				become(node, right);
+			} else if (is_num(right, 0)) {
+				become(node, left);
+			}
+			break;
+		case TOK_MINUS:
+			if (is_num(right, 0)) {
+				become(node, left);
+			}
+			break;
+		case TOK_MUL:
+			if (is_num(left, 1)) {
+				become(node, right);
+			} else if (is_num(right, 1)) {
+				become(node, left);
+			} else if ((is_num(left, 0) && !has_effects(right))
+					|| (is_num(right, 0) && !has_effects(left))) {
+				become_constant(node, AST_NUM, 0);
+			}
+			break;
+		case TOK_DIV:
+			if (is_num(right, 1)) {
+				become(node, left);
+			}
+			break;
+		case TOK_REM:
+			if (is_num(right, 1) && !has_effects(left)) {
+				become_constant(node, AST_NUM, 0);
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+/**
+ * Checks whether evaluating an expression could do anything but produce its
+ * value: call a subroutine, index an array (which may be out of bounds), or
+ * divide by a divisor that may be zero.
+ */
+static Boolean has_effects(AstNode *node)
+{
+	TokenType op;
+
+	switch (node->kind) {
+		case AST_NUM:
+		case AST_BOOL:
+		case AST_VAR:
+			return FALSE;
+		case AST_UNARY:
+			return has_effects(node->unary.expr);
+		case AST_BINARY:
+			op = node->binary.op;
+			if ((op == TOK_DIV || op == TOK_REM)
+					&& !(node->binary.right->kind == AST_NUM
+						&& node->binary.right->value != 0)) {
+				return TRUE;
+			}
+			return has_effects(node->binary.left)
+				|| has_effects(node->binary.right);
+		default:
+			return TRUE;
+	}
+}
+
+static Boolean is_num(AstNode *node, int value)
+{
+	return node->kind == AST_NUM && node->value == value;
+}
+
+/**
+ * Evaluates an arithmetic operator as the JVM does: the sum, difference, and
+ * product wrap around, division truncates towards zero, and the one overflow
+ * of division, the minimum integer divided by -1, yields the minimum integer.
+ */
+static int arith(TokenType op, int left, int right)
+{
+	unsigned int l, r;
+
+	l = (unsigned int) left;
+	r = (unsigned int) right;
+
+	switch (op) {
+		case TOK_PLUS:  return wrap(l + r);
+		case TOK_MINUS: return wrap(l - r);
+		case TOK_MUL:   return wrap(l * r);
+		case TOK_DIV:   return (right == -1 ? wrap(-l) : left / right);
+		case TOK_REM:   return (right == -1 ? 0 : left % right);
+		default:
+			assert(FALSE);
+			return 0;
+	}
+}
+
+static Boolean compare(TokenType op, int left, int right)
+{
+	switch (op) {
+		case TOK_EQ: return left == right;
+		case TOK_GE: return left >= right;
+		case TOK_GT: return left > right;
+		case TOK_LE: return left <= right;
+		case TOK_LT: return left < right;
+		case TOK_NE: return left != right;
+		default:
+			assert(FALSE);
+			return FALSE;
+	}
+}
+
+/**
+ * Converts the bits of an unsigned integer to the two's-complement integer
+ * they represent, without relying on implementation-defined conversion.
+ */
+static int wrap(unsigned int value)
+{
+	if (value <= INT_MAX) {
+		return (int) value;
+	}
+	return -(int) (UINT_MAX - value) - 1;
+}
+
+/**
+ * Replaces a node by one of its descendants, keeping its place in a list.
+ */
+static void become(AstNode *node, AstNode *with)
+{
+	AstNode *next;
+
+	next = node->next;
+	*node = *with;
+	node->next = next;
+}
+
+/**
+ * Replaces a node by a constant of the same type.
+ */
+static void become_constant(AstNode *node, AstKind kind, int value)
+{
+	node->kind = kind;
+	node->value = value;
+}
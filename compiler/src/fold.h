@@ -0,0 +1,24 @@
+/**
+ * @file    fold.h
+ * @brief   The folding pass, which evaluates constant subexpressions and
+ *          applies algebraic identities on the abstract syntax tree.
+ * @date    2026-10-16
+ */
+
+#ifndef FOLD_H
+#define FOLD_H
+
+#include "ast.h"
+
+/**
+ * Simplify every expression in the syntax tree in place.  Arithmetic wraps
+ * around in 32 bits, as on the JVM; a division by zero is left for the
+ * program to trap at run time; and no subexpression that calls a subroutine,
+ * indexes an array, or divides is ever dropped.
+ *
+ * @param[in,out]  program
+ *     the AST_PROGRAM node of the syntax tree
+ */
+void fold_program(AstNode *program);
+
+#endif /* FOLD_H */
@@ -2,55 +2,85 @@
 #include "hashtable.h"
 
 #include <limits.h>
-#include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#define INITIAL_DELTA_INDEX 4
-#define PRINT_BUFFER_SIZE   1024
+#define INITIAL_CAPACITY_BITS 4
+#define MAX_LOADFACTOR        0.9f
+#define PRINT_BUFFER_SIZE     1024
 
-/** an entry in the hash table */
-typedef struct htentry HTentry;
-struct htentry {
-	void *key;         /*<< the key                      */
-	void *value;       /*<< the value                    */
-	HTentry *next_ptr; /*<< the next entry in the bucket */
+/**
+ * the number of slots of the old table that are moved per insertion during an
+ * incremental rehash; this must exceed the reciprocal of the load factor, so
+ * that the old table is drained before the new table has to grow
+ */
+#define MIGRATE_STEP          4
+
+/** the multiplier for Fibonacci hashing, 2^32 divided by the golden ratio */
+#define FIBONACCI_MULTIPLIER  2654435769u
+
+/**
+ * the modulus passed to the user-supplied hash function, so that the full hash
+ * value can be stored and the table can reduce it to an index by itself
+ */
+#define FULL_HASH_RANGE       UINT_MAX
+
+/** a slot in the hash table; the slot is empty if the key is NULL */
+typedef struct htslot HTslot;
+struct htslot {
+	unsigned int hash; /*<< the full hash of the key */
+	void *key;         /*<< the key                  */
+	void *value;       /*<< the value                */
 };
 
 /** a hash table container */
 struct hashtab {
-	/** a pointer to the underlying table                              */
-	HTentry **table;
-	/** the current size of the underlying table                       */
+	/** a pointer to the underlying array of slots                     */
+	HTslot *table;
+	/** the current number of slots, always a power of two            */
 	unsigned int size;
+	/** the base-2 logarithm of the number of slots                    */
+	unsigned int bits;
 	/** the current number of entries                                  */
 	unsigned int num_entries;
+	/** the number of entries at which the table is grown              */
+	unsigned int max_entries;
 	/** the maximum load factor before the underlying table is resized */
 	float max_loadfactor;
-	/** the index into the delta array                                 */
-	unsigned short idx;
 	/** a pointer to the hash function                                 */
 	unsigned int (*hash)(void *, unsigned int);
 	/** a pointer to the comparison function                           */
 	int (*cmp)(void *, void *);
+	/** whether the table grows incrementally                          */
+	Boolean incremental;
+	/** the table being drained during an incremental rehash, or NULL  */
+	HTslot *old_table;
+	/** the number of slots in the old table                           */
+	unsigned int old_size;
+	/** the base-2 logarithm of the number of slots in the old table   */
+	unsigned int old_bits;
+	/** the index of the next slot in the old table to be moved        */
+	unsigned int migrate_pos;
 };
 
 /* --- function prototypes -------------------------------------------------- */
 
-static int getsize(HashTab *ht);
-static HTentry **talloc(int tsize);
-static void rehash(HashTab *ht);
+static HTslot *talloc(unsigned int tsize);
+static HTslot *probe(HTslot *table, unsigned int bits, unsigned int h,
+		void *key, int (*cmp)(void *, void *));
+static void place(HTslot *table, unsigned int bits, HTslot *p);
+static void migrate(HashTab *ht, unsigned int nslots);
+static int resize(HashTab *ht, unsigned int bits);
+static int rehash(HashTab *ht);
 
 /**
- * the array of differences between a power-of-two and the largest prime less
- * than that power-of-two.
+ * Reduces a full hash value to an index into a table of 2^bits slots.  The
+ * multiplication spreads the bits of weak hash functions over the index.
  */
-unsigned short delta[] = {0,  0, 1, 1, 3, 1, 3, 1,  5, 3,  3, 9,  3,  1, 3, \
-19, 15, 1, 5, 1, 3, 9, 3, 15, 3, 39, 5, 39, 57, 3, 35, 1};
-
-#define MAX_IDX (sizeof(delta) / sizeof(short))
+#define SLOT_INDEX(h, bits) \
+	((unsigned int) ((h) * FIBONACCI_MULTIPLIER) >> (32 - (bits)))
 
 /* --- hash table interface ------------------------------------------------- */
 
@@ -60,23 +90,28 @@ int (*cmp)(void *val1, void *val2))
 {
 	HashTab *ht;
 
+	if (loadfactor <= 0.0f || hash == NULL || cmp == NULL) {
+		return NULL;
+	}
+
 	ht = (HashTab *) malloc(sizeof(HashTab));
 
 	if (ht == NULL) {
 		return NULL;
 	}
 
-	ht->size = 13;
+	ht->table = NULL;
+	ht->size = 0;
 	ht->num_entries = 0;
-	ht->idx = INITIAL_DELTA_INDEX;
-	ht->max_loadfactor = loadfactor;
+	ht->max_loadfactor =
+	    (loadfactor > MAX_LOADFACTOR ? MAX_LOADFACTOR : loadfactor);
 	ht->hash = hash;
 	ht->cmp = cmp;
+	ht->incremental = FALSE;
+	ht->old_table = NULL;
+	ht->old_size = 0;
 
-	size_t starter_table_size = 1 << INITIAL_DELTA_INDEX;
-	ht->table = talloc(starter_table_size);
-
-	if (ht->table == NULL) {
+	if (resize(ht, INITIAL_CAPACITY_BITS) != EXIT_SUCCESS) {
 		free(ht);
 		return NULL;
 	} else {
@@ -86,42 +121,38 @@ int (*cmp)(void *val1, void *val2))
 
 int ht_insert(HashTab *ht, void *key, void *value)
 {
+	unsigned int h;
+	HTslot *slot;
+
 	if (ht == NULL || key == NULL || value == NULL) {
 		return EXIT_FAILURE;
 	}
 
-	int hash_val = ht->hash(key, ht->size);
+	h = ht->hash(key, FULL_HASH_RANGE);
 
-	HTentry *entering_entry = malloc(sizeof(*entering_entry));
-
-	if (!entering_entry) {
-		return EXIT_FAILURE;
+	if (ht->old_table) {
+		migrate(ht, MIGRATE_STEP);
 	}
-	entering_entry->key = key;
-	entering_entry->value = value;
-	entering_entry->next_ptr = NULL;
-
-	float potential_new_loadfactor =
-	    (float) (ht->num_entries + 1) / (float) ht->size;
 
-	if (potential_new_loadfactor > ht->max_loadfactor) {
-		rehash(ht);
-
-		hash_val = ht->hash(key, ht->size);
+	if (ht->num_entries + 1 > ht->max_entries) {
+		if (rehash(ht) != EXIT_SUCCESS) {
+			return HASH_TABLE_NO_SPACE_FOR_NODE;
+		}
 	}
 
-	HTentry *present_entry = ht->table[hash_val];
+	/* an entry not yet moved out of the old table is still a duplicate */
+	if (ht->old_table && probe(ht->old_table, ht->old_bits, h, key, ht->cmp)->key) {
+		return HASH_TABLE_KEY_VALUE_PAIR_EXISTS;
+	}
 
-	while (present_entry != NULL) {
-		if (ht->cmp(key, present_entry->key) == 0) {
-			free(entering_entry);
-			return HASH_TABLE_KEY_VALUE_PAIR_EXISTS;
-		}
-		present_entry = present_entry->next_ptr;
+	slot = probe(ht->table, ht->bits, h, key, ht->cmp);
+	if (slot->key != NULL) {
+		return HASH_TABLE_KEY_VALUE_PAIR_EXISTS;
 	}
 
-	entering_entry->next_ptr = ht->table[hash_val];
-	ht->table[hash_val] = entering_entry;
+	slot->hash = h;
+	slot->key = key;
+	slot->value = value;
 	ht->num_entries++;
 
 	return EXIT_SUCCESS;
@@ -129,44 +160,91 @@ int ht_insert(HashTab *ht, void *key, void *value)
 
 void *ht_search(HashTab *ht, void *key)
 {
-	int k;
-	HTentry *p;
+	unsigned int h;
+	HTslot *slot;
 
 	if (!(ht && key)) {
 		return NULL;
 	}
 
-	k = ht->hash(key, ht->size);
-	for (p = ht->table[k]; p; p = p->next_ptr) {
-		if (ht->cmp(key, p->key) == 0) {
-			return p->value;
+	h = ht->hash(key, FULL_HASH_RANGE);
+
+	slot = probe(ht->table, ht->bits, h, key, ht->cmp);
+	if (slot->key == NULL && ht->old_table) {
+		slot = probe(ht->old_table, ht->old_bits, h, key, ht->cmp);
+	}
+
+	return slot->key ? slot->value : NULL;
+}
+
+int ht_reserve(HashTab *ht, unsigned int n)
+{
+	unsigned int bits;
+
+	if (ht == NULL) {
+		return EXIT_FAILURE;
+	}
+
+	for (bits = ht->bits; bits < 31; bits++) {
+		if ((float) n <= ht->max_loadfactor * (float) (1u << bits)) {
+			break;
 		}
 	}
 
-	return NULL;
+	if (bits > ht->bits) {
+		if (ht->old_table) {
+			migrate(ht, ht->old_size);
+		}
+		return resize(ht, bits);
+	}
+
+	return EXIT_SUCCESS;
+}
+
+int ht_set_incremental(HashTab *ht, Boolean incremental)
+{
+	if (ht == NULL) {
+		return EXIT_FAILURE;
+	}
+
+	if (!incremental && ht->old_table) {
+		migrate(ht, ht->old_size);
+	}
+	ht->incremental = incremental;
+
+	return EXIT_SUCCESS;
 }
 
 int ht_free(HashTab *ht, void (*freekey)(void *k), void (*freeval)(void *v))
 {
 	unsigned int i;
-	HTentry *p, *q;
+	HTslot *p;
 
 	if (!(ht && freekey && freeval)) {
 		return EXIT_FAILURE;
 	}
 
+	/* entries that have not been moved yet are only owned by the old table */
+	if (ht->old_table) {
+		for (i = ht->migrate_pos; i < ht->old_size; i++) {
+			p = &ht->old_table[i];
+			if (p->key != NULL) {
+				freekey(p->key);
+				freeval(p->value);
+			}
+		}
+		free(ht->old_table);
+	}
+
 	for (i = 0; i < ht->size; i++) {
-		p = ht->table[i];
-		while (p != NULL) {
-			q = p->next_ptr;
+		p = &ht->table[i];
+		if (p->key != NULL) {
 			if (freekey) {
 				freekey(p->key);
 			}
 			if (freeval) {
 				freeval(p->value);
 			}
-			free(p);
-			p = q;
 		}
 	}
 	free(ht->table);
@@ -178,13 +256,17 @@ int ht_free(HashTab *ht, void (*freekey)(void *k), void (*freeval)(void *v))
 void ht_print(HashTab *ht, void (*keyval2str)(void *k, void *v, char *b))
 {
 	unsigned int i;
-	HTentry *p;
+	HTslot *p;
 	char buffer[PRINT_BUFFER_SIZE];
 
 	if (ht && keyval2str) {
+		if (ht->old_table) {
+			migrate(ht, ht->old_size);
+		}
 		for (i = 0; i < ht->size; i++) {
 			printf("bucket[%2i]", i);
-			for (p = ht->table[i]; p != NULL; p = p->next_ptr) {
+			p = &ht->table[i];
+			if (p->key != NULL) {
 				keyval2str(p->key, p->value, buffer);
 				printf(" --> %s", buffer);
 			}
@@ -203,71 +285,123 @@ void keyval2str(void *k, void *v, char *b)
 
 /* --- utility functions ---------------------------------------------------- */
 
-static int getsize(HashTab *ht)
-{
-	int size_now, newest_size, pow, number;
-	size_now = ht->size;
-	newest_size = 0;
-	pow = 1;
-	number = 2;
-	while (number < size_now) {
-		number *= 2;
-		pow++;
-	}
-	pow++;
-	newest_size = number * 2 - delta[pow];
-
-	return newest_size;
-}
-
-static HTentry **talloc(int tsize)
+static HTslot *talloc(unsigned int tsize)
 {
-	HTentry **future_table = malloc(tsize * sizeof(HTentry *));
+	HTslot *future_table = calloc(tsize, sizeof(HTslot));
 
 	if (future_table == NULL) {
 		fprintf(stderr, "Memory allocation failed in talloc\n");
 		return NULL;
 	}
 
-	for (int i = 0; i < tsize; i++) {
-		future_table[i] = NULL;
+	return future_table;
+}
+
+/**
+ * Finds the slot that holds the specified key, or the empty slot at which the
+ * search for the key ended.  Keys are only compared when the stored hash
+ * matches.
+ */
+static HTslot *probe(HTslot *table, unsigned int bits, unsigned int h,
+		void *key, int (*cmp)(void *, void *))
+{
+	unsigned int i, mask;
+	HTslot *slot;
+
+	mask = (1u << bits) - 1;
+	for (i = SLOT_INDEX(h, bits); ; i = (i + 1) & mask) {
+		slot = &table[i];
+		if (slot->key == NULL || (slot->hash == h && cmp(key, slot->key) == 0)) {
+			return slot;
+		}
 	}
+}
 
-	return future_table;
+/**
+ * Places an entry that is known not to be in the table yet, using its stored
+ * hash, so that the key is never hashed again.
+ */
+static void place(HTslot *table, unsigned int bits, HTslot *p)
+{
+	unsigned int i, mask;
+
+	mask = (1u << bits) - 1;
+	for (i = SLOT_INDEX(p->hash, bits); table[i].key; i = (i + 1) & mask)
+		;
+	table[i] = *p;
 }
 
-static void rehash(HashTab *ht)
+/**
+ * Moves the entries in the next slots of the old table to the current table,
+ * during an incremental rehash.  The old table is left intact (so that its
+ * probe sequences stay valid for searches), and is released once all its
+ * slots have been visited.
+ */
+static void migrate(HashTab *ht, unsigned int nslots)
 {
-	int updated_size = getsize(ht);
-	HTentry **future_table = malloc(updated_size * sizeof(HTentry *));
+	HTslot *p;
 
-	if (future_table == NULL) {
-		/* Handle memory allocation failure */
-		return;
+	while (nslots-- > 0 && ht->migrate_pos < ht->old_size) {
+		p = &ht->old_table[ht->migrate_pos++];
+		if (p->key != NULL) {
+			place(ht->table, ht->bits, p);
+		}
+	}
+
+	if (ht->migrate_pos == ht->old_size) {
+		free(ht->old_table);
+		ht->old_table = NULL;
+		ht->old_size = 0;
 	}
+}
+
+/**
+ * Moves all entries into a new table of 2^bits slots, or, for an incremental
+ * rehash, sets up the current table to be drained into the new table.
+ */
+static int resize(HashTab *ht, unsigned int bits)
+{
+	unsigned int i, updated_size;
+	HTslot *future_table;
 
-	int i;
-	for (i = 0; i < updated_size; i++) {
-		future_table[i] = NULL;
+	updated_size = 1u << bits;
+	if ((future_table = talloc(updated_size)) == NULL) {
+		return EXIT_FAILURE;
 	}
-	unsigned int j;
-	for (j = 0; j < ht->size; j++) {
-		HTentry *current_ent = ht->table[j];
-		while (current_ent != NULL) {
-			unsigned int new_hash_val =
-			    ht->hash(current_ent->key, updated_size);
-			HTentry *newest_ent = malloc(sizeof(HTentry));
-			if (newest_ent == NULL) {
-				return;
+
+	if (ht->incremental && ht->num_entries > 0) {
+		/* a previous incremental rehash must be complete */
+		if (ht->old_table) {
+			migrate(ht, ht->old_size);
+		}
+		ht->old_table = ht->table;
+		ht->old_size = ht->size;
+		ht->old_bits = ht->bits;
+		ht->migrate_pos = 0;
+	} else {
+		for (i = 0; i < ht->size; i++) {
+			if (ht->table[i].key != NULL) {
+				place(future_table, bits, &ht->table[i]);
 			}
-			newest_ent->key = current_ent->key;
-			newest_ent->value = current_ent->value;
-			newest_ent->next_ptr = future_table[new_hash_val];
-			future_table[new_hash_val] = newest_ent;
-			current_ent = current_ent->next_ptr;
 		}
+		free(ht->table);
 	}
-	free(ht->table);
+
 	ht->table = future_table;
 	ht->size = updated_size;
+	ht->bits = bits;
+	ht->max_entries = (unsigned int) (ht->max_loadfactor * updated_size);
+	if (ht->max_entries >= updated_size) {
+		ht->max_entries = updated_size - 1;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+static int rehash(HashTab *ht)
+{
+	if (ht->bits >= 31) {
+		return EXIT_FAILURE;
+	}
+	return resize(ht, ht->bits + 1);
 }
@@ -5,6 +5,11 @@
  * values.  This implementation does not support the insertion or retrieval of
  * <code>NULL</code> keys or values.
  *
+ * The table uses open addressing with linear probing over a contiguous array of
+ * slots.  Each slot stores the full hash of its key, so that keys are only
+ * compared when their hashes match, and are never hashed again when the table
+ * grows.
+ *
  * @author  W.H.K. Bester (whkbester@cs.sun.ac.za)
  * @date    2023-07-06
  */
@@ -33,7 +38,8 @@ typedef struct hashtab HashTab;
  *     underlying table
  * @param[in]  hash
  *     a pointer to a hash function over the domain of the keys, taking a
- *     pointer to the key and the size of the underlying table as parameters
+ *     pointer to the key and a modulus as parameters; the table passes a large
+ *     modulus, and reduces the result to an index itself
  * @param[in]  cmp
  *     a pointer to a function that compares two values from the domain of
  *     values, returning <code>-1</code>, <code>0</code>, or <code>1</code> if
@@ -79,6 +85,39 @@ int ht_insert(HashTab *ht, void *key, void *value);
  */
 void *ht_search(HashTab *ht, void *key);
 
+/**
+ * Ensure that the specified hash table can hold the specified number of
+ * entries without growing.  This function fails if the hash table is
+ * <code>NULL</code>, or memory could not be allocated.
+ *
+ * @param[in]  ht
+ *     a pointer to the hash table
+ * @param[in]  n
+ *     the number of entries to make space for
+ * @return
+ *     <code>EXIT_SUCCESS</code> if enough space is available, or
+ *     <code>EXIT_FAILURE</code> otherwise
+ */
+int ht_reserve(HashTab *ht, unsigned int n);
+
+/**
+ * Select how the specified hash table grows.  By default, all entries are
+ * moved to the larger table at once.  In incremental mode, the entries are
+ * moved a few at a time by subsequent insertions, which bounds the cost of
+ * any single insertion; until then, searches consult both tables.  Switching
+ * incremental mode off completes any pending move.  This function fails if
+ * the hash table is <code>NULL</code>.
+ *
+ * @param[in]  ht
+ *     a pointer to the hash table
+ * @param[in]  incremental
+ *     whether the hash table should grow incrementally
+ * @return
+ *     <code>EXIT_SUCCESS</code> if the mode was set, or
+ *     <code>EXIT_FAILURE</code> otherwise
+ */
+int ht_set_incremental(HashTab *ht, Boolean incremental);
+
 /**
  * Free the space associated with the specified hash table.  This function fails
  * if any argument is <code>NULL</code>.
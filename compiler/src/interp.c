@@ -0,0 +1,925 @@
+/**
+ * @file    interp.c
+ * @brief   An interpreter that runs the generated JVM code in the compiler
+ *          itself.
+ *
+ * The code of every subroutine and of main is first translated to a compact
+ * instruction format: an operation and a single 32-bit argument, which is a
+ * local variable index, a constant, an instruction index for branches, a
+ * method index for calls, or a string index.  Labels are resolved during the
+ * translation, and calls of the runtime support methods become operations of
+ * their own.  With GCC or Clang, each operation is then replaced by the address
+ * of its handler, and the handlers jump directly to the handler of the next
+ * instruction; other compilers dispatch through a switch.
+ *
+ * All frames share one preallocated array of slots.  A frame holds the local
+ * variables of its method, followed by its operand stack; the arguments of a
+ * call are left on the operand stack of the caller, where they become the
+ * first local variables of the callee.  The space that a call needs is known
+ * from the limits that the code generator computes, so that it is checked
+ * once per call, and running out of it is reported as a stack overflow.
+ *
+ * Integer arithmetic wraps around, and the exceptions of the JVM are detected
+ * and reported as the runtime of the x86-64 target reports them.
+ *
+ * @date    2026-10-16
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "boolean.h"
+#include "codegen.h"
+#include "error.h"
+#include "interp.h"
+#include "jvm.h"
+
+/*
+ * Labels as values are a GNU extension, which GCC and Clang both support.  The
+ * pedantic warnings against them are silenced only for the table of handlers
+ * and the computed jumps, so that the rest of this file is checked as strictly
+ * as any other.
+ */
+#if defined(__GNUC__)
+#define THREADED_DISPATCH
+#endif
+
+/* --- type definitions and constants --------------------------------------- */
+
+#define STACK_SLOTS (1 << 20) /**< the number of slots for all frames */
+#define MAX_FRAMES  (1 << 16) /**< the maximum depth of calls        */
+
+#define ARITHMETIC_EXCEPTION "java.lang.ArithmeticException"
+#define BOUNDS_EXCEPTION     "java.lang.ArrayIndexOutOfBoundsException"
+#define INPUT_MISMATCH       "java.util.InputMismatchException"
+#define NEGATIVE_SIZE        "java.lang.NegativeArraySizeException"
+#define NO_SUCH_ELEMENT      "java.util.NoSuchElementException"
+#define NULL_POINTER         "java.lang.NullPointerException"
+#define OUT_OF_MEMORY        "java.lang.OutOfMemoryError"
+#define STACK_OVERFLOW       "java.lang.StackOverflowError"
+
+/** the operations of the interpreter */
+typedef enum {
+	OP_LOAD,        OP_STORE,       OP_PUSH,        OP_STRING,
+	OP_ADD,         OP_SUB,         OP_MUL,         OP_DIV,
+	OP_REM,         OP_AND,         OP_OR,          OP_XOR,
+	OP_NEG,         OP_ELEMENT,     OP_SET_ELEMENT, OP_LENGTH,
+	OP_NEWARRAY,    OP_GOTO,        OP_IFEQ,        OP_IFNE,
+	OP_IFGE,        OP_IFGT,        OP_CMPEQ,       OP_CMPNE,
+	OP_CMPGE,       OP_CMPGT,       OP_CMPLE,       OP_CMPLT,
+	OP_DUP,         OP_POP,         OP_SWAP,        OP_CALL,
+	OP_RETVAL,      OP_RETURN,      OP_PRINT_INT,   OP_PRINT_BOOL,
+	OP_PRINT_STRING, OP_READ_INT,   OP_READ_BOOL,   OP_NEW,
+	OP_INIT,        OP_THROW,
+	NOPS
+} Operation;
+
+/** an instruction: an operation and its argument */
+typedef struct {
+	union {
+		Operation   code;    /**< the operation                 */
+		const void *handler; /**< its handler, when threaded    */
+	} op;
+	int32_t arg;             /**< the argument, or zero         */
+} Insn;
+
+/** an array, with its items after its header */
+typedef struct array_s Array;
+struct array_s {
+	Array   *next;   /**< the array allocated before this one */
+	int32_t  length; /**< the number of items                 */
+	int32_t  item[]; /**< the items                           */
+};
+
+/** a local variable or operand stack slot */
+typedef union {
+	int32_t     i; /**< an integer or Boolean            */
+	Array      *a; /**< an array, or NULL                */
+	const char *s; /**< a string, or an exception class */
+} Slot;
+
+/** a translated subroutine or main */
+typedef struct {
+	const char *name;       /**< the method name                 */
+	const char *descriptor; /**< the JVM method descriptor       */
+	int         nparams;    /**< the number of parameters        */
+	int         nlocals;    /**< the number of local variables   */
+	int         max_stack;  /**< the maximum operand stack depth */
+	Insn       *code;       /**< the instructions                */
+	int         ncode;      /**< the number of instructions      */
+} Method;
+
+/** the state of a caller while its callee runs */
+typedef struct {
+	Method *method; /**< the calling method                    */
+	Insn   *pc;     /**< the instruction after the call        */
+	Slot   *locals; /**< the local variables of the caller     */
+} Frame;
+
+/** the methods of the JVM runtime support code, and their operations */
+static const struct {
+	const char *member; /**< the method name and descriptor */
+	Operation   op;     /**< the operation                  */
+} runtime_calls[] = {
+	{ "print$(I)V",                  OP_PRINT_INT    },
+	{ "print$(Z)V",                  OP_PRINT_BOOL   },
+	{ "print$(Ljava/lang/String;)V", OP_PRINT_STRING },
+	{ "readInt()I",                  OP_READ_INT     },
+	{ "readBoolean()Z",              OP_READ_BOOL    }
+};
+
+#define NRUNTIME_CALLS (sizeof(runtime_calls) / sizeof(runtime_calls[0]))
+
+/* --- global static variables ---------------------------------------------- */
+
+static _Thread_local Method  *methods;  /**< the translated methods         */
+static _Thread_local int      nmethods; /**< the number of methods          */
+static _Thread_local char   **strings;  /**< the string constants           */
+static _Thread_local int      nstrings; /**< the number of strings          */
+static _Thread_local Array   *arrays;   /**< the last array allocated       */
+
+/* --- function prototypes -------------------------------------------------- */
+
+static int execute(Method *entry);
+static void translate(Body *b, Method *m);
+static void translate_instruction(Method *m, Bytecode opcode, Code *operand,
+		const int *target);
+static void translate_invoke(Method *m, const char *ref);
+static void emit(Method *m, Operation op, int32_t arg);
+static int count_params(const char *descriptor);
+static int add_string(char *s);
+static char *unescape(const char *s);
+static Array *new_array(int32_t length);
+static const char *read_int(int32_t *value);
+static const char *read_bool(int32_t *value);
+static int skip_space(void);
+static Boolean read_word(const char *word);
+
+/* --- interpreter interface ------------------------------------------------ */
+
+int run_program(void)
+{
+	int i, status;
+	Body *b;
+	Method *entry;
+	Array *next;
+
+	methods = NULL;
+	nmethods = 0;
+	strings = NULL;
+	nstrings = 0;
+	arrays = NULL;
+
+	/* name the methods first, so that calls can be resolved */
+	for (b = get_bodies(); b; b = b->next) {
+		if (!b->support) {
+			nmethods++;
+		}
+	}
+	methods = emalloc(nmethods * sizeof(Method));
+	entry = NULL;
+	for (i = 0, b = get_bodies(); b; b = b->next) {
+		if (!b->support) {
+			methods[i].name = b->name;
+			methods[i].descriptor = b->descriptor;
+			if (b->idprop == NULL) {
+				entry = &methods[i];
+			}
+			i++;
+		}
+	}
+	if (entry == NULL) {
+		eprintf("No main method to run");
+	}
+
+	for (i = 0, b = get_bodies(); b; b = b->next) {
+		if (!b->support) {
+			translate(b, &methods[i++]);
+		}
+	}
+
+	status = execute(entry);
+	fflush(stdout);
+
+	for (; arrays; arrays = next) {
+		next = arrays->next;
+		free(arrays);
+	}
+	for (i = 0; i < nmethods; i++) {
+		free(methods[i].code);
+	}
+	for (i = 0; i < nstrings; i++) {
+		free(strings[i]);
+	}
+	free(methods);
+	free(strings);
+
+	return status;
+}
+
+/* --- execution ------------------------------------------------------------ */
+
+#ifdef THREADED_DISPATCH
+#define CASE(label, op) label:
+#define DISPATCH()      do { \
+	_Pragma("GCC diagnostic push") \
+	_Pragma("GCC diagnostic ignored \"-Wpedantic\"") \
+	goto *pc->op.handler; \
+	_Pragma("GCC diagnostic pop") \
+} while (0)
+#else
+#define CASE(label, op) case op:
+#define DISPATCH()      goto dispatch
+#endif
+
+#define NEXT()          do { pc++; DISPATCH(); } while (0)
+#define JUMP()          do { pc = code + pc->arg; DISPATCH(); } while (0)
+#define BRANCH(cond)    do { if (cond) JUMP(); NEXT(); } while (0)
+#define THROW(e)        do { exception = (e); goto unwind; } while (0)
+
+/* 32-bit arithmetic that wraps around, as on the JVM */
+#define WRAP(u)         ((int32_t) (uint32_t) (u))
+#define BINARY(expr)    do { sp--; sp[-1].i = (expr); NEXT(); } while (0)
+#define COMPARE(rel)    do { sp -= 2; BRANCH(sp[0].i rel sp[1].i); } while (0)
+
+/**
+ * Executes a method, which must not have parameters, until it returns or an
+ * exception is thrown.
+ *
+ * @param[in] entry the method to execute.
+ * @return    the exit status of the program.
+ */
+static int execute(Method *entry)
+{
+#ifdef THREADED_DISPATCH
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+	static const void *const handlers[NOPS] = {
+		[OP_LOAD]          = &&do_load,
+		[OP_STORE]         = &&do_store,
+		[OP_PUSH]          = &&do_push,
+		[OP_STRING]        = &&do_string,
+		[OP_ADD]           = &&do_add,
+		[OP_SUB]           = &&do_sub,
+		[OP_MUL]           = &&do_mul,
+		[OP_DIV]           = &&do_div,
+		[OP_REM]           = &&do_rem,
+		[OP_AND]           = &&do_and,
+		[OP_OR]            = &&do_or,
+		[OP_XOR]           = &&do_xor,
+		[OP_NEG]           = &&do_neg,
+		[OP_ELEMENT]       = &&do_element,
+		[OP_SET_ELEMENT]   = &&do_set_element,
+		[OP_LENGTH]        = &&do_length,
+		[OP_NEWARRAY]      = &&do_newarray,
+		[OP_GOTO]          = &&do_goto,
+		[OP_IFEQ]          = &&do_ifeq,
+		[OP_IFNE]          = &&do_ifne,
+		[OP_IFGE]          = &&do_ifge,
+		[OP_IFGT]          = &&do_ifgt,
+		[OP_CMPEQ]         = &&do_cmpeq,
+		[OP_CMPNE]         = &&do_cmpne,
+		[OP_CMPGE]         = &&do_cmpge,
+		[OP_CMPGT]         = &&do_cmpgt,
+		[OP_CMPLE]         = &&do_cmple,
+		[OP_CMPLT]         = &&do_cmplt,
+		[OP_DUP]           = &&do_dup,
+		[OP_POP]           = &&do_pop,
+		[OP_SWAP]          = &&do_swap,
+		[OP_CALL]          = &&do_call,
+		[OP_RETVAL]        = &&do_retval,
+		[OP_RETURN]        = &&do_return,
+		[OP_PRINT_INT]     = &&do_print_int,
+		[OP_PRINT_BOOL]    = &&do_print_bool,
+		[OP_PRINT_STRING]  = &&do_print_string,
+		[OP_READ_INT]      = &&do_read_int,
+		[OP_READ_BOOL]     = &&do_read_bool,
+		[OP_NEW]           = &&do_new,
+		[OP_INIT]          = &&do_init,
+		[OP_THROW]         = &&do_throw
+	};
+#pragma GCC diagnostic pop
+	int i;
+#endif
+	int status;
+	int32_t n, value;
+	const char *exception;
+	Slot *stack, *limit, *locals, *sp, top;
+	Frame *frames, *fp;
+	Method *m, *callee;
+	Insn *code, *pc;
+	Array *array;
+
+#ifdef THREADED_DISPATCH
+	for (m = methods; m < methods + nmethods; m++) {
+		for (i = 0; i < m->ncode; i++) {
+			m->code[i].op.handler = handlers[m->code[i].op.code];
+		}
+	}
+#endif
+
+	stack = emalloc(STACK_SLOTS * sizeof(Slot));
+	limit = stack + STACK_SLOTS;
+	frames = emalloc(MAX_FRAMES * sizeof(Frame));
+	fp = frames;
+	status = EXIT_SUCCESS;
+	exception = NULL;
+
+	m = entry;
+	if (m->nlocals + m->max_stack > STACK_SLOTS) {
+		THROW(STACK_OVERFLOW);
+	}
+	locals = stack;
+	memset(locals, 0, m->nlocals * sizeof(Slot));
+	sp = locals + m->nlocals;
+	code = pc = m->code;
+
+#ifdef THREADED_DISPATCH
+	DISPATCH();
+#else
+dispatch:
+	switch (pc->op.code) {
+#endif
+
+	CASE(do_load, OP_LOAD)
+		*sp++ = locals[pc->arg];
+		NEXT();
+	CASE(do_store, OP_STORE)
+		locals[pc->arg] = *--sp;
+		NEXT();
+	CASE(do_push, OP_PUSH)
+		(sp++)->i = pc->arg;
+		NEXT();
+	CASE(do_string, OP_STRING)
+		(sp++)->s = strings[pc->arg];
+		NEXT();
+
+	CASE(do_add, OP_ADD)
+		BINARY(WRAP((uint32_t) sp[-1].i + (uint32_t) sp[0].i));
+	CASE(do_sub, OP_SUB)
+		BINARY(WRAP((uint32_t) sp[-1].i - (uint32_t) sp[0].i));
+	CASE(do_mul, OP_MUL)
+		BINARY(WRAP((uint32_t) sp[-1].i * (uint32_t) sp[0].i));
+	CASE(do_div, OP_DIV)
+		if (sp[-1].i == 0) {
+			THROW(ARITHMETIC_EXCEPTION);
+		}
+		BINARY(sp[0].i == -1 ? WRAP(0u - (uint32_t) sp[-1].i)
+		                     : sp[-1].i / sp[0].i);
+	CASE(do_rem, OP_REM)
+		if (sp[-1].i == 0) {
+			THROW(ARITHMETIC_EXCEPTION);
+		}
+		BINARY(sp[0].i == -1 ? 0 : sp[-1].i % sp[0].i);
+	CASE(do_and, OP_AND)
+		BINARY(sp[-1].i & sp[0].i);
+	CASE(do_or, OP_OR)
+		BINARY(sp[-1].i | sp[0].i);
+	CASE(do_xor, OP_XOR)
+		BINARY(sp[-1].i ^ sp[0].i);
+	CASE(do_neg, OP_NEG)
+		sp[-1].i = WRAP(0u - (uint32_t) sp[-1].i);
+		NEXT();
+
+	CASE(do_element, OP_ELEMENT)
+		if ((array = sp[-2].a) == NULL) {
+			THROW(NULL_POINTER);
+		}
+		if ((uint32_t) sp[-1].i >= (uint32_t) array->length) {
+			THROW(BOUNDS_EXCEPTION);
+		}
+		BINARY(array->item[sp[0].i]);
+	CASE(do_set_element, OP_SET_ELEMENT)
+		sp -= 3;
+		if ((array = sp[0].a) == NULL) {
+			THROW(NULL_POINTER);
+		}
+		if ((uint32_t) sp[1].i >= (uint32_t) array->length) {
+			THROW(BOUNDS_EXCEPTION);
+		}
+		array->item[sp[1].i] = sp[2].i;
+		NEXT();
+	CASE(do_length, OP_LENGTH)
+		if (sp[-1].a == NULL) {
+			THROW(NULL_POINTER);
+		}
+		sp[-1].i = sp[-1].a->length;
+		NEXT();
+	CASE(do_newarray, OP_NEWARRAY)
+		if ((n = sp[-1].i) < 0) {
+			THROW(NEGATIVE_SIZE);
+		}
+		if ((sp[-1].a = new_array(n)) == NULL) {
+			THROW(OUT_OF_MEMORY);
+		}
+		NEXT();
+
+	CASE(do_goto, OP_GOTO)
+		JUMP();
+	CASE(do_ifeq, OP_IFEQ)
+		BRANCH((--sp)->i == 0);
+	CASE(do_ifne, OP_IFNE)
+		BRANCH((--sp)->i != 0);
+	CASE(do_ifge, OP_IFGE)
+		BRANCH((--sp)->i >= 0);
+	CASE(do_ifgt, OP_IFGT)
+		BRANCH((--sp)->i > 0);
+	CASE(do_cmpeq, OP_CMPEQ)
+		COMPARE(==);
+	CASE(do_cmpne, OP_CMPNE)
+		COMPARE(!=);
+	CASE(do_cmpge, OP_CMPGE)
+		COMPARE(>=);
+	CASE(do_cmpgt, OP_CMPGT)
+		COMPARE(>);
+	CASE(do_cmple, OP_CMPLE)
+		COMPARE(<=);
+	CASE(do_cmplt, OP_CMPLT)
+		COMPARE(<);
+
+	CASE(do_dup, OP_DUP)
+		*sp = sp[-1];
+		sp++;
+		NEXT();
+	CASE(do_pop, OP_POP)
+		sp--;
+		NEXT();
+	CASE(do_swap, OP_SWAP)
+		top = sp[-1];
+		sp[-1] = sp[-2];
+		sp[-2] = top;
+		NEXT();
+
+	CASE(do_call, OP_CALL)
+		callee = &methods[pc->arg];
+		if (fp == frames + MAX_FRAMES || callee->nlocals + callee->max_stack
+				> limit - (sp - callee->nparams)) {
+			THROW(STACK_OVERFLOW);
+		}
+		fp->method = m;
+		fp->pc = pc + 1;
+		fp->locals = locals;
+		fp++;
+		m = callee;
+		locals = sp - m->nparams;
+		memset(sp, 0, (m->nlocals - m->nparams) * sizeof(Slot));
+		sp = locals + m->nlocals;
+		code = pc = m->code;
+		DISPATCH();
+	CASE(do_retval, OP_RETVAL)
+		locals[0] = sp[-1];
+		sp = locals + 1;
+		goto leave;
+	CASE(do_return, OP_RETURN)
+		sp = locals;
+	leave:
+		if (fp == frames) {
+			goto done;
+		}
+		fp--;
+		m = fp->method;
+		code = m->code;
+		pc = fp->pc;
+		locals = fp->locals;
+		DISPATCH();
+
+	CASE(do_print_int, OP_PRINT_INT)
+		printf("%d", (int) (--sp)->i);
+		NEXT();
+	CASE(do_print_bool, OP_PRINT_BOOL)
+		fputs((--sp)->i ? "true" : "false", stdout);
+		NEXT();
+	CASE(do_print_string, OP_PRINT_STRING)
+		fputs((--sp)->s, stdout);
+		NEXT();
+	CASE(do_read_int, OP_READ_INT)
+		if ((exception = read_int(&value)) != NULL) {
+			goto unwind;
+		}
+		(sp++)->i = value;
+		NEXT();
+	CASE(do_read_bool, OP_READ_BOOL)
+		if ((exception = read_bool(&value)) != NULL) {
+			goto unwind;
+		}
+		(sp++)->i = value;
+		NEXT();
+
+	CASE(do_new, OP_NEW)
+		/* an exception object is represented by its class name */
+		(sp++)->s = strings[pc->arg];
+		NEXT();
+	CASE(do_init, OP_INIT)
+		/* only the constructors of exceptions, without parameters */
+		sp--;
+		NEXT();
+	CASE(do_throw, OP_THROW)
+		THROW((--sp)->s);
+
+#ifndef THREADED_DISPATCH
+	default:
+		eprintf("Unknown operation %d in interpreter", (int) pc->op.code);
+	}
+#endif
+
+unwind:
+	/* there are no exception handlers outside the runtime support code */
+	fflush(stdout);
+	fprintf(stderr, "Exception in thread \"main\" %s\n", exception);
+	status = EXIT_FAILURE;
+
+done:
+	free(frames);
+	free(stack);
+
+	return status;
+}
+
+/* --- translation ---------------------------------------------------------- */
+
+/**
+ * Translates the code of a subroutine or main.  Labels are first mapped to the
+ * index of the instruction that follows them, and the instructions are then
+ * translated with the targets of their branches resolved.
+ *
+ * @param[in]  b the body of the subroutine or main.
+ * @param[out] m the method to translate the body into.
+ */
+static void translate(Body *b, Method *m)
+{
+	int i, n;
+	Label max_label;
+	int *target;
+	Code *c, *operand;
+
+	m->nparams = count_params(b->descriptor);
+	m->nlocals = b->variables_width;
+	m->max_stack = b->max_stack_depth;
+	m->code = NULL;
+	m->ncode = 0;
+
+	max_label = 0;
+	for (i = 0; i < b->ip; i++) {
+		if ((b->code[i].type & MASK_TYPE) == CODE_LABEL
+				&& b->code[i].label > max_label) {
+			max_label = b->code[i].label;
+		}
+	}
+	target = emalloc((max_label + 1) * sizeof(int));
+	for (i = 0, n = 0; i < b->ip; i++) {
+		c = &b->code[i];
+		if ((c->type & MASK_TYPE) == CODE_LABEL) {
+			target[c->label] = n;
+		} else if ((c->type & MASK_TYPE) == CODE_INSTRUCTION
+				&& c->code != JVM_NOP) {
+			n++;
+		}
+	}
+
+	for (i = 0; i < b->ip; i++) {
+		c = &b->code[i];
+		switch (c->type & MASK_TYPE) {
+			case CODE_LABEL:
+				break;
+			case CODE_INSTRUCTION:
+				operand = NULL;
+				if (i + 1 < b->ip && (b->code[i+1].type & CODE_OPERAND)) {
+					operand = &b->code[++i];
+				}
+				translate_instruction(m, c->code, operand, target);
+				break;
+			default:
+				eprintf("Unexpected item in code of method '%s': %x", b->name,
+						(unsigned int) c->type);
+		}
+	}
+
+	free(target);
+}
+
+/**
+ * Translates a single instruction.
+ *
+ * @param[in] m       the method being translated.
+ * @param[in] opcode  the instruction.
+ * @param[in] operand the operand of the instruction, or <code>NULL</code>.
+ * @param[in] target  the instruction indices of the labels.
+ */
+static void translate_instruction(Method *m, Bytecode opcode, Code *operand,
+		const int *target)
+{
+	char *name, *p;
+
+	switch (opcode) {
+		case JVM_ALOAD:
+		case JVM_ILOAD:
+			emit(m, OP_LOAD, operand->num);
+			break;
+		case JVM_ASTORE:
+		case JVM_ISTORE:
+			emit(m, OP_STORE, operand->num);
+			break;
+		case JVM_ICONST_M1:
+		case JVM_ICONST_0:
+		case JVM_ICONST_1:
+		case JVM_ICONST_2:
+		case JVM_ICONST_3:
+		case JVM_ICONST_4:
+		case JVM_ICONST_5:
+			emit(m, OP_PUSH, (int32_t) (opcode - JVM_ICONST_0));
+			break;
+		case JVM_BIPUSH:
+		case JVM_SIPUSH:
+			emit(m, OP_PUSH, operand->num);
+			break;
+		case JVM_LDC:
+			if ((operand->type & MASK_DATA_TYPE) == CODE_STRING) {
+				emit(m, OP_STRING, add_string(unescape(operand->string)));
+			} else {
+				emit(m, OP_PUSH, operand->num);
+			}
+			break;
+		case JVM_IADD:        emit(m, OP_ADD, 0);         break;
+		case JVM_ISUB:        emit(m, OP_SUB, 0);         break;
+		case JVM_IMUL:        emit(m, OP_MUL, 0);         break;
+		case JVM_IDIV:        emit(m, OP_DIV, 0);         break;
+		case JVM_IREM:        emit(m, OP_REM, 0);         break;
+		case JVM_IAND:        emit(m, OP_AND, 0);         break;
+		case JVM_IOR:         emit(m, OP_OR, 0);          break;
+		case JVM_IXOR:        emit(m, OP_XOR, 0);         break;
+		case JVM_INEG:        emit(m, OP_NEG, 0);         break;
+		case JVM_IALOAD:      emit(m, OP_ELEMENT, 0);     break;
+		case JVM_IASTORE:     emit(m, OP_SET_ELEMENT, 0); break;
+		case JVM_ARRAYLENGTH: emit(m, OP_LENGTH, 0);      break;
+		case JVM_DUP:         emit(m, OP_DUP, 0);         break;
+		case JVM_POP:         emit(m, OP_POP, 0);         break;
+		case JVM_SWAP:        emit(m, OP_SWAP, 0);        break;
+		case JVM_IRETURN:
+		case JVM_ARETURN:     emit(m, OP_RETVAL, 0);      break;
+		case JVM_RETURN:      emit(m, OP_RETURN, 0);      break;
+		case JVM_ATHROW:      emit(m, OP_THROW, 0);       break;
+		case JVM_NOP:
+			break;
+		case JVM_NEWARRAY:
+			if (operand->atype != T_INT) {
+				eprintf("Unsupported array type for interpreter");
+			}
+			emit(m, OP_NEWARRAY, 0);
+			break;
+		case JVM_GOTO:
+			emit(m, OP_GOTO, target[operand->label]);
+			break;
+		case JVM_IFEQ:      emit(m, OP_IFEQ, target[operand->label]);  break;
+		case JVM_IFNE:      emit(m, OP_IFNE, target[operand->label]);  break;
+		case JVM_IFGE:      emit(m, OP_IFGE, target[operand->label]);  break;
+		case JVM_IFGT:      emit(m, OP_IFGT, target[operand->label]);  break;
+		case JVM_IF_ICMPEQ: emit(m, OP_CMPEQ, target[operand->label]); break;
+		case JVM_IF_ICMPNE: emit(m, OP_CMPNE, target[operand->label]); break;
+		case JVM_IF_ICMPGE: emit(m, OP_CMPGE, target[operand->label]); break;
+		case JVM_IF_ICMPGT: emit(m, OP_CMPGT, target[operand->label]); break;
+		case JVM_IF_ICMPLE: emit(m, OP_CMPLE, target[operand->label]); break;
+		case JVM_IF_ICMPLT: emit(m, OP_CMPLT, target[operand->label]); break;
+		case JVM_INVOKESTATIC:
+			translate_invoke(m, operand->string);
+			break;
+		case JVM_NEW:
+			/* the class name, as it is reported */
+			name = estrdup(operand->string);
+			for (p = name; *p; p++) {
+				if (*p == '/') {
+					*p = '.';
+				}
+			}
+			emit(m, OP_NEW, add_string(name));
+			break;
+		case JVM_INVOKESPECIAL:
+			emit(m, OP_INIT, 0);
+			break;
+		default:
+			eprintf("Instruction '%s' not supported by interpreter",
+					get_opcode_string(opcode));
+	}
+}
+
+/**
+ * Translates a call of a subroutine, or of a method of the runtime support
+ * code.
+ *
+ * @param[in] m   the method being translated.
+ * @param[in] ref the method reference, as "owner/name(parameters)return".
+ */
+static void translate_invoke(Method *m, const char *ref)
+{
+	const char *paren, *member;
+	size_t len;
+	int i;
+	unsigned int j;
+
+	paren = strchr(ref, '(');
+	for (member = paren; member > ref && member[-1] != '/'; member--)
+		;
+	len = paren - member;
+
+	for (j = 0; j < NRUNTIME_CALLS; j++) {
+		if (strcmp(member, runtime_calls[j].member) == 0) {
+			emit(m, runtime_calls[j].op, 0);
+			return;
+		}
+	}
+
+	for (i = 0; i < nmethods; i++) {
+		if (strlen(methods[i].name) == len
+				&& strncmp(methods[i].name, member, len) == 0
+				&& strcmp(methods[i].descriptor, paren) == 0) {
+			emit(m, OP_CALL, i);
+			return;
+		}
+	}
+
+	eprintf("Method '%s' not supported by interpreter", ref);
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+/**
+ * Appends an instruction to the code of a method.
+ */
+static void emit(Method *m, Operation op, int32_t arg)
+{
+	m->code = erealloc(m->code, (m->ncode + 1) * sizeof(Insn));
+	m->code[m->ncode].op.code = op;
+	m->code[m->ncode].arg = arg;
+	m->ncode++;
+}
+
+/**
+ * Returns the number of parameters in a method descriptor; array markers
+ * precede the type they apply to.
+ */
+static int count_params(const char *descriptor)
+{
+	const char *p;
+	int n;
+
+	n = 0;
+	for (p = descriptor + 1; *p != ')'; p++) {
+		if (*p == 'L') {
+			p = strchr(p, ';');
+		}
+		if (*p != '[') {
+			n++;
+		}
+	}
+
+	return n;
+}
+
+/**
+ * Adds a newly allocated string constant, and returns its number.
+ */
+static int add_string(char *s)
+{
+	strings = erealloc(strings, (nstrings + 1) * sizeof(char *));
+	strings[nstrings] = s;
+	return nstrings++;
+}
+
+/**
+ * Returns a newly allocated copy of a string constant, with its escape codes
+ * replaced by the characters they stand for.
+ */
+static char *unescape(const char *s)
+{
+	char *t, *p;
+
+	t = p = emalloc(strlen(s) + 1);
+	for (; *s; s++) {
+		if (*s == '\\' && s[1] != '\0') {
+			switch (*++s) {
+				case 'n': *p++ = '\n'; break;
+				case 't': *p++ = '\t'; break;
+				default:  *p++ = *s;   break;
+			}
+		} else {
+			*p++ = *s;
+		}
+	}
+	*p = '\0';
+
+	return t;
+}
+
+/**
+ * Returns a new array of zeros, or <code>NULL</code> if there is not enough
+ * memory.  The array is released when the program ends.
+ */
+static Array *new_array(int32_t length)
+{
+	Array *a;
+
+	if ((a = calloc(1, sizeof(Array) + length * sizeof(int32_t))) == NULL) {
+		return NULL;
+	}
+	a->length = length;
+	a->next = arrays;
+	arrays = a;
+
+	return a;
+}
+
+/**
+ * Reads an integer, accumulated as a negative number against a limit, so that
+ * the minimum integer can be read and overflow is caught.  Returns the
+ * exception to throw, or <code>NULL</code> on success.
+ */
+static const char *read_int(int32_t *value)
+{
+	int c, d;
+	Boolean negative;
+	int32_t n, limit;
+
+	if ((c = skip_space()) == EOF) {
+		return NO_SUCH_ELEMENT;
+	}
+	negative = (c == '-');
+	limit = (negative ? INT32_MIN : -INT32_MAX);
+	if (c == '-' || c == '+') {
+		c = getchar();
+	}
+	if (c < '0' || c > '9') {
+		return INPUT_MISMATCH;
+	}
+
+	n = 0;
+	do {
+		d = c - '0';
+		if (n < limit / 10 || n * 10 < limit + d) {
+			return INPUT_MISMATCH;
+		}
+		n = n * 10 - d;
+		c = getchar();
+	} while (c >= '0' && c <= '9');
+
+	if (c > ' ') {
+		return INPUT_MISMATCH;
+	}
+
+	*value = (negative ? n : -n);
+	return NULL;
+}
+
+/**
+ * Reads a Boolean, "true" or "false" in any case.  Returns the exception to
+ * throw, or <code>NULL</code> on success.
+ */
+static const char *read_bool(int32_t *value)
+{
+	int c;
+
+	if ((c = skip_space()) == EOF) {
+		return NO_SUCH_ELEMENT;
+	}
+	c |= 'a' - 'A';
+	if (c == 't' && read_word("true")) {
+		*value = 1;
+	} else if (c == 'f' && read_word("false")) {
+		*value = 0;
+	} else {
+		return INPUT_MISMATCH;
+	}
+
+	return NULL;
+}
+
+/**
+ * Skips white space, and returns the first byte of the next token, or
+ * <code>EOF</code> at the end of the input.
+ */
+static int skip_space(void)
+{
+	int c;
+
+	while ((c = getchar()) != EOF && c <= ' ')
+		;
+
+	return c;
+}
+
+/**
+ * Checks that the rest of the token is the rest of a lower-case word, in any
+ * case.
+ */
+static Boolean read_word(const char *word)
+{
+	int c;
+
+	for (word++; *word; word++) {
+		if ((getchar() | ('a' - 'A')) != *word) {
+			return FALSE;
+		}
+	}
+	c = getchar();
+
+	return (c == EOF || c <= ' ');
+}
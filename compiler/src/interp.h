@@ -0,0 +1,28 @@
+/**
+ * @file    interp.h
+ * @brief   An interpreter that runs the generated JVM code in the compiler
+ *          itself, without a class file or a JVM.
+ * @date    2026-10-16
+ */
+
+#ifndef INTERP_H
+#define INTERP_H
+
+/**
+ * Run the program of the current class: translate the subroutines and main to
+ * the instruction format of the interpreter, and execute main.  The runtime
+ * support methods of the JVM target are not translated; the interpreter
+ * implements their behaviour itself.  The bodies of all the methods must have
+ * been closed by <code>close_subroutine_codegen</code>.
+ *
+ * The program reads from standard input and writes to standard output.  An
+ * exception that would have been thrown on the JVM is reported on standard
+ * error, and ends the program.
+ *
+ * @return
+ *     <code>EXIT_SUCCESS</code> if the program ran to completion, or
+ *     <code>EXIT_FAILURE</code> if it ended with an exception
+ */
+int run_program(void);
+
+#endif /* INTERP_H */
@@ -24,15 +24,30 @@ typedef enum {
 typedef enum {
 	JVM_ALOAD,
 	JVM_ARETURN,
+	JVM_ARRAYLENGTH,
 	JVM_ASTORE,
+	JVM_ATHROW,
+	JVM_BALOAD,
+	JVM_BIPUSH,
+	JVM_DUP,
 	JVM_GETSTATIC,
 	JVM_GOTO,
 	JVM_IADD,
 	JVM_IALOAD,
 	JVM_IAND,
 	JVM_IASTORE,
+	JVM_ICONST_M1,
+	JVM_ICONST_0,
+	JVM_ICONST_1,
+	JVM_ICONST_2,
+	JVM_ICONST_3,
+	JVM_ICONST_4,
+	JVM_ICONST_5,
 	JVM_IDIV,
 	JVM_IFEQ,
+	JVM_IFNE,
+	JVM_IFGE,
+	JVM_IFGT,
 	JVM_IF_ICMPEQ,
 	JVM_IF_ICMPGE,
 	JVM_IF_ICMPGT,
@@ -42,6 +57,7 @@ typedef enum {
 	JVM_ILOAD,
 	JVM_IMUL,
 	JVM_INEG,
+	JVM_INVOKESPECIAL,
 	JVM_INVOKESTATIC,
 	JVM_INVOKEVIRTUAL,
 	JVM_IOR,
@@ -51,9 +67,21 @@ typedef enum {
 	JVM_IRETURN,
 	JVM_IXOR,
 	JVM_LDC,
+	JVM_NEW,
 	JVM_NEWARRAY,
+	JVM_NOP,
+	JVM_POP,
+	JVM_PUTSTATIC,
 	JVM_RETURN,
+	JVM_SIPUSH,
 	JVM_SWAP
 } Bytecode;
 
+/* class, field, and method access flags */
+#define ACC_PUBLIC  0x0001
+#define ACC_PRIVATE 0x0002
+#define ACC_STATIC  0x0008
+#define ACC_FINAL   0x0010
+#define ACC_SUPER   0x0020
+
 #endif /* JVM_H */
@@ -0,0 +1,87 @@
+/**
+ * @file    libamplc.c
+ * @brief   The AMPL-2023 compiler as a library.
+ * @date    2026-10-16
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "boolean.h"
+#include "error.h"
+#include "libamplc.h"
+
+/* --- type definitions and constants --------------------------------------- */
+
+#define DEFAULT_SRC_NAME "<source>"
+
+/* --- compiler context interface ------------------------------------------- */
+
+void amplc_init(CompilerCtx *ctx, const char *src_name)
+{
+	ctx->src_name = estrdup(src_name != NULL ? src_name : DEFAULT_SRC_NAME);
+	ctx->diagnostics = NULL;
+	ctx->diag_len = 0;
+}
+
+int amplc_compile(CompilerCtx *ctx, const char *src, size_t len,
+		AmplcOutput *out)
+{
+	int status;
+	FILE *diag;
+	Request req;
+
+	out->name = NULL;
+	out->bytes = NULL;
+	out->length = 0;
+
+	/* the diagnostics of the previous compilation give way */
+	free(ctx->diagnostics);
+	ctx->diagnostics = NULL;
+	ctx->diag_len = 0;
+	if ((diag = open_memstream(&ctx->diagnostics, &ctx->diag_len)) == NULL) {
+		weprintf("Could not collect diagnostics:");
+		return EXIT_FAILURE;
+	}
+
+	/* the scanner reads the source text in place, and never writes to it */
+	memset(&req, 0, sizeof(req));
+	req.src_name = ctx->src_name;
+	req.source = (char *) (src != NULL ? src : "");
+	req.length = len;
+	req.in_memory = TRUE;
+
+	seterrstream(diag);
+	status = compile_request(&req);
+	seterrstream(NULL);
+	fclose(diag);
+
+	if (status == EXIT_SUCCESS) {
+		out->name = req.output;
+		out->bytes = req.image;
+		out->length = req.image_len;
+	} else {
+		free(req.output);
+		free(req.image);
+	}
+
+	return status;
+}
+
+void amplc_release_output(AmplcOutput *out)
+{
+	free(out->name);
+	free(out->bytes);
+	out->name = NULL;
+	out->bytes = NULL;
+	out->length = 0;
+}
+
+void amplc_release(CompilerCtx *ctx)
+{
+	free(ctx->src_name);
+	free(ctx->diagnostics);
+	ctx->src_name = NULL;
+	ctx->diagnostics = NULL;
+	ctx->diag_len = 0;
+}
@@ -0,0 +1,123 @@
+/**
+ * @file    libamplc.h
+ * @brief   The AMPL-2023 compiler as a library.
+ *
+ * The state of every compiler unit is kept per thread, so that compilations
+ * on different threads proceed in parallel without interfering with each
+ * other.  A thread compiles through a compiler context, which collects the
+ * diagnostics of its compilations; a context must not be used by two threads
+ * at the same time.  Errors in the source do not terminate the process, but
+ * fail the compilation.
+ *
+ * @date    2026-10-16
+ */
+
+#ifndef LIBAMPLC_H
+#define LIBAMPLC_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include "boolean.h"
+
+/* --- compilation requests ------------------------------------------------- */
+
+/** a compilation, as requested on the command line or from the server */
+typedef struct {
+	char          *src_name;   /**< the name of the source file             */
+	char          *source;     /**< the source text, or NULL to read it     */
+	size_t         length;     /**< the length of the source text           */
+	Boolean        use_jasmin; /**< whether to assemble Jasmin output       */
+	Boolean        native;     /**< whether to compile for x86-64           */
+	Boolean        dump;       /**< whether to dump the syntax tree instead */
+	Boolean        run;        /**< whether to run the program instead      */
+	Boolean        in_memory;  /**< whether to build the class in memory    */
+	Boolean        defer;      /**< whether to leave the Jasmin file to the
+	                                caller to assemble, as the output      */
+	Boolean        timed;      /**< whether to report the time of each
+	                                phase on the error stream              */
+	Boolean        time_json;  /**< whether to report the time as JSON      */
+	char          *output;     /**< set to the file produced                */
+	Boolean        cached;     /**< set if the output came from the cache   */
+	char          *cache_key;  /**< set to the key under which to cache the
+	                                deferred output, once it is assembled  */
+	unsigned char *image;      /**< set to the class file built in memory   */
+	size_t         image_len;  /**< set to the length of the class file     */
+} Request;
+
+/**
+ * Carry out a compilation on the calling thread.  A fatal error returns here
+ * with its exit status, and the resources of the compilation are released
+ * either way, except for the name of the output file, the class file built in
+ * memory, and the cache key of a deferred output, which belong to the caller.
+ *
+ * @param[in,out] req
+ *     the compilation
+ * @return
+ *     the exit status of the compilation
+ */
+int compile_request(Request *req);
+
+/* --- compiler contexts ---------------------------------------------------- */
+
+/** a compiler context */
+typedef struct {
+	char   *src_name;    /**< the name of the source in diagnostics          */
+	char   *diagnostics; /**< the messages of the last compilation           */
+	size_t  diag_len;    /**< the length of the messages                     */
+} CompilerCtx;
+
+/** the output of a successful compilation */
+typedef struct {
+	char          *name;   /**< the name of the class file                   */
+	unsigned char *bytes;  /**< the class file                               */
+	size_t         length; /**< the length of the class file                 */
+} AmplcOutput;
+
+/**
+ * Initialise a compiler context.
+ *
+ * @param[out] ctx
+ *     the context
+ * @param[in]  src_name
+ *     the name under which the sources compiled in the context are reported
+ *     in diagnostics
+ */
+void amplc_init(CompilerCtx *ctx, const char *src_name);
+
+/**
+ * Compile AMPL-2023 source text to a JVM class file in memory.  The
+ * diagnostics of the compilation replace those in the context.
+ *
+ * @param[in,out] ctx
+ *     the context, used by no other thread for the duration of the call
+ * @param[in]  src
+ *     the source text, which need not be terminated
+ * @param[in]  len
+ *     the length of the source text
+ * @param[out] out
+ *     the class file, if the compilation succeeds; release it with
+ *     <code>amplc_release_output</code>
+ * @return
+ *     <code>EXIT_SUCCESS</code> if the compilation succeeds, or the exit
+ *     status of amplc for the error otherwise
+ */
+int amplc_compile(CompilerCtx *ctx, const char *src, size_t len,
+		AmplcOutput *out);
+
+/**
+ * Release the output of a compilation.
+ *
+ * @param[in]  out
+ *     the output
+ */
+void amplc_release_output(AmplcOutput *out);
+
+/**
+ * Release the resources of a compiler context.
+ *
+ * @param[in]  ctx
+ *     the context
+ */
+void amplc_release(CompilerCtx *ctx);
+
+#endif /* LIBAMPLC_H */
@@ -0,0 +1,359 @@
+/**
+ * @file    lower.c
+ * @brief   Generates JVM code from the abstract syntax tree, by driving the
+ *          code generation unit.
+ *
+ * The tree has been type checked by the parser, so this pass does not report
+ * any errors.  Every subroutine and main are lowered into a method body of
+ * their own.
+ *
+ * @date    2026-10-16
+ */
+
+#include "lower.h"
+#include "codegen.h"
+#include "error.h"
+#include "jvm.h"
+
+#include <assert.h>
+
+/** the exception thrown when a function ends without returning a value */
+#define MISSING_RETURN "java/lang/IllegalStateException"
+
+#define IS_RELOP(toktype) (toktype >= TOK_EQ && toktype <= TOK_NE)
+
+/* --- global static variables ---------------------------------------------- */
+
+static _Thread_local IDPropt *routine; /**< the subroutine, or NULL for main */
+
+/* --- function prototypes -------------------------------------------------- */
+
+static void lower_subdef(AstNode *node, IDPropt *prop);
+static void lower_statements(AstNode *list);
+static void lower_statement(AstNode *node);
+static void lower_store(AstNode *target);
+static void lower_expr(AstNode *node);
+static void lower_cond(AstNode *node, Label target, Boolean sense);
+static void lower_args(AstNode *list);
+static Bytecode binary_opcode(TokenType op);
+static TokenType negate_relop(TokenType op);
+
+/* --- lowering interface --------------------------------------------------- */
+
+void lower_program(AstNode *program)
+{
+	AstNode *s;
+
+	set_class_name(program->program.name);
+
+	for (s = program->program.subdefs; s; s = s->next) {
+		lower_subdef(s, &s->subdef.prop);
+	}
+	lower_subdef(program->program.main, NULL);
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+/**
+ * Lowers a subroutine, or main if the properties are NULL, into a method
+ * body, and records the body in the node.  Procedures and main return when
+ * they run off the end, and functions that do so throw an exception, so that
+ * the code is always verifiable.
+ */
+static void lower_subdef(AstNode *node, IDPropt *prop)
+{
+	AstNode *last;
+
+	/* the code of a routine found in the cache is only added */
+	if (node->subdef.code != NULL) {
+		add_body(node->subdef.code);
+		return;
+	}
+
+	routine = prop;
+	init_subroutine_codegen(node->subdef.name, prop);
+	lower_statements(node->subdef.body);
+
+	for (last = node->subdef.body; last && last->next; last = last->next)
+		;
+	if (!last || last->kind != AST_RETURN) {
+		if (prop == NULL || IS_PROCEDURE(prop->type)) {
+			gen_1(JVM_RETURN);
+		} else {
+			gen_throw(MISSING_RETURN);
+		}
+	}
+
+	close_subroutine_codegen(node->subdef.width);
+	node->subdef.code = get_bodies();
+	routine = NULL;
+}
+
+static void lower_statements(AstNode *list)
+{
+	for (; list; list = list->next) {
+		lower_statement(list);
+	}
+}
+
+static void lower_statement(AstNode *node)
+{
+	AstNode *item;
+	Label l1, l2;
+
+	switch (node->kind) {
+		case AST_ASSIGN:
+			if (node->assign.target->kind == AST_INDEX) {
+				gen_2(JVM_ALOAD, node->assign.target->ref.prop.offset);
+				lower_expr(node->assign.target->ref.index);
+			}
+			lower_expr(node->assign.expr);
+			lower_store(node->assign.target);
+			break;
+		case AST_ALLOC:
+			lower_expr(node->assign.expr);
+			gen_newarray(T_INT);
+			lower_store(node->assign.target);
+			break;
+		case AST_CALL:
+			lower_args(node->ref.args);
+			gen_call(node->ref.id, &node->ref.prop);
+			break;
+		case AST_IF:
+			l1 = get_label();
+			lower_cond(node->branch.cond, l1, FALSE);
+			lower_statements(node->branch.body);
+			if (node->branch.alt) {
+				l2 = get_label();
+				gen_2_label(JVM_GOTO, l2);
+				gen_label(l1);
+				lower_statements(node->branch.alt);
+				gen_label(l2);
+			} else {
+				gen_label(l1);
+			}
+			break;
+		case AST_INPUT:
+			if (node->assign.target->kind == AST_INDEX) {
+				gen_2(JVM_ALOAD, node->assign.target->ref.prop.offset);
+				lower_expr(node->assign.target->ref.index);
+			}
+			gen_read(node->assign.target->type);
+			lower_store(node->assign.target);
+			break;
+		case AST_OUTPUT:
+			for (item = node->unary.expr; item; item = item->next) {
+				if (item->kind == AST_STRING) {
+					gen_print_string(item->string);
+				} else {
+					lower_expr(item);
+					gen_print(item->type);
+				}
+			}
+			break;
+		case AST_RETURN:
+			if (node->unary.expr) {
+				lower_expr(node->unary.expr);
+				if (IS_ARRAY_TYPE(routine->type)) {
+					gen_1(JVM_ARETURN);
+				} else {
+					gen_1(JVM_IRETURN);
+				}
+			} else {
+				gen_1(JVM_RETURN);
+			}
+			break;
+		case AST_WHILE:
+			/* test at the bottom, so that an iteration takes one branch */
+			l1 = get_label();
+			l2 = get_label();
+			gen_2_label(JVM_GOTO, l2);
+			gen_label(l1);
+			lower_statements(node->branch.body);
+			gen_label(l2);
+			lower_cond(node->branch.cond, l1, TRUE);
+			break;
+		default:
+			assert(FALSE);
+	}
+}
+
+/**
+ * Stores the value on top of the stack in a variable or, if the array
+ * reference and index were pushed before the value, in an array element.
+ */
+static void lower_store(AstNode *target)
+{
+	if (target->kind == AST_INDEX) {
+		gen_1(JVM_IASTORE);
+	} else if (IS_ARRAY_TYPE(target->ref.prop.type)) {
+		gen_2(JVM_ASTORE, target->ref.prop.offset);
+	} else {
+		gen_2(JVM_ISTORE, target->ref.prop.offset);
+	}
+}
+
+static void lower_expr(AstNode *node)
+{
+	Bytecode opcode;
+	Label l1, l2;
+
+	switch (node->kind) {
+		case AST_NUM:
+		case AST_BOOL:
+			gen_const(node->value);
+			break;
+		case AST_VAR:
+			if (IS_ARRAY_TYPE(node->ref.prop.type)) {
+				gen_2(JVM_ALOAD, node->ref.prop.offset);
+			} else {
+				gen_2(JVM_ILOAD, node->ref.prop.offset);
+			}
+			break;
+		case AST_INDEX:
+			gen_2(JVM_ALOAD, node->ref.prop.offset);
+			lower_expr(node->ref.index);
+			gen_1(JVM_IALOAD);
+			break;
+		case AST_CALL:
+			lower_args(node->ref.args);
+			gen_call(node->ref.id, &node->ref.prop);
+			break;
+		case AST_UNARY:
+			lower_expr(node->unary.expr);
+			if (node->unary.op == TOK_MINUS) {
+				gen_1(JVM_INEG);
+			} else {
+				gen_const(TRUE);
+				gen_1(JVM_IXOR);
+			}
+			break;
+		case AST_BINARY:
+			if (node->binary.op == TOK_AND || node->binary.op == TOK_OR) {
+				l1 = get_label();
+				l2 = get_label();
+				lower_cond(node, l1, FALSE);
+				gen_const(TRUE);
+				gen_2_label(JVM_GOTO, l2);
+				gen_label(l1);
+				gen_const(FALSE);
+				gen_label(l2);
+				break;
+			}
+			lower_expr(node->binary.left);
+			lower_expr(node->binary.right);
+			opcode = binary_opcode(node->binary.op);
+			if (IS_RELOP(node->binary.op)) {
+				gen_cmp(opcode);
+			} else {
+				gen_1(opcode);
+			}
+			break;
+		default:
+			assert(FALSE);
+	}
+}
+
+/**
+ * Lowers a Boolean expression in a branch context: the code jumps to the
+ * target if the expression has the specified value, and falls through
+ * otherwise, without materialising the value if it can help it.  The operators
+ * "and" and "or" short-circuit.
+ */
+static void lower_cond(AstNode *node, Label target, Boolean sense)
+{
+	Label skip;
+	TokenType op;
+
+	switch (node->kind) {
+		case AST_BOOL:
+			if ((node->value != 0) == (sense != FALSE)) {
+				gen_2_label(JVM_GOTO, target);
+			}
+			break;
+		case AST_UNARY:
+			assert(node->unary.op == TOK_NOT);
+			lower_cond(node->unary.expr, target, !sense);
+			break;
+		case AST_BINARY:
+			op = node->binary.op;
+			if (op == TOK_AND || op == TOK_OR) {
+				/* the left operand decides if it is false for "and", or true
+				 * for "or"; whether that is a jump or a skip depends on sense */
+				if ((op == TOK_AND) == sense) {
+					skip = get_label();
+					lower_cond(node->binary.left, skip, !sense);
+					lower_cond(node->binary.right, target, sense);
+					gen_label(skip);
+				} else {
+					lower_cond(node->binary.left, target, sense);
+					lower_cond(node->binary.right, target, sense);
+				}
+			} else if (IS_RELOP(op)) {
+				lower_expr(node->binary.left);
+				lower_expr(node->binary.right);
+				gen_2_label(binary_opcode(sense ? op : negate_relop(op)),
+						target);
+			} else {
+				assert(FALSE);
+			}
+			break;
+		default:
+			lower_expr(node);
+			gen_2_label(sense ? JVM_IFNE : JVM_IFEQ, target);
+			break;
+	}
+}
+
+static void lower_args(AstNode *list)
+{
+	for (; list; list = list->next) {
+		lower_expr(list);
+	}
+}
+
+/**
+ * Returns the instruction for a binary operator: the arithmetic or logical
+ * instruction, or for a relational operator, the comparison that branches if
+ * the relation holds.
+ */
+static Bytecode binary_opcode(TokenType op)
+{
+	switch (op) {
+		case TOK_EQ:    return JVM_IF_ICMPEQ;
+		case TOK_GE:    return JVM_IF_ICMPGE;
+		case TOK_GT:    return JVM_IF_ICMPGT;
+		case TOK_LE:    return JVM_IF_ICMPLE;
+		case TOK_LT:    return JVM_IF_ICMPLT;
+		case TOK_NE:    return JVM_IF_ICMPNE;
+		case TOK_MINUS: return JVM_ISUB;
+		case TOK_OR:    return JVM_IOR;
+		case TOK_PLUS:  return JVM_IADD;
+		case TOK_AND:   return JVM_IAND;
+		case TOK_DIV:   return JVM_IDIV;
+		case TOK_MUL:   return JVM_IMUL;
+		case TOK_REM:   return JVM_IREM;
+		default:
+			assert(FALSE);
+			return JVM_NOP;
+	}
+}
+
+/**
+ * Returns the relational operator that holds exactly when the specified one
+ * does not.
+ */
+static TokenType negate_relop(TokenType op)
+{
+	switch (op) {
+		case TOK_EQ: return TOK_NE;
+		case TOK_GE: return TOK_LT;
+		case TOK_GT: return TOK_LE;
+		case TOK_LE: return TOK_GT;
+		case TOK_LT: return TOK_GE;
+		case TOK_NE: return TOK_EQ;
+		default:
+			assert(FALSE);
+			return op;
+	}
+}
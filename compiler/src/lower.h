@@ -0,0 +1,23 @@
+/**
+ * @file    lower.h
+ * @brief   The lowering pass, which generates JVM code from the abstract
+ *          syntax tree of a type-checked AMPL-2023 program.
+ * @date    2026-10-16
+ */
+
+#ifndef LOWER_H
+#define LOWER_H
+
+#include "ast.h"
+
+/**
+ * Generate the code of every subroutine and of main, and close each of their
+ * bodies, so that the class can be written.  The code generation unit must
+ * have been initialised, and the syntax tree must outlive it.
+ *
+ * @param[in]  program
+ *     the AST_PROGRAM node of the syntax tree
+ */
+void lower_program(AstNode *program);
+
+#endif /* LOWER_H */
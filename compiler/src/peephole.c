@@ -0,0 +1,397 @@
+/**
+ * @file    peephole.c
+ * @brief   A table-driven peephole optimiser for the code arrays of methods.
+ *
+ * The code array is decoded into a sequence of labels and instructions (each
+ * with its operand, if any).  Every rule in the rule table looks at a short
+ * window of this sequence, starting at some position, and rewrites it if it
+ * matches.  Since windows never span a label unless the rule says so, no rule
+ * can change the code that a branch lands on.  Every rule shrinks the
+ * sequence, so that the process terminates.
+ *
+ * @date    2026-10-16
+ */
+
+#include "peephole.h"
+#include "boolean.h"
+#include "error.h"
+
+#include <stdlib.h>
+
+/** a label or an instruction, with its operand, decoded from a code array */
+typedef struct {
+	Code    item;        /**< the label or instruction                 */
+	Code    operand;     /**< the operand of the instruction, if any   */
+	Boolean has_operand; /**< whether the instruction has an operand   */
+} Insn;
+
+/** a rewrite rule, which reports whether it applied at the position */
+typedef Boolean (*Rule)(int i);
+
+/** the largest window of any rule, so that rewrites can cascade backwards */
+#define MAX_WINDOW 7
+
+/* --- function prototypes -------------------------------------------------- */
+
+static Boolean fuse_compare(int i);
+static Boolean fuse_not(int i);
+static Boolean drop_jump_to_next(int i);
+static Boolean drop_unreachable(int i);
+static Boolean drop_unused_label(int i);
+static Boolean collapse_swap(int i);
+
+static Boolean is_label(int i);
+static Boolean is_op(int i, Bytecode opcode);
+static Boolean is_const(int i, int value);
+static Boolean is_simple_push(int i);
+static Bytecode negate(Bytecode opcode);
+static void retarget(int i, Label label);
+static void delete(int i);
+static void compact(void);
+
+/* --- global static variables ---------------------------------------------- */
+
+/** the rules, in the order in which they are tried at every position */
+static const struct {
+	const char *name;
+	Rule        apply;
+} rules[] = {
+	{ "branch on comparison",      fuse_compare      },
+	{ "branch on negation",        fuse_not          },
+	{ "jump to next instruction",  drop_jump_to_next },
+	{ "unreachable instruction",   drop_unreachable  },
+	{ "unused label",              drop_unused_label },
+	{ "swap of simple operands",   collapse_swap     }
+};
+
+/** the conditional branches, and the branches on the opposite condition */
+static const struct {
+	Bytecode branch;
+	Bytecode negation;
+} negations[] = {
+	{ JVM_IFEQ,      JVM_IFNE      },
+	{ JVM_IFNE,      JVM_IFEQ      },
+	{ JVM_IF_ICMPEQ, JVM_IF_ICMPNE },
+	{ JVM_IF_ICMPNE, JVM_IF_ICMPEQ },
+	{ JVM_IF_ICMPLT, JVM_IF_ICMPGE },
+	{ JVM_IF_ICMPGE, JVM_IF_ICMPLT },
+	{ JVM_IF_ICMPGT, JVM_IF_ICMPLE },
+	{ JVM_IF_ICMPLE, JVM_IF_ICMPGT }
+};
+
+#define NRULES     (sizeof(rules) / sizeof(rules[0]))
+#define NNEGATIONS (sizeof(negations) / sizeof(negations[0]))
+
+static _Thread_local Insn         *insns;   /**< the decoded code           */
+static _Thread_local Boolean      *deleted; /**< whether an item is deleted */
+static _Thread_local int           ninsns;  /**< the number of items        */
+static _Thread_local unsigned int *refs;    /**< the branches to each label */
+
+/* --- peephole interface --------------------------------------------------- */
+
+void peephole(Code *code, int *ip)
+{
+	int i, n;
+	unsigned int r;
+	Label max_label;
+
+	/* decode the code array, and find the largest label */
+	insns = emalloc(*ip * sizeof(Insn) + 1);
+	deleted = emalloc(*ip * sizeof(Boolean) + 1);
+	max_label = 0;
+	for (i = 0, n = 0; i < *ip; i++, n++) {
+		insns[n].item = code[i];
+		insns[n].has_operand = FALSE;
+		deleted[n] = FALSE;
+		if ((code[i].type & MASK_TYPE) == CODE_INSTRUCTION && i + 1 < *ip
+				&& (code[i+1].type & CODE_OPERAND)) {
+			insns[n].operand = code[++i];
+			insns[n].has_operand = TRUE;
+		}
+		if (code[i].type & CODE_LABEL && code[i].label > max_label) {
+			max_label = code[i].label;
+		}
+	}
+	ninsns = n;
+
+	/* count the branches to every label */
+	refs = emalloc((max_label + 1) * sizeof(unsigned int));
+	for (r = 0; r <= max_label; r++) {
+		refs[r] = 0;
+	}
+	for (i = 0; i < ninsns; i++) {
+		if (insns[i].has_operand && insns[i].operand.type & CODE_LABEL) {
+			refs[insns[i].operand.label]++;
+		}
+	}
+
+	/* apply the rules until none applies */
+	i = 0;
+	while (i < ninsns) {
+		for (r = 0; r < NRULES; r++) {
+			if (rules[r].apply(i)) {
+				break;
+			}
+		}
+		if (r < NRULES) {
+			compact();
+			i = (i > MAX_WINDOW ? i - MAX_WINDOW : 0);
+		} else {
+			i++;
+		}
+	}
+
+	/* encode the code array */
+	for (i = 0, n = 0; i < ninsns; i++) {
+		code[n++] = insns[i].item;
+		if (insns[i].has_operand) {
+			code[n++] = insns[i].operand;
+		}
+	}
+	*ip = n;
+
+	free(insns);
+	free(deleted);
+	free(refs);
+}
+
+/* --- rules ---------------------------------------------------------------- */
+
+/**
+ * Turns the materialisation of a comparison result that is immediately tested
+ * into a single comparison that branches to the target of the test:
+ *
+ *     if_icmpXX L1; iconst_0; goto L2; L1: iconst_1; L2: ifeq L3
+ *
+ * becomes "if_icmpYY L3", where YY is the opposite of XX (or XX itself if the
+ * test is "ifne").  The labels L1 and L2 must not be used elsewhere.
+ */
+static Boolean fuse_compare(int i)
+{
+	Label l1, l2;
+	Bytecode branch;
+	int k;
+
+	if (i + 6 >= ninsns || !insns[i].has_operand
+			|| is_op(i, JVM_IFEQ) || is_op(i, JVM_IFNE)
+			|| negate(insns[i].item.code) == JVM_NOP) {
+		return FALSE;
+	}
+
+	l1 = insns[i].operand.label;
+	if (!(is_const(i + 1, FALSE) && is_op(i + 2, JVM_GOTO)
+			&& is_label(i + 3) && insns[i+3].item.label == l1
+			&& is_const(i + 4, TRUE) && is_label(i + 5)
+			&& (is_op(i + 6, JVM_IFEQ) || is_op(i + 6, JVM_IFNE)))) {
+		return FALSE;
+	}
+	l2 = insns[i+2].operand.label;
+	if (insns[i+5].item.label != l2 || refs[l1] != 1 || refs[l2] != 1) {
+		return FALSE;
+	}
+
+	branch = insns[i].item.code;
+	insns[i].item.code = (is_op(i + 6, JVM_IFEQ) ? negate(branch) : branch);
+	retarget(i, insns[i+6].operand.label);
+	for (k = 1; k <= 6; k++) {
+		delete(i + k);
+	}
+
+	return TRUE;
+}
+
+/**
+ * Folds a Boolean negation into the test that follows it:
+ *
+ *     iconst_1; ixor; ifeq L    becomes    ifne L
+ *
+ * and likewise for "ifne".
+ */
+static Boolean fuse_not(int i)
+{
+	if (i + 2 >= ninsns || !is_const(i, TRUE) || !is_op(i + 1, JVM_IXOR)
+			|| !(is_op(i + 2, JVM_IFEQ) || is_op(i + 2, JVM_IFNE))) {
+		return FALSE;
+	}
+
+	insns[i+2].item.code = negate(insns[i+2].item.code);
+	delete(i);
+	delete(i + 1);
+
+	return TRUE;
+}
+
+/**
+ * Removes an unconditional jump to one of the labels that immediately follow
+ * it.
+ */
+static Boolean drop_jump_to_next(int i)
+{
+	int k;
+
+	if (!is_op(i, JVM_GOTO)) {
+		return FALSE;
+	}
+
+	for (k = i + 1; k < ninsns && is_label(k); k++) {
+		if (insns[k].item.label == insns[i].operand.label) {
+			delete(i);
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/**
+ * Removes an instruction that follows an unconditional transfer of control,
+ * and therefore cannot be reached except through a label.
+ */
+static Boolean drop_unreachable(int i)
+{
+	if (i + 1 >= ninsns || is_label(i + 1)
+			|| !(is_op(i, JVM_GOTO) || is_op(i, JVM_RETURN)
+				|| is_op(i, JVM_IRETURN) || is_op(i, JVM_ARETURN)
+				|| is_op(i, JVM_ATHROW))) {
+		return FALSE;
+	}
+
+	delete(i + 1);
+
+	return TRUE;
+}
+
+/**
+ * Removes a label that no instruction branches to, which exposes more code to
+ * the other rules.
+ */
+static Boolean drop_unused_label(int i)
+{
+	if (!is_label(i) || refs[insns[i].item.label] > 0) {
+		return FALSE;
+	}
+
+	delete(i);
+
+	return TRUE;
+}
+
+/**
+ * Replaces two simple pushes that are swapped immediately by the same pushes
+ * in the opposite order:
+ *
+ *     iload 1; getstatic out; swap    becomes    getstatic out; iload 1
+ */
+static Boolean collapse_swap(int i)
+{
+	Insn first;
+
+	if (i + 2 >= ninsns || !is_simple_push(i) || !is_simple_push(i + 1)
+			|| !is_op(i + 2, JVM_SWAP)) {
+		return FALSE;
+	}
+
+	first = insns[i];
+	insns[i] = insns[i+1];
+	insns[i+1] = first;
+	delete(i + 2);
+
+	return TRUE;
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+static Boolean is_label(int i)
+{
+	return (insns[i].item.type & MASK_TYPE) == CODE_LABEL;
+}
+
+static Boolean is_op(int i, Bytecode opcode)
+{
+	return (insns[i].item.type & MASK_TYPE) == CODE_INSTRUCTION
+		&& insns[i].item.code == opcode;
+}
+
+/**
+ * Checks whether an instruction pushes the specified integer constant, in
+ * whichever form <code>gen_const</code> chose for it.
+ */
+static Boolean is_const(int i, int value)
+{
+	if (value >= -1 && value <= 5) {
+		return is_op(i, JVM_ICONST_0 + value);
+	}
+	return (is_op(i, JVM_BIPUSH) || is_op(i, JVM_SIPUSH) || is_op(i, JVM_LDC))
+		&& (insns[i].operand.type & MASK_DATA_TYPE) == CODE_INTEGER
+		&& insns[i].operand.num == value;
+}
+
+/**
+ * Checks whether an instruction pushes a single value without popping any, or
+ * any other side effect that its order could expose.
+ */
+static Boolean is_simple_push(int i)
+{
+	return (insns[i].item.type & MASK_TYPE) == CODE_INSTRUCTION
+		&& ((insns[i].item.code >= JVM_ICONST_M1
+				&& insns[i].item.code <= JVM_ICONST_5)
+			|| is_op(i, JVM_BIPUSH) || is_op(i, JVM_SIPUSH)
+			|| is_op(i, JVM_LDC) || is_op(i, JVM_ILOAD) || is_op(i, JVM_ALOAD)
+			|| is_op(i, JVM_GETSTATIC));
+}
+
+/**
+ * Returns the branch on the opposite condition of a conditional branch, or
+ * <code>JVM_NOP</code> if the instruction is not a conditional branch.
+ */
+static Bytecode negate(Bytecode opcode)
+{
+	unsigned int k;
+
+	for (k = 0; k < NNEGATIONS; k++) {
+		if (negations[k].branch == opcode) {
+			return negations[k].negation;
+		}
+	}
+
+	return JVM_NOP;
+}
+
+static void retarget(int i, Label label)
+{
+	refs[insns[i].operand.label]--;
+	insns[i].operand.label = label;
+	refs[label]++;
+}
+
+/**
+ * Marks an item for deletion, releasing its operand and dropping its branch
+ * from the label counts.
+ */
+static void delete(int i)
+{
+	Code *operand;
+
+	if (insns[i].has_operand) {
+		operand = &insns[i].operand;
+		if (operand->type & CODE_LABEL) {
+			refs[operand->label]--;
+		} else if (operand->type & CODE_ALLOCATED) {
+			free(operand->string);
+		}
+	}
+	deleted[i] = TRUE;
+}
+
+static void compact(void)
+{
+	int i, n;
+
+	for (i = 0, n = 0; i < ninsns; i++) {
+		if (!deleted[i]) {
+			insns[n] = insns[i];
+			deleted[n++] = FALSE;
+		}
+	}
+	ninsns = n;
+}
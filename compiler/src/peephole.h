@@ -0,0 +1,25 @@
+/**
+ * @file    peephole.h
+ * @brief   A table-driven peephole optimiser for the code arrays of methods.
+ * @date    2026-10-16
+ */
+
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+#include "codegen.h"
+
+/**
+ * Optimise a code array in place, by repeatedly applying a set of rewrite
+ * rules to short sequences of instructions until none applies any more.  The
+ * optimised code is never longer than the original code, and never needs a
+ * deeper operand stack.
+ *
+ * @param[in,out]  code
+ *     the code array
+ * @param[in,out]  ip
+ *     the number of items in the code array
+ */
+void peephole(Code *code, int *ip);
+
+#endif /* PEEPHOLE_H */
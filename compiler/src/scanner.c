@@ -8,6 +8,7 @@
 
 #include "scanner.h"
 
+#include "arena.h"
 #include "boolean.h"
 #include "error.h"
 #include "token.h"
@@ -17,46 +18,89 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 /* --- global static variables ---------------------------------------------- */
 
-static FILE *src_file; /* the source file pointer             */
-static int ch;         /* the next source character           */
-static int cn;         /* the current column number           */
-static int ln;         /* the current line number             */
-SourcePos posit;
-
-static struct {
+static _Thread_local const unsigned char *src; /* the source text          */
+static _Thread_local size_t src_len;  /* the length of the source text       */
+static _Thread_local size_t src_off;  /* the offset of the next character    */
+static _Thread_local size_t line_off; /* the offset of the current line      */
+static _Thread_local void  *src_map;  /* the mapped source file, if any      */
+static _Thread_local char  *src_copy; /* the source read into memory, if any */
+static _Thread_local int ch;          /* the next source character           */
+static _Thread_local int ln;          /* the current line number             */
+_Thread_local SourcePos posit;
+
+/* The names of the identifiers are interned, and numbered densely from zero in
+ * the order in which they are first seen.  The slots of the open-addressed
+ * table hold one more than the number of a name, so that zero marks an empty
+ * slot, and the table is kept at most half full.
+ */
+typedef struct {
+	char        *name; /* the name, in the arena of the compilation */
+	unsigned int len;  /* the length of the name                     */
+	unsigned int hash; /* the hash of the name                       */
+} Name;
+
+static _Thread_local Name         *names;     /* the names, by number  */
+static _Thread_local unsigned int  nnames;    /* the number of names   */
+static _Thread_local unsigned int  max_names; /* the space for names   */
+static _Thread_local unsigned int *slots;     /* the slots of the table */
+static _Thread_local unsigned int  slot_bits; /* log2 of the slots     */
+
+/* the current column number, derived from the offset of the current line */
+#define cn ((int) (src_off - line_off))
+
+/* The reserved words are found with a perfect hash of the length and the first
+ * and last characters of a word, so that a word is compared with at most one
+ * of them.  The table is laid out by the compiler from the hash; a change that
+ * makes two reserved words share a slot draws an "initialized field
+ * overwritten" warning, and then the multipliers must be chosen anew.
+ */
+#define WORD_SLOTS 32
+#define WORD_HASH(first, last, len) \
+	(((first) * 3 + (last) * 31 + ((len) << 2)) & (WORD_SLOTS - 1))
+#define RESERVED(word, first, last, type) \
+	[WORD_HASH(first, last, sizeof(word) - 1)] = \
+		{ word, sizeof(word) - 1, type }
+
+static const struct {
 	char *word;     /* the reserved word, i.e., the lexeme */
+	size_t len;     /* the length of the reserved word     */
 	TokenType type; /* the associated topen type           */
-} reserved[] = {
-{"and",TOK_AND},
-{"array",TOK_ARRAY},
-{"bool",TOK_BOOL},
-{"chillax",TOK_CHILLAX},
-{"elif",TOK_ELIF},
-{"else",TOK_ELSE},
-{"end",TOK_END},
-{"false",TOK_FALSE},
-{"if",TOK_IF},
-{"input",TOK_INPUT},
-{"int",TOK_INT},
-{"let",TOK_LET},
-{"main",TOK_MAIN},
-{"not",TOK_NOT},
-{"or",TOK_OR},
-{"output",TOK_OUTPUT},
-{"program",TOK_PROGRAM},
-{"rem",TOK_REM},
-{"return",TOK_RETURN},
-{"true",TOK_TRUE},
-{"while",TOK_WHILE}
+} reserved[WORD_SLOTS] = {
+	RESERVED("and",     'a', 'd', TOK_AND),
+	RESERVED("array",   'a', 'y', TOK_ARRAY),
+	RESERVED("bool",    'b', 'l', TOK_BOOL),
+	RESERVED("chillax", 'c', 'x', TOK_CHILLAX),
+	RESERVED("elif",    'e', 'f', TOK_ELIF),
+	RESERVED("else",    'e', 'e', TOK_ELSE),
+	RESERVED("end",     'e', 'd', TOK_END),
+	RESERVED("false",   'f', 'e', TOK_FALSE),
+	RESERVED("if",      'i', 'f', TOK_IF),
+	RESERVED("input",   'i', 't', TOK_INPUT),
+	RESERVED("int",     'i', 't', TOK_INT),
+	RESERVED("let",     'l', 't', TOK_LET),
+	RESERVED("main",    'm', 'n', TOK_MAIN),
+	RESERVED("not",     'n', 't', TOK_NOT),
+	RESERVED("or",      'o', 'r', TOK_OR),
+	RESERVED("output",  'o', 't', TOK_OUTPUT),
+	RESERVED("program", 'p', 'm', TOK_PROGRAM),
+	RESERVED("rem",     'r', 'm', TOK_REM),
+	RESERVED("return",  'r', 'n', TOK_RETURN),
+	RESERVED("true",    't', 'e', TOK_TRUE),
+	RESERVED("while",   'w', 'e', TOK_WHILE)
 };
 
-#define NUM_RESERVED_WORDS (sizeof(reserved) / sizeof(reserved[0]))
-#define MAX_INIT_STR_LEN   (1024)
+#define READ_CHUNK_SIZE    (65536)
 #define true               1
 
+#define INIT_SLOT_BITS     8
+#define SLOT_INDEX(h, bits) \
+	((unsigned int) ((h) * 2654435769u) >> (32 - (bits)))
+
 /* --- function prototypes -------------------------------------------------- */
 
 static void next_char(void);
@@ -64,19 +108,122 @@ static void process_number(Token *token);
 static void process_string(Token *token);
 static void process_word(Token *token);
 static void skip_comment(void);
+static unsigned int intern(const char *name, unsigned int len,
+		unsigned int hash);
+static void grow_slots(void);
 
 /* --- scanner interface ---------------------------------------------------- */
 /**
- * Initialize the scanner with the given input file.
+ * Initialize the scanner with the given input file.  A regular file is mapped
+ * into memory; anything else, such as a pipe, is read into memory in one go.
  * @param in_file The input file pointer.
  */
 void init_scanner(FILE *in_file)
 {
-	src_file = in_file;
+	struct stat sb;
+	size_t n, size;
+
+	src_map = NULL;
+	src_copy = NULL;
+
+	if (fstat(fileno(in_file), &sb) == 0 && S_ISREG(sb.st_mode)
+			&& sb.st_size > 0) {
+		src_map = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE,
+				fileno(in_file), 0);
+		if (src_map == MAP_FAILED) {
+			src_map = NULL;
+		} else {
+#ifdef MADV_SEQUENTIAL
+			madvise(src_map, sb.st_size, MADV_SEQUENTIAL);
+#endif
+			init_scanner_buffer(src_map, sb.st_size);
+			return;
+		}
+	}
+
+	/* fall back to reading the whole stream */
+	size = READ_CHUNK_SIZE;
+	n = 0;
+	src_copy = emalloc(size);
+	while (!feof(in_file)) {
+		if (n == size) {
+			size *= 2;
+			src_copy = erealloc(src_copy, size);
+		}
+		n += fread(src_copy + n, 1, size - n, in_file);
+		if (ferror(in_file)) {
+			eprintf("could not read source file:");
+		}
+	}
+	init_scanner_buffer(src_copy, n);
+}
+
+void init_scanner_buffer(const char *buf, size_t len)
+{
+	src = (const unsigned char *) buf;
+	src_len = len;
+	src_off = line_off = 0;
 	position.line = ln = 1;
-	position.col = cn = 0;
+	position.col = cn;
 	next_char();
 }
+
+const char *get_source_text(size_t *len)
+{
+	*len = src_len;
+	return (const char *) src;
+}
+
+void release_scanner(void)
+{
+	if (src_map != NULL) {
+		munmap(src_map, src_len);
+		src_map = NULL;
+	}
+	if (src_copy != NULL) {
+		free(src_copy);
+		src_copy = NULL;
+	}
+	src = NULL;
+
+	/* the names themselves belong to the arena of the compilation */
+	free(names);
+	free(slots);
+	names = NULL;
+	slots = NULL;
+	nnames = max_names = slot_bits = 0;
+}
+
+unsigned int intern_name(const char *name)
+{
+	return intern(name, strlen(name), hash_name(name));
+}
+
+const char *get_name(unsigned int sym)
+{
+	return (sym < nnames ? names[sym].name : NULL);
+}
+
+void mark_scanner(ScanMark *mark)
+{
+	mark->src_off = src_off;
+	mark->line_off = line_off;
+	mark->ch = ch;
+	mark->ln = ln;
+	mark->position = position;
+	mark->posit = posit;
+}
+
+void reset_scanner(const ScanMark *mark)
+{
+	src_off = mark->src_off;
+	line_off = mark->line_off;
+	ch = mark->ch;
+	ln = mark->ln;
+	position = mark->position;
+	posit = mark->posit;
+}
+
 /**
  * Get the next token from the source code.
  * @param token The token structure to fill.
@@ -246,19 +393,22 @@ void get_token(Token *token)
 
 /* --- utility functions ---------------------------------------------------- */
 /**
- * Advance to the next character in the input file.
+ * Advance to the next character in the source text.  The column number is not
+ * tracked here, but derived from the offset of the start of the line.
  */
 void next_char(void)
 {
-	ch = getc(src_file);
-
-	if (ch == '\n') {
-		posit.line = ln;
-		posit.col = cn;
-		ln++;
-		cn = 0;
+	if (src_off < src_len) {
+		ch = src[src_off++];
+		if (ch == '\n') {
+			posit.line = ln;
+			posit.col = cn - 1;
+			ln++;
+			line_off = src_off;
+		}
 	} else {
-		cn++;
+		ch = EOF;
+		src_off++;
 	}
 }
 
@@ -297,28 +447,24 @@ void process_number(Token *token)
 	token->value = value;
 }
 /**
- * Process string's and stores them in the updated_string varible.
+ * Process string's and stores them in the arena of the compilation, as they
+ * are written in the source text, escape codes and all.
  * @param token pointer to the token structure to fill.
  */
 void process_string(Token *token)
 {
-
-	size_t i, nstring = MAX_INIT_STR_LEN;
-	int j;
-	char *current_string = malloc(nstring);
-	char *updated_string = current_string;
-	/* clear the updated string for next string */
-	for (j = 0; j < MAX_INIT_STR_LEN; j++) {
-		updated_string[j] = '\0';
-	}
-	updated_string[MAX_INIT_STR_LEN] = '\0';
-
+	size_t start;
 	int temp_col_number;
 	int temp_line_number;
 
 	SourcePos ip = position;
 
-	i = 0;
+	/* a newline right after the opening quote is reported just after it */
+	temp_line_number = ip.line;
+	temp_col_number = ip.col;
+
+	/* the string is a slice of the source text, copied once it is closed */
+	start = src_off - 1;
 	while (ch != '"') {
 
 		/* If ch is a non-printibale character */
@@ -332,18 +478,12 @@ void process_string(Token *token)
 
 		/* For a '\' variants */
 		if (ch == 92) {
-			updated_string[i] = '\\';
-			i++;
 			next_char();
 			switch (ch) {
 				case 'n':
 				case 't':
-					break;
 				case 34:
-					ch = '"';
-					break;
 				case 92:
-					ch = '\\';
 					break;
 				default:
 					position.col = cn - 1;
@@ -353,15 +493,8 @@ void process_string(Token *token)
 			}
 		}
 
-		/* Doubles the size of the updated_string */
-		if (i == nstring) {
-			nstring *= 2;
-			updated_string = realloc(updated_string, nstring);
-		}
-
 		temp_line_number = ln;
 		temp_col_number = cn;
-		updated_string[i++] = ch;
 
 		next_char();
 
@@ -375,66 +508,49 @@ void process_string(Token *token)
 		}
 	}
 	token->type = TOK_STR;
-	token->string = updated_string;
+	token->string = unit_strndup((const char *) src + start,
+			src_off - 1 - start);
 
 	next_char();
 }
 /**
- * Process words and checks if they are reserved words or identifiers.
+ * Process words and checks if they are reserved words or identifiers.  The
+ * word is hashed as it is read, so that an identifier is interned without
+ * another pass over it.
  * @param token pointer to the token structure to fill.
  */
 void process_word(Token *token)
 {
-	char lexeme[MAX_ID_LEN+1];
-	int cmp, lowest, middle, highest;
+	unsigned int len, hash, h;
 	position.col = cn;
 
-	/* Fills array with 0 and a \0 at the end */
-	memset(lexeme, 0, MAX_ID_LEN);
-	lexeme[MAX_ID_LEN] = '\0';
-
 	/* check that the id length is less than the maximum and
-	   populates the lexeme[] array */
-	int x = 0;
+	   populates the lexeme of the token */
+	len = 0;
+	hash = 0;
 	do {
-		if (x >= MAX_ID_LEN) {
+		if (len >= MAX_ID_LEN) {
 			leprintf("identifier too long");
 			break;
 		}
 
-		lexeme[x] = ch;
+		token->lexeme[len++] = ch;
+		hash = HASH_NAME_STEP(hash, ch);
 		next_char();
-		x++;
 
 	} while ((ch >= 48 && ch <= 57) || isalpha(ch) || ch == '_');
-
-	/* do a binary search through the array of reserved words */
-	lowest = 0;
-	middle = NUM_RESERVED_WORDS / 2;
-	highest = NUM_RESERVED_WORDS;
-	int token_found = 0;
-
-	while (lowest < highest) {
-
-		middle = lowest + (highest - lowest) / 2;
-		cmp = strcmp(lexeme, reserved[middle].word);
-
-		/* If Lexeme is a reserved words */
-		if (cmp == 0) {
-			token->type = reserved[middle].type;
-			strcpy(token->lexeme, lexeme);
-			token_found = 1;
-			break;
-		} else if (cmp < 0) {
-			highest = middle;
-		} else {
-			lowest = middle + 1;
-		}
-	}
-	/* Otherwise Lexeme is an ID */
-	if (token_found == 0) {
+	token->lexeme[len] = '\0';
+	token->len = len;
+
+	/* only the reserved word in the slot of the word can match it */
+	h = WORD_HASH((unsigned char) token->lexeme[0],
+			(unsigned char) token->lexeme[len - 1], len);
+	if (reserved[h].len == len
+			&& memcmp(token->lexeme, reserved[h].word, len) == 0) {
+		token->type = reserved[h].type;
+	} else {
 		token->type = TOK_ID;
-		strcpy(token->lexeme, lexeme);
+		token->sym = intern(token->lexeme, len, hash);
 	}
 }
 
@@ -466,3 +582,59 @@ void skip_comment(void)
 		}
 	}
 }
+
+/**
+ * Returns the number of a name, which is numbered first if it has not been
+ * seen before.
+ */
+unsigned int intern(const char *name, unsigned int len, unsigned int hash)
+{
+	unsigned int i, mask;
+	Name *n;
+
+	if (2 * (nnames + 1) > (1u << slot_bits)) {
+		grow_slots();
+	}
+
+	mask = (1u << slot_bits) - 1;
+	for (i = SLOT_INDEX(hash, slot_bits); slots[i] != 0; i = (i + 1) & mask) {
+		n = &names[slots[i] - 1];
+		if (n->hash == hash && n->len == len
+				&& memcmp(n->name, name, len) == 0) {
+			return slots[i] - 1;
+		}
+	}
+
+	if (nnames == max_names) {
+		max_names = (max_names == 0 ? 1u << (INIT_SLOT_BITS - 1)
+				: 2 * max_names);
+		names = erealloc(names, max_names * sizeof(Name));
+	}
+	n = &names[nnames];
+	n->name = unit_strndup(name, len);
+	n->len = len;
+	n->hash = hash;
+	slots[i] = ++nnames;
+
+	return nnames - 1;
+}
+
+/** Doubles the slots of the table of names, and enters the names anew. */
+void grow_slots(void)
+{
+	unsigned int i, j, mask;
+
+	free(slots);
+	slot_bits = (slot_bits == 0 ? INIT_SLOT_BITS : slot_bits + 1);
+	slots = emalloc((1u << slot_bits) * sizeof(unsigned int));
+	memset(slots, 0, (1u << slot_bits) * sizeof(unsigned int));
+
+	mask = (1u << slot_bits) - 1;
+	for (i = 0; i < nnames; i++) {
+		j = SLOT_INDEX(names[i].hash, slot_bits);
+		while (slots[j] != 0) {
+			j = (j + 1) & mask;
+		}
+		slots[j] = i + 1;
+	}
+}
@@ -9,17 +9,84 @@
 #ifndef SCANNER_H
 #define SCANNER_H
 
+#include <stddef.h>
 #include <stdio.h>
+#include "error.h"
 #include "token.h"
 
+/** a position in the source text, to which the scanner can be reset */
+typedef struct {
+	size_t    src_off;  /**< the offset of the next character   */
+	size_t    line_off; /**< the offset of the current line     */
+	int       ch;       /**< the next source character          */
+	int       ln;       /**< the current line number            */
+	SourcePos position; /**< the position of the last token     */
+	SourcePos posit;    /**< the position of the last line end  */
+} ScanMark;
+
 /**
- * Initialise the scanner.
+ * Initialise the scanner.  The source file is mapped into memory if it is a
+ * regular file, or read into memory otherwise, and the file pointer is not
+ * used after this call.
  *
  * @param[in]   in_file
  *     the (already open) source file
  */
 void init_scanner(FILE *in_file);
 
+/**
+ * Initialise the scanner to read from a source text in memory.  The buffer
+ * must remain valid until scanning is complete.
+ *
+ * @param[in]   buf
+ *     the source text, which need not be NUL-terminated
+ * @param[in]   len
+ *     the length of the source text in bytes
+ */
+void init_scanner_buffer(const char *buf, size_t len);
+
+/**
+ * Get the source text that the scanner reads, as set up by the last
+ * initialisation.
+ *
+ * @param[out]  len
+ *     the length of the source text in bytes
+ * @return
+ *     the source text, which is not NUL-terminated
+ */
+const char *get_source_text(size_t *len);
+
+/**
+ * Release the memory resources held by the scanner, and forget the interned
+ * names.  Any strings returned in tokens, and the names, remain valid, since
+ * they belong to the arena of the compilation.
+ */
+void release_scanner(void);
+
+/**
+ * Intern a name that does not come from the scanner, such as one that a test
+ * enters in the symbol table directly.  The scanner interns every identifier
+ * that it reads, and returns the number of its name in the token.
+ *
+ * @param[in]   name
+ *     the name, which is copied into the arena of the compilation
+ * @return
+ *     the number of the name, which is the same for every occurrence of it
+ *     until the scanner is released
+ */
+unsigned int intern_name(const char *name);
+
+/**
+ * Get the interned name with the specified number.
+ *
+ * @param[in]   sym
+ *     the number of the name
+ * @return
+ *     the name, which must not be changed, or <code>NULL</code> if no name
+ *     has the number
+ */
+const char *get_name(unsigned int sym);
+
 /**
  * Get the next token from the input (source) file.
  *
@@ -28,4 +95,21 @@ void init_scanner(FILE *in_file);
  */
 void get_token(Token *token);
 
+/**
+ * Mark the current position of the scanner, so that the tokens that follow
+ * can be scanned again.
+ *
+ * @param[out]  mark
+ *     receives the position of the scanner
+ */
+void mark_scanner(ScanMark *mark);
+
+/**
+ * Reset the scanner to a position marked earlier in the same source text.
+ *
+ * @param[in]   mark
+ *     the position to which to return
+ */
+void reset_scanner(const ScanMark *mark);
+
 #endif /* SCANNER_H */
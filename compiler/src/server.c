@@ -0,0 +1,465 @@
+/**
+ * @file    server.c
+ * @brief   A compile server that stays resident and accepts compile requests
+ *          over a Unix domain socket.
+ *
+ * Requests are served one at a time, in the server process itself, so that
+ * nothing but the compilation is repeated per request.  The compiler units are
+ * initialised and released for every compilation, and fatal errors return to
+ * the compile function rather than terminate the server.  While a request is
+ * compiled, standard error goes to a temporary file, which becomes the
+ * diagnostics of the reply, and the working directory is that of the client.
+ * So that a client that is slow or stuck cannot hold up the others for long,
+ * every read and write on a connection times out, and the lines of a request
+ * are bounded in length, as is the source text.
+ *
+ * @date    2026-10-16
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "boolean.h"
+#include "error.h"
+#include "server.h"
+
+/* --- type definitions and constants --------------------------------------- */
+
+#define SERVER_BACKLOG 16
+#define USAGE_STATUS   2
+
+/* the largest source text that a client may send, which bounds the memory
+ * that one request can take */
+#define MAX_SOURCE_SIZE (256UL * 1024 * 1024)
+
+/* the pause before accepting again when the process is out of resources,
+ * such as descriptors, so that the server does not spin */
+#define ACCEPT_PAUSE_US 100000
+
+/* the seconds that a read or a write on a connection may wait for the client,
+ * after which the request is rejected */
+#define REQUEST_TIMEOUT 5
+
+/* the longest line of a request, which must hold a "cwd" line */
+#define MAX_LINE_LENGTH (PATH_MAX + 16)
+
+/** the kinds of requests */
+typedef enum {
+	REQUEST_COMPILE,
+	REQUEST_SHUTDOWN,
+	REQUEST_INVALID
+} RequestKind;
+
+/* --- function prototypes -------------------------------------------------- */
+
+static Boolean serve(int fd, Compiler compile, int home);
+static RequestKind read_request(FILE *in, Request *req, char **cwd,
+		FILE *diag);
+static void reply(FILE *out, int status, const char *output, FILE *diag);
+static void request_error(FILE *diag, const char *fmt, ...);
+static void read_error(FILE *diag);
+static char *read_line(FILE *in, FILE *diag, Boolean *failed);
+static Boolean has_prefix(const char *s, const char *prefix,
+		const char **rest);
+
+/* --- server interface ----------------------------------------------------- */
+
+int run_server(const char *socket_path, Compiler compile)
+{
+	int listener, fd, home, probe;
+	struct sockaddr_un addr;
+	Boolean running;
+
+	if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+		eprintf("Socket path too long: '%s'", socket_path);
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, socket_path);
+
+	/* replace the socket of a server that did not shut down cleanly, but not
+	 * that of a server that is still running */
+	if ((probe = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+		eprintf("Could not create socket:");
+	}
+	if (connect(probe, (struct sockaddr *) &addr, sizeof(addr)) == 0) {
+		eprintf("A server is already listening on '%s'", socket_path);
+	} else if (errno == ECONNREFUSED) {
+		unlink(socket_path);
+	}
+	close(probe);
+
+	if ((listener = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+		eprintf("Could not create socket:");
+	}
+	if (bind(listener, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+		eprintf("Could not bind socket '%s':", socket_path);
+	}
+	if (listen(listener, SERVER_BACKLOG) < 0) {
+		eprintf("Could not listen on socket '%s':", socket_path);
+	}
+	if ((home = open(".", O_RDONLY)) < 0) {
+		eprintf("Could not open the working directory:");
+	}
+
+	/* a client that goes away must not take the server with it */
+	signal(SIGPIPE, SIG_IGN);
+
+	running = TRUE;
+	while (running) {
+		if ((fd = accept(listener, NULL, NULL)) < 0) {
+			/* only a broken listening socket ends the server; a failure
+			 * of one connection, or a shortage of descriptors or memory,
+			 * is reported, and the next connection is served */
+			switch (errno) {
+				case EINTR:
+					break;
+				case EBADF:
+				case EINVAL:
+				case ENOTSOCK:
+				case EOPNOTSUPP:
+					eprintf("Could not accept connection:");
+					break;
+				case EMFILE:
+				case ENFILE:
+				case ENOBUFS:
+				case ENOMEM:
+					weprintf("Could not accept connection:");
+					usleep(ACCEPT_PAUSE_US);
+					break;
+				default:
+					weprintf("Could not accept connection:");
+					break;
+			}
+			continue;
+		}
+		running = serve(fd, compile, home);
+	}
+
+	close(listener);
+	unlink(socket_path);
+	close(home);
+
+	return EXIT_SUCCESS;
+}
+
+/* --- request handling ----------------------------------------------------- */
+
+/**
+ * Serves the request on a connection, and closes the connection.
+ *
+ * @param[in] fd      the connection.
+ * @param[in] compile the function that carries out the compilation.
+ * @param[in] home    the working directory of the server, to return to.
+ * @return    <code>FALSE</code> if the server must shut down, and
+ *            <code>TRUE</code> otherwise.
+ */
+static Boolean serve(int fd, Compiler compile, int home)
+{
+	int status, saved;
+	FILE *in, *out, *diag;
+	char *cwd, *output, dir[PATH_MAX];
+	struct timeval timeout;
+	Request req;
+	RequestKind kind;
+
+	timeout.tv_sec = REQUEST_TIMEOUT;
+	timeout.tv_usec = 0;
+	if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0
+			|| setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout,
+				sizeof(timeout)) < 0) {
+		weprintf("Could not set up connection:");
+		close(fd);
+		return TRUE;
+	}
+
+	in = fdopen(fd, "r");
+	out = fdopen(dup(fd), "w");
+	diag = tmpfile();
+	if (in == NULL || out == NULL || diag == NULL) {
+		weprintf("Could not set up connection:");
+		if (in != NULL) {
+			fclose(in);
+		} else {
+			close(fd);
+		}
+		if (out != NULL) {
+			fclose(out);
+		}
+		if (diag != NULL) {
+			fclose(diag);
+		}
+		return TRUE;
+	}
+
+	memset(&req, 0, sizeof(req));
+	cwd = NULL;
+	output = NULL;
+	status = USAGE_STATUS;
+
+	kind = read_request(in, &req, &cwd, diag);
+	if (kind == REQUEST_COMPILE) {
+		fflush(stderr);
+		saved = dup(STDERR_FILENO);
+		dup2(fileno(diag), STDERR_FILENO);
+
+		if (cwd != NULL && chdir(cwd) != 0) {
+			request_error(stderr, "could not change to directory '%s': %s",
+					cwd, strerror(errno));
+		} else {
+			status = compile(&req);
+		}
+
+		fflush(stderr);
+		dup2(saved, STDERR_FILENO);
+		close(saved);
+
+		/* report the output by its absolute path */
+		if (req.output != NULL) {
+			if (req.output[0] != '/' && getcwd(dir, sizeof(dir)) != NULL) {
+				output = emalloc(strlen(dir) + strlen(req.output) + 2);
+				sprintf(output, "%s/%s", dir, req.output);
+			} else {
+				output = estrdup(req.output);
+			}
+		}
+		if (fchdir(home) != 0) {
+			eprintf("Could not return to the working directory:");
+		}
+	}
+
+	if (kind != REQUEST_SHUTDOWN) {
+		reply(out, status, output, diag);
+	}
+
+	fclose(in);
+	fclose(out);
+	fclose(diag);
+	free(cwd);
+	free(output);
+	free(req.src_name);
+	free(req.source);
+	free(req.output);
+
+	return (kind != REQUEST_SHUTDOWN);
+}
+
+/**
+ * Reads a request, up to and including the line that names the source.
+ *
+ * @param[in]  in   the connection.
+ * @param[out] req  the compilation requested.
+ * @param[out] cwd  the working directory requested, or <code>NULL</code>.
+ * @param[in]  diag where to report an invalid request.
+ * @return     the kind of request.
+ */
+static RequestKind read_request(FILE *in, Request *req, char **cwd,
+		FILE *diag)
+{
+	char *line, *end;
+	const char *rest;
+	unsigned long length;
+	Boolean failed;
+	RequestKind kind;
+
+	kind = REQUEST_INVALID;
+	failed = FALSE;
+	while (req->src_name == NULL && (line = read_line(in, diag, &failed))
+			!= NULL) {
+		if (strcmp(line, "shutdown") == 0) {
+			free(line);
+			return REQUEST_SHUTDOWN;
+		} else if (has_prefix(line, "cwd ", &rest)) {
+			free(*cwd);
+			*cwd = estrdup(rest);
+		} else if (has_prefix(line, "option ", &rest)) {
+			if (strcmp(rest, "--jasmin") == 0) {
+				req->use_jasmin = TRUE;
+			} else if (strcmp(rest, "--target=jvm") == 0) {
+				req->native = FALSE;
+			} else if (strcmp(rest, "--target=x86_64") == 0) {
+				req->native = TRUE;
+			} else {
+				request_error(diag, "unsupported option '%s'", rest);
+				free(line);
+				return REQUEST_INVALID;
+			}
+		} else if (has_prefix(line, "file ", &rest)) {
+			req->src_name = estrdup(rest);
+			kind = REQUEST_COMPILE;
+		} else if (has_prefix(line, "source ", &rest)) {
+			errno = 0;
+			length = strtoul(rest, &end, 10);
+			if (!isdigit((unsigned char) *rest) || *end != ' '
+					|| end[1] == '\0') {
+				request_error(diag, "malformed source line");
+				free(line);
+				return REQUEST_INVALID;
+			}
+			/* the length comes from the client: bound it before it is
+			 * allocated, and allocate without terminating the server */
+			if (errno == ERANGE || length > MAX_SOURCE_SIZE) {
+				request_error(diag, "source text longer than %lu bytes",
+						MAX_SOURCE_SIZE);
+				free(line);
+				return REQUEST_INVALID;
+			}
+			req->length = length;
+			req->src_name = estrdup(end + 1);
+			if ((req->source = wemalloc(req->length + 1)) == NULL) {
+				request_error(diag, "no memory for %lu bytes of source text",
+						length);
+				free(line);
+				return REQUEST_INVALID;
+			}
+			if (fread(req->source, 1, req->length, in) != req->length) {
+				if (ferror(in)) {
+					read_error(diag);
+				} else {
+					request_error(diag, "source text shorter than %lu bytes",
+							(unsigned long) req->length);
+				}
+				free(line);
+				return REQUEST_INVALID;
+			}
+			kind = REQUEST_COMPILE;
+		} else {
+			request_error(diag, "malformed request line '%s'", line);
+			free(line);
+			return REQUEST_INVALID;
+		}
+		free(line);
+	}
+
+	if (kind == REQUEST_INVALID) {
+		if (!failed) {
+			request_error(diag, "request does not name a source");
+		}
+		return REQUEST_INVALID;
+	}
+	if (req->use_jasmin && req->native) {
+		request_error(diag, "--jasmin cannot be used with --target=x86_64");
+		kind = REQUEST_INVALID;
+	}
+
+	return kind;
+}
+
+/**
+ * Writes the reply to a request.
+ *
+ * @param[in] out    the connection.
+ * @param[in] status the exit status of the compilation.
+ * @param[in] output the absolute path of the output, or <code>NULL</code>.
+ * @param[in] diag   the diagnostics of the compilation.
+ */
+static void reply(FILE *out, int status, const char *output, FILE *diag)
+{
+	long n;
+	int c;
+
+	fprintf(out, "status %d\n", status);
+	if (status == EXIT_SUCCESS && output != NULL) {
+		fprintf(out, "output %s\n", output);
+	}
+	fflush(diag);
+	n = ftell(diag);
+	fprintf(out, "diagnostics %ld\n", n < 0 ? 0 : n);
+	rewind(diag);
+	while (n-- > 0 && (c = getc(diag)) != EOF) {
+		putc(c, out);
+	}
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+/**
+ * Reports an error in a request, in the form of the errors of the compiler.
+ */
+static void request_error(FILE *diag, const char *fmt, ...)
+{
+	va_list args;
+
+	fprintf(diag, "%s: error: ", getprogname());
+	va_start(args, fmt);
+	vfprintf(diag, fmt, args);
+	va_end(args);
+	fprintf(diag, "\n");
+}
+
+/**
+ * Reports a failed read from a connection, which is most likely a client that
+ * did not send its request in time.
+ */
+static void read_error(FILE *diag)
+{
+	if (errno == EAGAIN || errno == EWOULDBLOCK) {
+		request_error(diag, "client sent nothing for %d seconds",
+				REQUEST_TIMEOUT);
+	} else {
+		request_error(diag, "could not read request: %s", strerror(errno));
+	}
+}
+
+/**
+ * Returns a newly allocated line, without its newline, or <code>NULL</code> at
+ * the end of the input, or if the read failed or the line is too long, which
+ * is reported and flagged.
+ */
+static char *read_line(FILE *in, FILE *diag, Boolean *failed)
+{
+	char line[MAX_LINE_LENGTH + 2];
+	size_t n;
+
+	*failed = FALSE;
+	if (fgets(line, sizeof(line), in) == NULL) {
+		if (ferror(in)) {
+			read_error(diag);
+			*failed = TRUE;
+		}
+		return NULL;
+	}
+
+	n = strlen(line);
+	if (n > 0 && line[n-1] == '\n') {
+		line[n-1] = '\0';
+	} else if (n > MAX_LINE_LENGTH) {
+		request_error(diag, "request line longer than %d bytes",
+				MAX_LINE_LENGTH);
+		*failed = TRUE;
+		return NULL;
+	} else if (ferror(in)) {
+		read_error(diag);
+		*failed = TRUE;
+		return NULL;
+	}
+
+	return estrdup(line);
+}
+
+/**
+ * Checks whether a string starts with a prefix, and points to the rest of it
+ * if it does.
+ */
+static Boolean has_prefix(const char *s, const char *prefix, const char **rest)
+{
+	size_t n;
+
+	n = strlen(prefix);
+	if (strncmp(s, prefix, n) != 0) {
+		return FALSE;
+	}
+	*rest = s + n;
+
+	return TRUE;
+}
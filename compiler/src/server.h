@@ -0,0 +1,55 @@
+/**
+ * @file    server.h
+ * @brief   A compile server that stays resident and accepts compile requests
+ *          over a Unix domain socket.
+ *
+ * The protocol is line-based text, with one request per connection.  A request
+ * is a sequence of lines, which ends with the line that names the source:
+ *
+ *     cwd <directory>              the directory to compile in (optional)
+ *     option <flag>                an amplc flag: --jasmin, --target=jvm, or
+ *                                  --target=x86_64 (zero or more)
+ *     file <path>                  compile a source file, or
+ *     source <length> <name>       compile the <length> bytes that follow,
+ *                                  reported under <name> in diagnostics
+ *
+ * A request that consists of the single line "shutdown" stops the server.  The
+ * reply gives the exit status that amplc would have returned, the paths of the
+ * files produced, and the text that amplc would have written to standard
+ * error:
+ *
+ *     status <exit status>
+ *     output <path>                (zero or more)
+ *     diagnostics <length>
+ *     <length bytes>
+ *
+ * @date    2026-10-16
+ */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "libamplc.h"
+
+/**
+ * A function that carries out a compilation.  It must return with the exit
+ * status of the compilation, even on errors, with all the resources of the
+ * compilation released, except for the name of the output file.
+ */
+typedef int (*Compiler)(Request *req);
+
+/**
+ * Listen for compile requests on a Unix domain socket, and serve them one at a
+ * time until a shutdown request arrives.  A stale socket at the path is
+ * replaced, but it is an error if a server still listens on it.
+ *
+ * @param[in]  socket_path
+ *     the path of the socket
+ * @param[in]  compile
+ *     the function that carries out the compilations
+ * @return
+ *     the exit status of the server
+ */
+int run_server(const char *socket_path, Compiler compile);
+
+#endif /* SERVER_H */
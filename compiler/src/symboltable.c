@@ -9,81 +9,99 @@
 
 #include "boolean.h"
 #include "error.h"
-#include "hashtable.h"
-#include "token.h"
+#include "scanner.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+/* The scopes form a stack.  Every name that is entered is pushed onto a log
+ * of bindings, with the binding that it shadows, if any, and the innermost
+ * binding of every name is found through an array indexed by the number of
+ * the name, which the scanner hands out densely.  A lookup is thus one probe.
+ * Leaving a scope pops its bindings off the log and restores the bindings
+ * that they shadowed, in time proportional to the names in the scope.  The
+ * log, the marks, and the array are kept from one scope to the next, so that
+ * a scope costs no allocation once they have grown.
+ */
+typedef struct {
+	IDPropt     *prop;   /* the properties of the name                  */
+	unsigned int sym;    /* the number of the name                      */
+	unsigned int shadow; /* one more than the binding that this shadows */
+} Binding;
+
+#define INIT_SIZE 64
+
 /* --- global static variables ---------------------------------------------- */
 
-static HashTab *table, *saved_table;
+static _Thread_local Binding      *bindings;     /* the log, innermost last  */
+static _Thread_local unsigned int  nbindings;    /* the bindings in the log  */
+static _Thread_local unsigned int  max_bindings; /* the space for bindings   */
+static _Thread_local unsigned int *bound;        /* one more than the inner- */
+static _Thread_local unsigned int  max_bound;    /* most binding, or 0       */
+static _Thread_local unsigned int *marks;        /* where each scope starts  */
+static _Thread_local unsigned int  depth;        /* the open scopes          */
+static _Thread_local unsigned int  max_marks;    /* the space for marks      */
+static _Thread_local Boolean       active;       /* whether initialised      */
 /* TODO: Nothing here, but note that the next variable keeps a running count of
  * the number of variables in the current symbol table.  It will be necessary
  * during code generation to compute the size of the local variable array of a
  * method frame in the Java virtual machine.
  */
-static unsigned int curr_offset;
+static _Thread_local unsigned int curr_offset;
 
 /* --- function prototypes -------------------------------------------------- */
 
-static void valstr(void *key, void *p, char *str);
-static void freeprop(void *p);
-static unsigned int shift_hash(void *key, unsigned int size);
-static int key_strcmp(void *val1, void *val2);
+static void open_scope(void);
+static void close_scope(void);
+static Boolean bind(unsigned int sym, IDPropt *prop);
+static void *grow(void *array, unsigned int *max, unsigned int need,
+		size_t size);
+static void valstr(const char *name, IDPropt *p, char *str);
 
 /* --- symbol table interface ----------------------------------------------- */
 
 void init_symbol_table(void)
 {
-	saved_table = NULL;
-	if ((table = ht_init(0.75f, shift_hash, key_strcmp)) == NULL) {
-		eprintf("Symbol table could not be initialised");
+	/* the arrays of an earlier compilation on this thread are reused */
+	while (depth > 0) {
+		close_scope();
 	}
+	active = TRUE;
+	open_scope();
 	curr_offset = 1;
 }
 
-Boolean open_subroutine(char *id, IDPropt *prop)
+Boolean open_subroutine(unsigned int sym, IDPropt *prop)
 {
-	if (table == NULL) {
-		return FALSE;
-	}
-	if (ht_insert(table, id, prop) != EXIT_SUCCESS) {
+	if (!active || depth != 1 || !bind(sym, prop)) {
 		return FALSE;
 	}
 
-	saved_table = table;
-
-	table = ht_init(0.75f, shift_hash, key_strcmp);
-
-	if (table == NULL) {
-		return FALSE;
-	}
-	curr_offset = 1;
+	open_scope();
+	/* parameters are the first local variables of a static method */
+	curr_offset = 0;
 	return TRUE;
 }
 
 void close_subroutine(void)
 {
 	/* TODO: Release the subroutine table, and reactivate the global table. */
-	if (table != NULL) {
-		release_symbol_table();
-		table = saved_table;
-		saved_table = NULL;
+	if (depth > 1) {
+		close_scope();
 	}
-	curr_offset = 0;
+	/* the local variables of main follow its argument array */
+	curr_offset = 1;
 }
 
-Boolean insert_name(char *id, IDPropt *prop)
+Boolean insert_name(unsigned int sym, IDPropt *prop)
 {
 	/* Check if the symbol table is initialized */
-	if (table == NULL) {
+	if (!active) {
 		return FALSE;
 	}
 
-	/* Insert the identifier properties into the hash table */
-	if (ht_insert(table, id, prop) != EXIT_SUCCESS) {
+	if (!bind(sym, prop)) {
 		return FALSE;
 	}
 
@@ -95,14 +113,18 @@ Boolean insert_name(char *id, IDPropt *prop)
 	return TRUE;
 }
 
-Boolean find_name(char *id, IDPropt **prop)
+Boolean find_name(unsigned int sym, IDPropt **prop)
 {
-	*prop = ht_search(table, id);
-	if (!*prop && saved_table) {
-		*prop = ht_search(saved_table, id);
-		if (*prop && !IS_CALLABLE_TYPE((*prop)->type)) {
-			*prop = NULL;
-		}
+	unsigned int b;
+
+	*prop = NULL;
+	if (!active || sym >= max_bound || (b = bound[sym]) == 0) {
+		return FALSE;
+	}
+
+	/* only the subroutines of an enclosing scope are visible */
+	if (b > marks[depth - 1] || IS_CALLABLE_TYPE(bindings[b - 1].prop->type)) {
+		*prop = bindings[b - 1].prop;
 	}
 
 	return (*prop ? TRUE : FALSE);
@@ -115,71 +137,93 @@ int get_variables_width(void)
 
 void release_symbol_table(void)
 {
-	if (table != NULL) {
-		ht_free(table, free, freeprop);
-	}
+	free(bindings);
+	free(bound);
+	free(marks);
+	bindings = NULL;
+	bound = marks = NULL;
+	nbindings = max_bindings = max_bound = depth = max_marks = 0;
+	active = FALSE;
 }
 
 void print_symbol_table(void)
 {
-	ht_print(table, valstr);
+	unsigned int i;
+	char buffer[2 * MAX_ID_LEN + 64];
+
+	if (!active) {
+		return;
+	}
+	for (i = marks[depth - 1]; i < nbindings; i++) {
+		valstr(get_name(bindings[i].sym), bindings[i].prop, buffer);
+		printf("symbol[%2u] --> %s\n", bindings[i].sym, buffer);
+	}
 }
 
 /* --- utility functions ---------------------------------------------------- */
 
-static void valstr(void *key, void *p, char *str)
+static void open_scope(void)
 {
-	char *keystr = (char *) key;
-	IDPropt *idpp = (IDPropt *) p;
-
-	if (IS_CALLABLE_TYPE(idpp->type)) {
-		sprintf(str, "%s@_[%s]", keystr, get_valtype_string(idpp->type));
-	} else {
-		sprintf(str, "%s@%d[%s]", keystr, idpp->offset,
-		        get_valtype_string(idpp->type));
-	}
+	marks = grow(marks, &max_marks, depth + 1, sizeof(unsigned int));
+	marks[depth++] = nbindings;
 }
 
-static void freeprop(void *p)
+/* The bindings of the scope are undone in the reverse order of binding. */
+static void close_scope(void)
 {
-	IDPropt *idpp = (IDPropt *) p;
-	free(idpp);
+	Binding *b;
+
+	depth--;
+	while (nbindings > marks[depth]) {
+		b = &bindings[--nbindings];
+		bound[b->sym] = b->shadow;
+	}
 }
 
-static unsigned int shift_hash(void *key, unsigned int size)
+/* A name can be bound only once in a scope, but may shadow an outer one. */
+static Boolean bind(unsigned int sym, IDPropt *prop)
 {
-#ifdef DEBUG_SYMBOL_TABLE
-
-	char *keystr = (char *) key;
-	unsigned int i, hash, length;
+	unsigned int old;
 
-	hash = 0;
-	length = strlen(keystr);
-	for (i = 0; i < length; i++) {
-		hash += keystr[i];
+	old = max_bound;
+	bound = grow(bound, &max_bound, sym + 1, sizeof(unsigned int));
+	if (max_bound > old) {
+		memset(bound + old, 0, (max_bound - old) * sizeof(unsigned int));
+	} else if (bound[sym] > marks[depth - 1]) {
+		return FALSE;
 	}
 
-	return (hash % size);
+	bindings = grow(bindings, &max_bindings, nbindings + 1, sizeof(Binding));
+	bindings[nbindings].prop = prop;
+	bindings[nbindings].sym = sym;
+	bindings[nbindings].shadow = bound[sym];
+	bound[sym] = ++nbindings;
+
+	return TRUE;
+}
 
-#else
+/* Grow an array by doubling, if need be, so that it holds need elements. */
+static void *grow(void *array, unsigned int *max, unsigned int need,
+		size_t size)
+{
+	unsigned int n;
 
-	char *keystr = (char *) key;
-	unsigned int i, hash, length;
-	hash = 0;
-	length = strlen(keystr);
-	for (i = 0; i < length; i++) {
-		hash = (hash << 5) | (hash >> 27);
-		hash += keystr[i];
+	if (need <= *max) {
+		return array;
 	}
-	return (hash % size);
+	for (n = (*max == 0 ? INIT_SIZE : *max); n < need; n *= 2)
+		;
+	*max = n;
 
-#endif /* DEBUG_SYMBOL_TABLE */
+	return erealloc(array, n * size);
 }
 
-static int key_strcmp(void *val1, void *val2)
+static void valstr(const char *name, IDPropt *p, char *str)
 {
-	char *key1 = (char *) val1;
-	char *key2 = (char *) val2;
-
-	return strcmp(key1, key2);
+	if (IS_CALLABLE_TYPE(p->type)) {
+		sprintf(str, "%s@_[%s]", name, get_valtype_string(p->type));
+	} else {
+		sprintf(str, "%s@%d[%s]", name, p->offset,
+		        get_valtype_string(p->type));
+	}
 }
@@ -24,41 +24,47 @@ typedef struct {
 } IDPropt;
 
 /**
- * Initialise the global symbol table.
+ * Initialise the symbol table, with the global scope open.  The table is
+ * indexed by the numbers that the scanner gives to the names of identifiers,
+ * so that the names themselves are neither hashed nor compared.  The
+ * properties that are entered in the table are not copied, and are not
+ * released with it; they should be allocated in the arena of the compilation.
  */
 void init_symbol_table(void);
 
 /**
  * Open a new function or procedure (subroutine) context by (1) inserting the
- * subroutine name and properties into the global symbol table, (2) preserving
- * the global symbol table for later re-use, and (3) initialising a new local
- * symbol table for the subroutine as current symbol table.
+ * subroutine name and properties into the global scope, and (2) opening a new
+ * local scope for the subroutine, in which its names may shadow global ones.
+ * Only the subroutines of the global scope are visible in the local scope.
  *
- * @param[in]   id
- *     the identifier of the new function or procedure
+ * @param[in]   sym
+ *     the number of the identifier of the new function or procedure, as the
+ *     scanner or <code>intern_name</code> returns it
  * @param[in]   prop
  *     the identifier properties of the new function or procedure
  * @return
  *     <code>TRUE</code> if the local subroutine context was set up
  *     successfully, or <code>FALSE</code> otherwise
  */
-Boolean open_subroutine(char *id, IDPropt *prop);
+Boolean open_subroutine(unsigned int sym, IDPropt *prop);
 
 /**
- * Close the current subroutine context by (1) releasing memory resources
- * associated with the current local symbol table, and (2) setting the preserved
- * global symbol table as the current symbol table.
+ * Close the current subroutine context by (1) removing the names of the local
+ * scope, which restores the global names that they shadowed, and (2) making
+ * the global scope current again.  The memory of the scope is kept for the
+ * next subroutine.
  */
 void close_subroutine(void);
 
 /**
  * Insert the specified identifier with the specified properties into the
- * current symbol table.  This function "steals" the <code>id</code> and
- * <code>prop</code> pointers, and assumes responsibility for their
- * deallocation.
+ * current symbol table.  The <code>prop</code> pointer is kept, not copied,
+ * and must remain valid as long as the table.
  *
- * @param[in]   id
- *     the identifier to insert
+ * @param[in]   sym
+ *     the number of the identifier to insert, as the scanner or
+ *     <code>intern_name</code> returns it
  * @param[in]   prop
  *     the properties to be associated with the new identifier
  * @return
@@ -66,14 +72,15 @@ void close_subroutine(void);
  *     table, or if there was not enough space for a new entry, or
  *     <code>TRUE</code> otherwise
  */
-Boolean insert_name(char *id, IDPropt *prop);
+Boolean insert_name(unsigned int sym, IDPropt *prop);
 
 /**
  * Retrieve the properties associated with the specified identifier from the
  * current symbol table.
  *
- * @param[in]   id
- *     the identifier to look up in the current symbol table
+ * @param[in]   sym
+ *     the number of the identifier to look up in the current symbol table,
+ *     as the scanner or <code>intern_name</code> returns it
  * @param[out]  prop
  *     the pointer to the pointer to which the pointer to the properties
  *     structure, associated with the identifier, will be copied
@@ -81,7 +88,7 @@ Boolean insert_name(char *id, IDPropt *prop);
  *     <code>TRUE</code> if the identifier exists in the current symbol table,
  *     or <code>FALSE</code> otherwise
  */
-Boolean find_name(char *id, IDPropt **prop);
+Boolean find_name(unsigned int sym, IDPropt **prop);
 
 /**
  * Return the number of the identifiers stored in the current symbol table.
@@ -89,7 +96,8 @@ Boolean find_name(char *id, IDPropt **prop);
 int get_variables_width(void);
 
 /**
- * Release the memory resources associated with the global symbol table.
+ * Release the memory resources associated with the symbol table, including
+ * those of a subroutine that is still open.
  */
 void release_symbol_table(void);
 
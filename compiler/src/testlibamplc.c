@@ -0,0 +1,207 @@
+/**
+ * @file    testlibamplc.c
+ * @brief   A driver program to stress the compiler library: it compiles a
+ *          number of programs on a number of threads at the same time, and
+ *          checks that every result matches that of compiling the same
+ *          program on its own.
+ * @date    2026-10-16
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "boolean.h"
+#include "error.h"
+#include "libamplc.h"
+
+/* --- type definitions and constants --------------------------------------- */
+
+#define NPROGRAMS   64  /* the number of programs to compile             */
+#define NTHREADS    16  /* the number of threads to compile them on      */
+#define NROUNDS     4   /* the number of times each thread compiles them */
+#define BAD_EVERY   8   /* every so many programs has an error           */
+#define SOURCE_SIZE 2048
+
+/** a program, with the result of compiling it on its own */
+typedef struct {
+	char        source[SOURCE_SIZE];
+	size_t      length;
+	int         status;
+	AmplcOutput expected;
+	char       *diagnostics;
+} Program;
+
+/** the work of one thread */
+typedef struct {
+	int id;       /* the number of the thread           */
+	int failures; /* the number of results that differ  */
+} Worker;
+
+static Program programs[NPROGRAMS];
+
+/* --- function prototypes -------------------------------------------------- */
+
+static void make_program(Program *p, int n);
+static void *work(void *arg);
+static Boolean check(CompilerCtx *ctx, Program *p, int status,
+		AmplcOutput *out);
+
+/* --- main routine --------------------------------------------------------- */
+
+int main(int argc, char *argv[])
+{
+	int i, failures;
+	CompilerCtx ctx;
+	pthread_t threads[NTHREADS];
+	Worker workers[NTHREADS];
+
+	setprogname(argv[0]);
+	(void) argc;
+
+	/* the expected results, one program at a time */
+	amplc_init(&ctx, "stress.ampl");
+	for (i = 0; i < NPROGRAMS; i++) {
+		make_program(&programs[i], i);
+		programs[i].status = amplc_compile(&ctx, programs[i].source,
+				programs[i].length, &programs[i].expected);
+		programs[i].diagnostics = estrdup(ctx.diagnostics);
+		if ((programs[i].status == EXIT_SUCCESS) != (i % BAD_EVERY != 0)) {
+			eprintf("program %d: unexpected status %d:\n%s", i,
+					programs[i].status, ctx.diagnostics);
+		}
+	}
+	amplc_release(&ctx);
+
+	/* the same programs, all at the same time */
+	for (i = 0; i < NTHREADS; i++) {
+		workers[i].id = i;
+		workers[i].failures = 0;
+		if (pthread_create(&threads[i], NULL, work, &workers[i]) != 0) {
+			eprintf("Could not create thread %d", i);
+		}
+	}
+	failures = 0;
+	for (i = 0; i < NTHREADS; i++) {
+		pthread_join(threads[i], NULL);
+		failures += workers[i].failures;
+	}
+
+	for (i = 0; i < NPROGRAMS; i++) {
+		amplc_release_output(&programs[i].expected);
+		free(programs[i].diagnostics);
+	}
+
+	printf("%d programs on %d threads, %d rounds: %d failures\n", NPROGRAMS,
+			NTHREADS, NROUNDS, failures);
+	freeprogname();
+
+	return (failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+/* --- programs ------------------------------------------------------------- */
+
+/**
+ * Makes a program that differs from the others in its name, constants, and
+ * shape; every so often, it refers to an undeclared variable.
+ */
+static void make_program(Program *p, int n)
+{
+	int len;
+
+	len = snprintf(p->source, SOURCE_SIZE,
+		"program p%d:\n"
+		"fill(int array a, int n):\n"
+		"  int i;\n"
+		"  let i = 0;\n"
+		"  while i < n:\n"
+		"    let a[i] = (i * %d + %d) rem 97;\n"
+		"    let i = i + 1\n"
+		"  end\n"
+		"\n"
+		"sum(int array a, int n) -> int:\n"
+		"  int i, s;\n"
+		"  let i = 0;\n"
+		"  let s = 0;\n"
+		"  while i < n:\n"
+		"    if a[i] > %d:\n"
+		"      let s = s + a[i]\n"
+		"    else:\n"
+		"      let s = s - 1\n"
+		"    end;\n"
+		"    let i = i + 1\n"
+		"  end;\n"
+		"  return s\n"
+		"\n"
+		"main:\n"
+		"  int array a;\n"
+		"  bool b;\n"
+		"  let a = array %d;\n"
+		"  fill(a, %d);\n"
+		"  let b = sum(a, %d) > %d;\n"
+		"  let %s = 1;\n"
+		"  output(\"p%d: \" .. sum(a, %d) .. \" \" .. b .. \"\\n\")\n",
+		n, n + 3, n * 7, n % 50, n + 10, n + 10, n + 10, n * 13,
+		(n % BAD_EVERY == 0 ? "undeclared" : "a[0]"), n, n + 10);
+	if (len < 0 || len >= SOURCE_SIZE) {
+		eprintf("program %d does not fit", n);
+	}
+	p->length = len;
+}
+
+/* --- threads -------------------------------------------------------------- */
+
+/**
+ * Compiles all the programs, each thread starting at a different one.
+ */
+static void *work(void *arg)
+{
+	int i, r, status;
+	Worker *w;
+	Program *p;
+	CompilerCtx ctx;
+	AmplcOutput out;
+
+	w = (Worker *) arg;
+	amplc_init(&ctx, "stress.ampl");
+	for (r = 0; r < NROUNDS; r++) {
+		for (i = 0; i < NPROGRAMS; i++) {
+			p = &programs[(w->id * 5 + r + i) % NPROGRAMS];
+			status = amplc_compile(&ctx, p->source, p->length, &out);
+			if (!check(&ctx, p, status, &out)) {
+				w->failures++;
+			}
+			amplc_release_output(&out);
+		}
+	}
+	amplc_release(&ctx);
+
+	return NULL;
+}
+
+/**
+ * Checks a result against the one expected.
+ */
+static Boolean check(CompilerCtx *ctx, Program *p, int status,
+		AmplcOutput *out)
+{
+	if (status != p->status) {
+		fprintf(stderr, "status %d instead of %d\n", status, p->status);
+		return FALSE;
+	}
+	if (strcmp(ctx->diagnostics, p->diagnostics) != 0) {
+		fprintf(stderr, "diagnostics differ:\n%s", ctx->diagnostics);
+		return FALSE;
+	}
+	if (status != EXIT_SUCCESS) {
+		return TRUE;
+	}
+	if (strcmp(out->name, p->expected.name) != 0
+			|| out->length != p->expected.length
+			|| memcmp(out->bytes, p->expected.bytes, out->length) != 0) {
+		fprintf(stderr, "class file %s differs\n", out->name);
+		return FALSE;
+	}
+
+	return TRUE;
+}
@@ -7,6 +7,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include "arena.h"
 #include "error.h"
 #include "scanner.h"
 #include "token.h"
@@ -47,7 +48,9 @@ int main(int argc, char *argv[])
 		get_token(&token);
 	}
 
-	/* free names */
+	/* free names and scanner resources */
+	release_scanner();
+	release_unit_arena();
 	freeprogname();
 	freesrcname();
 	fclose(in_file);
@@ -69,7 +72,6 @@ void print_token(Token *token)
 			break;
 		case TOK_STR:
 			printf("String: \"%s\"\n", token->string);
-			free(token->string);
 			break;
 		default:
 			printf("%s\n", get_token_string(token->type));
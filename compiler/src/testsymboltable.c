@@ -8,14 +8,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "arena.h"
 #include "boolean.h"
+#include "scanner.h"
 #include "symboltable.h"
 
 #define BUFFER_SIZE 1024
 
 int main(void)
 {
-	char buffer[BUFFER_SIZE], *id;
+	char buffer[BUFFER_SIZE];
 	unsigned offset = 0;
 	Boolean main_is_active;
 	IDPropt *propts;
@@ -50,17 +52,13 @@ int main(void)
 				continue;
 			}
 
-			id = strdup(buffer);
-			propts = malloc(sizeof(IDPropt));
-			memset(propts, 0, sizeof(IDPropt));
+			propts = unit_alloc(sizeof(IDPropt));
 			propts->type = TYPE_CALLABLE | TYPE_INTEGER;
 
-			if (open_subroutine(id, propts)) {
+			if (open_subroutine(intern_name(buffer), propts)) {
 				main_is_active = FALSE;
 			} else {
 				printf("Subroutine already exists ... not added.\n");
-				free(id);
-				free(propts);
 			}
 
 		} else if (strcmp(buffer, "close") == 0) {
@@ -80,21 +78,18 @@ int main(void)
 		} else if (strcmp(buffer, "insert") == 0) {
 
 			scanf("%s", buffer);
-			id = strdup(buffer);
-			propts = malloc(sizeof(IDPropt));
+			propts = unit_alloc(sizeof(IDPropt));
 			propts->type = TYPE_INTEGER;
 			propts->offset = offset++;
 
-			if (!insert_name(id, propts)) {
+			if (!insert_name(intern_name(buffer), propts)) {
 				printf("Identifier already exists ... not added.\n");
-				free(id);
-				free(propts);
 			}
 
 		} else if (strcmp(buffer, "find") == 0) {
 
 			scanf("%s", buffer);
-			if (find_name(buffer, &propts)) {
+			if (find_name(intern_name(buffer), &propts)) {
 				printf("\"%s\" found ", buffer);
 				if (IS_CALLABLE_TYPE(propts->type)) {
 					printf("as callable\n");
@@ -120,6 +115,8 @@ int main(void)
 
 	printf("Goodbye!\n");
 	release_symbol_table();
+	release_scanner();
+	release_unit_arena();
 
 	return EXIT_SUCCESS;
 }
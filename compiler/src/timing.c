@@ -0,0 +1,245 @@
+/**
+ * @file    timing.c
+ * @brief   Timing of the phases of a compilation, for the time report.
+ *
+ * Wall time is taken from the monotonic clock, and CPU time from the CPU clock
+ * of the calling thread, so that compilations on different threads are timed
+ * separately.  The CPU time of the processes that a phase waits for, such as
+ * the Jasmin assembler or the linker, is added to that of the phase.
+ *
+ * @date    2026-10-16
+ */
+
+#include "timing.h"
+#include "error.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <sys/resource.h>
+#include <time.h>
+
+/** a point in time, or a duration, in nanoseconds */
+typedef struct {
+	int64_t wall; /**< the wall time                                */
+	int64_t cpu;  /**< the CPU time of the thread and its children  */
+} Stamp;
+
+/** the names of the phases in the report */
+static const char *phase_names[] = {
+	"reading",
+	"scanning",
+	"parsing",
+	"code generation",
+	"output",
+	"assembly",
+	"running",
+};
+
+/** the keys of the phases in the JSON report */
+static const char *phase_keys[] = {
+	"read", "scan", "parse", "codegen", "output", "assemble", "run",
+};
+
+/* --- global static variables ---------------------------------------------- */
+
+static _Thread_local Boolean       timing;       /**< whether to time     */
+static _Thread_local Stamp         origin;       /**< the start           */
+static _Thread_local Stamp         started[NPHASES];
+static _Thread_local Stamp         spent[NPHASES];
+static _Thread_local AllocCounts   allocs;       /**< at the start        */
+static _Thread_local unsigned long nlines;       /**< of the source text  */
+static _Thread_local unsigned long ntokens;      /**< of the source text  */
+
+/* --- function prototypes -------------------------------------------------- */
+
+static void stamp(Stamp *s);
+static int64_t nanoseconds(struct timespec *ts);
+static long peak_rss(void);
+static void print_json(FILE *out, const char *name, const Stamp *total,
+		const AllocCounts *counts);
+static void print_string(FILE *out, const char *s);
+
+/* --- timing interface ----------------------------------------------------- */
+
+void init_timing(Boolean enabled)
+{
+	int i;
+
+	timing = enabled;
+	if (!timing) {
+		return;
+	}
+	for (i = 0; i < NPHASES; i++) {
+		spent[i].wall = spent[i].cpu = 0;
+	}
+	nlines = ntokens = 0;
+	getalloccounts(&allocs);
+	stamp(&origin);
+}
+
+void start_phase(Phase phase)
+{
+	if (timing) {
+		stamp(&started[phase]);
+	}
+}
+
+void stop_phase(Phase phase)
+{
+	Stamp now;
+
+	if (timing) {
+		stamp(&now);
+		spent[phase].wall += now.wall - started[phase].wall;
+		spent[phase].cpu += now.cpu - started[phase].cpu;
+	}
+}
+
+void deduct_phase(Phase phase, Phase part)
+{
+	if (timing) {
+		spent[phase].wall -= spent[part].wall;
+		spent[phase].cpu -= spent[part].cpu;
+		/* a part measured on its own may take a little longer */
+		if (spent[phase].wall < 0) {
+			spent[phase].wall = 0;
+		}
+		if (spent[phase].cpu < 0) {
+			spent[phase].cpu = 0;
+		}
+	}
+}
+
+void count_source(unsigned long lines, unsigned long tokens)
+{
+	nlines = lines;
+	ntokens = tokens;
+}
+
+void print_time_report(FILE *out, const char *name, Boolean json)
+{
+	int i;
+	Stamp total;
+	AllocCounts counts;
+
+	assert(timing);
+
+	stamp(&total);
+	total.wall -= origin.wall;
+	total.cpu -= origin.cpu;
+	getalloccounts(&counts);
+	counts.mallocs -= allocs.mallocs;
+	counts.malloc_bytes -= allocs.malloc_bytes;
+	counts.reallocs -= allocs.reallocs;
+	counts.realloc_bytes -= allocs.realloc_bytes;
+
+	if (json) {
+		print_json(out, name, &total, &counts);
+		return;
+	}
+
+	fprintf(out, "time report for %s\n", name);
+	fprintf(out, "  %-16s %12lu lines %11lu tokens\n", "source", nlines,
+			ntokens);
+	fprintf(out, "  %-16s %12s %12s\n", "phase", "wall (ms)", "cpu (ms)");
+	for (i = 0; i < NPHASES; i++) {
+		fprintf(out, "  %-16s %12.3f %12.3f\n", phase_names[i],
+				spent[i].wall / 1e6, spent[i].cpu / 1e6);
+	}
+	fprintf(out, "  %-16s %12.3f %12.3f\n", "total",
+			total.wall / 1e6, total.cpu / 1e6);
+	fprintf(out, "  %-16s %12ld KiB\n", "peak RSS", peak_rss());
+	fprintf(out, "  %-16s %12lu calls %12zu bytes\n", "emalloc",
+			counts.mallocs, counts.malloc_bytes);
+	fprintf(out, "  %-16s %12lu calls %12zu bytes\n", "erealloc",
+			counts.reallocs, counts.realloc_bytes);
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+/**
+ * Takes the current wall time, and the CPU time of the calling thread and the
+ * children that it has waited for.
+ */
+static void stamp(Stamp *s)
+{
+	struct timespec ts;
+	struct rusage ru;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	s->wall = nanoseconds(&ts);
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	s->cpu = nanoseconds(&ts);
+	if (getrusage(RUSAGE_CHILDREN, &ru) == 0) {
+		s->cpu += ((int64_t) ru.ru_utime.tv_sec + ru.ru_stime.tv_sec)
+				* 1000000000;
+		s->cpu += ((int64_t) ru.ru_utime.tv_usec + ru.ru_stime.tv_usec)
+				* 1000;
+	}
+}
+
+static int64_t nanoseconds(struct timespec *ts)
+{
+	return (int64_t) ts->tv_sec * 1000000000 + ts->tv_nsec;
+}
+
+/**
+ * Returns the peak resident set size of the process in KiB, which covers all
+ * of its threads.
+ */
+static long peak_rss(void)
+{
+	struct rusage ru;
+
+	if (getrusage(RUSAGE_SELF, &ru) != 0) {
+		return 0;
+	}
+#ifdef __APPLE__
+	return ru.ru_maxrss / 1024;
+#else
+	return ru.ru_maxrss;
+#endif
+}
+
+/**
+ * Prints the report as one JSON object on a line of its own, with times in
+ * milliseconds and sizes in bytes, for tools to collect.
+ */
+static void print_json(FILE *out, const char *name, const Stamp *total,
+		const AllocCounts *counts)
+{
+	int i;
+
+	fprintf(out, "{\"file\": ");
+	print_string(out, name);
+	fprintf(out, ", \"lines\": %lu, \"tokens\": %lu", nlines, ntokens);
+	fprintf(out, ", \"phases\": {");
+	for (i = 0; i < NPHASES; i++) {
+		fprintf(out, "%s\"%s\": {\"wall_ms\": %.3f, \"cpu_ms\": %.3f}",
+				(i > 0 ? ", " : ""), phase_keys[i],
+				spent[i].wall / 1e6, spent[i].cpu / 1e6);
+	}
+	fprintf(out, "}, \"total\": {\"wall_ms\": %.3f, \"cpu_ms\": %.3f}",
+			total->wall / 1e6, total->cpu / 1e6);
+	fprintf(out, ", \"peak_rss_bytes\": %ld", peak_rss() * 1024);
+	fprintf(out, ", \"emalloc\": {\"calls\": %lu, \"bytes\": %zu}",
+			counts->mallocs, counts->malloc_bytes);
+	fprintf(out, ", \"erealloc\": {\"calls\": %lu, \"bytes\": %zu}}\n",
+			counts->reallocs, counts->realloc_bytes);
+}
+
+/** Prints a string as a JSON string literal. */
+static void print_string(FILE *out, const char *s)
+{
+	fputc('"', out);
+	for (; *s; s++) {
+		if (*s == '"' || *s == '\\') {
+			fprintf(out, "\\%c", *s);
+		} else if ((unsigned char) *s < ' ') {
+			fprintf(out, "\\u%04x", *s);
+		} else {
+			fputc(*s, out);
+		}
+	}
+	fputc('"', out);
+}
@@ -0,0 +1,88 @@
+/**
+ * @file    timing.h
+ * @brief   Timing of the phases of a compilation, for the time report.
+ * @date    2026-10-16
+ */
+
+#ifndef TIMING_H
+#define TIMING_H
+
+#include "boolean.h"
+
+#include <stdio.h>
+
+/** the phases of a compilation, in the order in which they are reported */
+typedef enum {
+	PHASE_READ,     /**< reading or mapping the source text      */
+	PHASE_SCAN,     /**< scanning the source text into tokens    */
+	PHASE_PARSE,    /**< parsing and type checking               */
+	PHASE_CODEGEN,  /**< folding, and generating code            */
+	PHASE_OUTPUT,   /**< writing the class, Jasmin, or assembly  */
+	PHASE_ASSEMBLE, /**< assembling or linking the output        */
+	PHASE_RUN,      /**< running the program in the interpreter  */
+	NPHASES
+} Phase;
+
+/**
+ * Start timing a compilation on the calling thread.  Until the next call, the
+ * phases are only timed if the report is enabled, so that timing costs
+ * nothing otherwise.
+ *
+ * @param[in]  enabled
+ *     whether the compilation is timed
+ */
+void init_timing(Boolean enabled);
+
+/**
+ * Start timing a phase.  The time of a phase that is started more than once
+ * accumulates.
+ *
+ * @param[in]  phase
+ *     the phase
+ */
+void start_phase(Phase phase);
+
+/**
+ * Stop timing a phase, which must have been started.
+ *
+ * @param[in]  phase
+ *     the phase
+ */
+void stop_phase(Phase phase);
+
+/**
+ * Deduct the time of one phase from that of another, which contained it.
+ *
+ * @param[in]  phase
+ *     the phase from which to deduct the time
+ * @param[in]  part
+ *     the phase of which the time is deducted
+ */
+void deduct_phase(Phase phase, Phase part);
+
+/**
+ * Record the size of the source text, for the report.
+ *
+ * @param[in]  lines
+ *     the number of lines in the source text
+ * @param[in]  tokens
+ *     the number of tokens in the source text
+ */
+void count_source(unsigned long lines, unsigned long tokens);
+
+/**
+ * Print the size of the source text, the wall and CPU time of every phase
+ * since the timing started, the peak resident set size of the process, and the
+ * allocations of the calling thread, either as a table or as a JSON object on
+ * one line.
+ *
+ * @param[in]  out
+ *     the stream to which to print the report
+ * @param[in]  name
+ *     the name of the source file
+ * @param[in]  json
+ *     whether to print the report as JSON
+ */
+void print_time_report(FILE *out, const char *name, Boolean json);
+
+#endif /* TIMING_H */
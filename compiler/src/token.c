@@ -25,3 +25,14 @@ const char *get_token_string(TokenType type)
 	assert(type >= 0 && type < (sizeof(token_names) / sizeof(token_names[0])));
 	return token_names[type];
 }
+
+unsigned int hash_name(const char *name)
+{
+	unsigned int hash;
+
+	for (hash = 0; *name; name++) {
+		hash = HASH_NAME_STEP(hash, *name);
+	}
+
+	return hash;
+}
@@ -12,6 +12,18 @@
 /** the maximum length of an identifier */
 #define MAX_ID_LEN 32
 
+/**
+ * Add a character to the hash of an identifier.  The scanner hashes every
+ * identifier as it reads it, to intern its name.  The hash is deliberately
+ * weak in the debug build of the symbol table, to exercise the collision
+ * handling of the table of names.
+ */
+#ifdef DEBUG_SYMBOL_TABLE
+#define HASH_NAME_STEP(hash, ch) ((hash) + (ch))
+#else
+#define HASH_NAME_STEP(hash, ch) ((((hash) << 5) | ((hash) >> 27)) + (ch))
+#endif
+
 /** the types of tokens that the scanner recognises */
 typedef enum {
 
@@ -89,6 +101,8 @@ typedef struct {
 		char  lexeme[MAX_ID_LEN+1]; /**< lexeme for identifiers       */
 		char *string;               /**< string (for write)           */
 	};
+	unsigned int len;               /**< length of the lexeme         */
+	unsigned int sym;               /**< number of the identifier     */
 } Token;
 
 /**
@@ -101,4 +115,14 @@ typedef struct {
  */
 const char *get_token_string(TokenType type);
 
+/**
+ * Return the hash of an identifier, as the scanner computes it.
+ *
+ * @param[in]  name
+ *     the identifier
+ * @return
+ *     the hash of the identifier
+ */
+unsigned int hash_name(const char *name);
+
 #endif /* TOKEN_H */
@@ -0,0 +1,622 @@
+/**
+ * @file    x86_64.c
+ * @brief   A backend that translates the generated JVM code to GNU assembler
+ *          for x86-64 Linux.
+ *
+ * Every subroutine and main become a function, and the JVM operand stack is
+ * kept on the machine stack, one quadword per slot, so that every instruction
+ * is translated on its own.  Integers are kept sign-extended to 64 bits, and
+ * arithmetic is done on the lower 32 bits, so that it wraps around as on the
+ * JVM.  Local variables are quadwords below the frame pointer.
+ *
+ * Subroutines are called with their arguments on the stack, as the JVM code
+ * leaves them; the callee copies them into its local variables, and the caller
+ * pops them and pushes the result, which is returned in %rax.  The functions
+ * of the C runtime are called according to the System V ABI instead, with the
+ * stack aligned to 16 bytes for the duration of the call.
+ *
+ * Arrays are allocated by the runtime, with their length in the quadword just
+ * before the first element.  Null array references, out-of-bounds indices, and
+ * division by zero call the runtime to report the exception that the JVM would
+ * have thrown.
+ *
+ * @date    2026-10-16
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "boolean.h"
+#include "codegen.h"
+#include "error.h"
+#include "jvm.h"
+#include "x86_64.h"
+
+/* --- type definitions and constants --------------------------------------- */
+
+#define ASM_EXT       ".s"
+#define MAIN_SYMBOL   "ampl_main"
+#define SUB_PREFIX    "ampl_fn_"
+#define THROW_SYMBOL  "ampl_rt_throw"
+#define ARRAY_SYMBOL  "ampl_rt_new_array"
+#define NULL_SYMBOL   "ampl_rt_null_pointer"
+#define MAX_REG_ARGS  6
+
+#define BOUNDS_EXCEPTION "java/lang/ArrayIndexOutOfBoundsException"
+#define DIVIDE_EXCEPTION "java/lang/ArithmeticException"
+
+/** the methods of the JVM runtime support code, and the C functions that
+ * replace them */
+static const struct {
+	const char *member; /**< the method name and descriptor */
+	const char *symbol; /**< the C function                 */
+} runtime_calls[] = {
+	{ "print$(I)V",                  "ampl_rt_print_int"    },
+	{ "print$(Z)V",                  "ampl_rt_print_bool"   },
+	{ "print$(Ljava/lang/String;)V", "ampl_rt_print_string" },
+	{ "readInt()I",                  "ampl_rt_read_int"     },
+	{ "readBoolean()Z",              "ampl_rt_read_bool"    }
+};
+
+#define NRUNTIME_CALLS (sizeof(runtime_calls) / sizeof(runtime_calls[0]))
+
+/** the registers for integer arguments of C functions, in order */
+static const char *arg_regs[MAX_REG_ARGS] = {
+	"%rdi", "%rsi", "%rdx", "%rcx", "%r8", "%r9"
+};
+
+/* --- global static variables ---------------------------------------------- */
+
+static _Thread_local FILE        *out;      /**< the assembly file            */
+static _Thread_local const char **strings;  /**< the string constants         */
+static _Thread_local int          nstrings; /**< the number of strings        */
+static _Thread_local int          nlocal;   /**< the number of local labels   */
+
+/* --- function prototypes -------------------------------------------------- */
+
+static void write_function(Body *b, int index);
+static void write_instruction(Bytecode opcode, Code *operand, int index);
+static void write_invoke(const char *ref);
+static void write_c_call(const char *symbol, int nargs);
+static void write_binary(const char *instr);
+static void write_division(Bytecode opcode, int index);
+static void write_null_check(int index);
+static void write_branch(const char *jump, const char *cmp, int noperands,
+		Label label);
+static const char *branch_condition(Bytecode opcode);
+static int add_string(const char *s);
+static char *make_asm_name(void);
+
+/* --- assembly interface --------------------------------------------------- */
+
+void make_asm_file(void)
+{
+	int i, index;
+	char *path;
+	Body *b, *last;
+
+	strings = NULL;
+	nstrings = 0;
+	nlocal = 0;
+
+	path = make_asm_name();
+	if ((out = fopen(path, "w")) == NULL) {
+		eprintf("Could not open assembly file:");
+	}
+
+	fprintf(out, "\t.text\n");
+	fprintf(out, "\t.globl\t%s\n", MAIN_SYMBOL);
+
+	/* functions, in the order in which they were generated */
+	last = NULL;
+	for (b = get_bodies(); b; b = b->next) {
+		last = b;
+	}
+	for (index = 0, b = last; b; b = b->prev, index++) {
+		if (!b->support) {
+			write_function(b, index);
+		}
+	}
+
+	/* string constants, which are escaped the same way in AMPL and GAS */
+	fprintf(out, "\t.section\t.rodata\n");
+	fprintf(out, ".LXbounds:\n\t.string\t\"%s\"\n", BOUNDS_EXCEPTION);
+	fprintf(out, ".LXdivide:\n\t.string\t\"%s\"\n", DIVIDE_EXCEPTION);
+	for (i = 0; i < nstrings; i++) {
+		fprintf(out, ".LS%d:\n\t.string\t\"%s\"\n", i, strings[i]);
+	}
+	fprintf(out, "\t.section\t.note.GNU-stack,\"\",@progbits\n");
+
+	if (fclose(out) != 0) {
+		eprintf("Could not write assembly file:");
+	}
+
+	free(strings);
+	free(path);
+}
+
+void link_executable(const char *runtime_path)
+{
+	int status;
+	pid_t pid;
+	char *asm_name;
+	const char *exe_name;
+
+	asm_name = make_asm_name();
+	exe_name = get_class_name();
+
+	if ((pid = fork()) < 0) {
+		eprintf("Could not fork a new process for linker");
+	} else if (pid == 0) {
+		if (execlp("cc", "cc", "-o", exe_name, asm_name, runtime_path,
+					(char *) NULL) < 0) {
+			eprintf("Could not exec the C compiler");
+		}
+	}
+
+	if (waitpid(pid, &status, 0) < 0) {
+		eprintf("Error waiting for the C compiler");
+	} else {
+		if (WIFEXITED(status) && WEXITSTATUS(status) != EXIT_SUCCESS) {
+			eprintf("The C compiler reported failure");
+		} else if (WIFSIGNALED(status) || WIFSTOPPED(status)) {
+			eprintf("The C compiler stopped or terminated abnormally");
+		}
+	}
+
+#ifndef DEBUG_CODEGEN
+	unlink(asm_name);
+#endif
+	free(asm_name);
+}
+
+/* --- function translation ------------------------------------------------- */
+
+/**
+ * Writes a subroutine or main as a function: the prologue, which sets up the
+ * local variables, the translated code, and the stubs that report exceptions.
+ *
+ * @param[in] b     the body of the subroutine or main.
+ * @param[in] index the number of the body, which makes its stubs unique.
+ */
+static void write_function(Body *b, int index)
+{
+	int i, nparams;
+	Code *c, *operand;
+
+	nparams = (b->idprop ? (int) b->idprop->nparams : 0);
+
+	if (b->idprop) {
+		fprintf(out, "\t.type\t%s%s, @function\n%s%s:\n", SUB_PREFIX, b->name,
+				SUB_PREFIX, b->name);
+	} else {
+		fprintf(out, "\t.type\t%s, @function\n%s:\n", MAIN_SYMBOL,
+				MAIN_SYMBOL);
+	}
+	fprintf(out, "\tpushq\t%%rbp\n");
+	fprintf(out, "\tmovq\t%%rsp, %%rbp\n");
+	if (b->variables_width > 0) {
+		fprintf(out, "\tsubq\t$%d, %%rsp\n", 8 * b->variables_width);
+	}
+
+	/* the arguments were pushed in order, so the last one is nearest */
+	for (i = 0; i < b->variables_width; i++) {
+		if (i < nparams) {
+			fprintf(out, "\tmovq\t%d(%%rbp), %%rax\n",
+					16 + 8 * (nparams - 1 - i));
+			fprintf(out, "\tmovq\t%%rax, %d(%%rbp)\n", -8 * (i + 1));
+		} else {
+			fprintf(out, "\tmovq\t$0, %d(%%rbp)\n", -8 * (i + 1));
+		}
+	}
+
+	for (i = 0; i < b->ip; i++) {
+		c = &b->code[i];
+		switch (c->type & MASK_TYPE) {
+			case CODE_LABEL:
+				fprintf(out, ".LL%u:\n", c->label);
+				break;
+			case CODE_INSTRUCTION:
+				operand = NULL;
+				if (i + 1 < b->ip && (b->code[i+1].type & CODE_OPERAND)) {
+					operand = &b->code[++i];
+				}
+				write_instruction(c->code, operand, index);
+				break;
+			default:
+				eprintf("Unexpected item in code of method '%s': %x", b->name,
+						(unsigned int) c->type);
+		}
+	}
+
+	/* exception stubs; the runtime does not return, so the stack is simply
+	 * aligned */
+	fprintf(out, ".LB%d:\n", index);
+	fprintf(out, "\tleaq\t.LXbounds(%%rip), %%rdi\n");
+	fprintf(out, "\tandq\t$-16, %%rsp\n");
+	fprintf(out, "\tcall\t%s\n", THROW_SYMBOL);
+	fprintf(out, ".LZ%d:\n", index);
+	fprintf(out, "\tleaq\t.LXdivide(%%rip), %%rdi\n");
+	fprintf(out, "\tandq\t$-16, %%rsp\n");
+	fprintf(out, "\tcall\t%s\n", THROW_SYMBOL);
+	fprintf(out, ".LN%d:\n", index);
+	fprintf(out, "\tandq\t$-16, %%rsp\n");
+	fprintf(out, "\tcall\t%s\n", NULL_SYMBOL);
+
+	if (b->idprop) {
+		fprintf(out, "\t.size\t%s%s, .-%s%s\n\n", SUB_PREFIX, b->name,
+				SUB_PREFIX, b->name);
+	} else {
+		fprintf(out, "\t.size\t%s, .-%s\n\n", MAIN_SYMBOL, MAIN_SYMBOL);
+	}
+}
+
+/**
+ * Writes the translation of a single instruction.
+ *
+ * @param[in] opcode  the instruction.
+ * @param[in] operand the operand of the instruction, or <code>NULL</code>.
+ * @param[in] index   the number of the body, for its exception stubs.
+ */
+static void write_instruction(Bytecode opcode, Code *operand, int index)
+{
+	switch (opcode) {
+		case JVM_ALOAD:
+		case JVM_ILOAD:
+			fprintf(out, "\tpushq\t%d(%%rbp)\n", -8 * (operand->num + 1));
+			break;
+		case JVM_ASTORE:
+		case JVM_ISTORE:
+			fprintf(out, "\tpopq\t%d(%%rbp)\n", -8 * (operand->num + 1));
+			break;
+		case JVM_ICONST_M1:
+		case JVM_ICONST_0:
+		case JVM_ICONST_1:
+		case JVM_ICONST_2:
+		case JVM_ICONST_3:
+		case JVM_ICONST_4:
+		case JVM_ICONST_5:
+			fprintf(out, "\tpushq\t$%d\n", (int) (opcode - JVM_ICONST_0));
+			break;
+		case JVM_BIPUSH:
+		case JVM_SIPUSH:
+			fprintf(out, "\tpushq\t$%d\n", operand->num);
+			break;
+		case JVM_LDC:
+			if ((operand->type & MASK_DATA_TYPE) == CODE_STRING) {
+				fprintf(out, "\tleaq\t.LS%d(%%rip), %%rax\n",
+						add_string(operand->string));
+				fprintf(out, "\tpushq\t%%rax\n");
+			} else {
+				fprintf(out, "\tpushq\t$%d\n", operand->num);
+			}
+			break;
+		case JVM_IADD:
+			write_binary("addl");
+			break;
+		case JVM_ISUB:
+			write_binary("subl");
+			break;
+		case JVM_IMUL:
+			write_binary("imull");
+			break;
+		case JVM_IAND:
+			write_binary("andl");
+			break;
+		case JVM_IOR:
+			write_binary("orl");
+			break;
+		case JVM_IXOR:
+			write_binary("xorl");
+			break;
+		case JVM_IDIV:
+		case JVM_IREM:
+			write_division(opcode, index);
+			break;
+		case JVM_INEG:
+			fprintf(out, "\tpopq\t%%rax\n");
+			fprintf(out, "\tnegl\t%%eax\n");
+			fprintf(out, "\tmovslq\t%%eax, %%rax\n");
+			fprintf(out, "\tpushq\t%%rax\n");
+			break;
+		case JVM_IALOAD:
+			fprintf(out, "\tpopq\t%%rcx\n");
+			fprintf(out, "\tpopq\t%%rax\n");
+			write_null_check(index);
+			fprintf(out, "\tcmpq\t-8(%%rax), %%rcx\n");
+			fprintf(out, "\tjae\t.LB%d\n", index);
+			fprintf(out, "\tmovslq\t(%%rax,%%rcx,4), %%rax\n");
+			fprintf(out, "\tpushq\t%%rax\n");
+			break;
+		case JVM_IASTORE:
+			fprintf(out, "\tpopq\t%%rdx\n");
+			fprintf(out, "\tpopq\t%%rcx\n");
+			fprintf(out, "\tpopq\t%%rax\n");
+			write_null_check(index);
+			fprintf(out, "\tcmpq\t-8(%%rax), %%rcx\n");
+			fprintf(out, "\tjae\t.LB%d\n", index);
+			fprintf(out, "\tmovl\t%%edx, (%%rax,%%rcx,4)\n");
+			break;
+		case JVM_ARRAYLENGTH:
+			fprintf(out, "\tpopq\t%%rax\n");
+			write_null_check(index);
+			fprintf(out, "\tpushq\t-8(%%rax)\n");
+			break;
+		case JVM_NEWARRAY:
+			if (operand->atype != T_INT) {
+				eprintf("Unsupported array type for x86-64 target");
+			}
+			write_c_call(ARRAY_SYMBOL, 1);
+			fprintf(out, "\tpushq\t%%rax\n");
+			break;
+		case JVM_GOTO:
+			fprintf(out, "\tjmp\t.LL%u\n", operand->label);
+			break;
+		case JVM_IFEQ:
+		case JVM_IFNE:
+		case JVM_IFGE:
+		case JVM_IFGT:
+			write_branch(branch_condition(opcode), NULL, 1, operand->label);
+			break;
+		case JVM_IF_ICMPEQ:
+		case JVM_IF_ICMPGE:
+		case JVM_IF_ICMPGT:
+		case JVM_IF_ICMPLE:
+		case JVM_IF_ICMPLT:
+		case JVM_IF_ICMPNE:
+			write_branch(branch_condition(opcode), "cmpl", 2, operand->label);
+			break;
+		case JVM_DUP:
+			fprintf(out, "\tpushq\t(%%rsp)\n");
+			break;
+		case JVM_POP:
+			fprintf(out, "\taddq\t$8, %%rsp\n");
+			break;
+		case JVM_SWAP:
+			fprintf(out, "\tpopq\t%%rax\n");
+			fprintf(out, "\tpopq\t%%rcx\n");
+			fprintf(out, "\tpushq\t%%rax\n");
+			fprintf(out, "\tpushq\t%%rcx\n");
+			break;
+		case JVM_NOP:
+			break;
+		case JVM_INVOKESTATIC:
+			write_invoke(operand->string);
+			break;
+		case JVM_NEW:
+			/* an exception object is represented by its class name */
+			fprintf(out, "\tleaq\t.LS%d(%%rip), %%rax\n",
+					add_string(operand->string));
+			fprintf(out, "\tpushq\t%%rax\n");
+			break;
+		case JVM_INVOKESPECIAL:
+			/* only the constructors of exceptions, without parameters */
+			fprintf(out, "\taddq\t$8, %%rsp\n");
+			break;
+		case JVM_ATHROW:
+			write_c_call(THROW_SYMBOL, 1);
+			break;
+		case JVM_IRETURN:
+		case JVM_ARETURN:
+			fprintf(out, "\tpopq\t%%rax\n");
+			fprintf(out, "\tleave\n");
+			fprintf(out, "\tret\n");
+			break;
+		case JVM_RETURN:
+			fprintf(out, "\tleave\n");
+			fprintf(out, "\tret\n");
+			break;
+		default:
+			eprintf("Instruction '%s' not supported by x86-64 target",
+					get_opcode_string(opcode));
+	}
+}
+
+/**
+ * Writes a call of a subroutine, or of the C function that replaces a method
+ * of the runtime support code.
+ *
+ * @param[in] ref the method reference, as "owner/name(parameters)return".
+ */
+static void write_invoke(const char *ref)
+{
+	const char *paren, *member, *p;
+	int nargs;
+	unsigned int i;
+
+	paren = strchr(ref, '(');
+	for (member = paren; member > ref && member[-1] != '/'; member--)
+		;
+
+	/* count the parameters: array markers precede the type they apply to */
+	nargs = 0;
+	for (p = paren + 1; *p != ')'; p++) {
+		if (*p == 'L') {
+			p = strchr(p, ';');
+		}
+		if (*p != '[') {
+			nargs++;
+		}
+	}
+
+	for (i = 0; i < NRUNTIME_CALLS; i++) {
+		if (strcmp(member, runtime_calls[i].member) == 0) {
+			write_c_call(runtime_calls[i].symbol, nargs);
+			if (p[1] != 'V') {
+				fprintf(out, "\tmovslq\t%%eax, %%rax\n");
+				fprintf(out, "\tpushq\t%%rax\n");
+			}
+			return;
+		}
+	}
+
+	fprintf(out, "\tcall\t%s%.*s\n", SUB_PREFIX, (int) (paren - member),
+			member);
+	if (nargs > 0) {
+		fprintf(out, "\taddq\t$%d, %%rsp\n", 8 * nargs);
+	}
+	if (p[1] != 'V') {
+		fprintf(out, "\tpushq\t%%rax\n");
+	}
+}
+
+/**
+ * Writes a call of a C function, with its arguments popped from the stack
+ * into registers.  The stack pointer is saved twice before it is aligned, so
+ * that one of the copies is always just above the aligned stack pointer.
+ *
+ * @param[in] symbol the C function.
+ * @param[in] nargs  the number of arguments, at most six.
+ */
+static void write_c_call(const char *symbol, int nargs)
+{
+	int i;
+
+	if (nargs > MAX_REG_ARGS) {
+		eprintf("Too many arguments for runtime function '%s'", symbol);
+	}
+	for (i = nargs - 1; i >= 0; i--) {
+		fprintf(out, "\tpopq\t%s\n", arg_regs[i]);
+	}
+	fprintf(out, "\tpushq\t%%rsp\n");
+	fprintf(out, "\tpushq\t(%%rsp)\n");
+	fprintf(out, "\tandq\t$-16, %%rsp\n");
+	fprintf(out, "\tcall\t%s\n", symbol);
+	fprintf(out, "\tmovq\t8(%%rsp), %%rsp\n");
+}
+
+/**
+ * Writes a 32-bit arithmetic or logical instruction on the top two slots.
+ */
+static void write_binary(const char *instr)
+{
+	fprintf(out, "\tpopq\t%%rcx\n");
+	fprintf(out, "\tpopq\t%%rax\n");
+	fprintf(out, "\t%s\t%%ecx, %%eax\n", instr);
+	fprintf(out, "\tmovslq\t%%eax, %%rax\n");
+	fprintf(out, "\tpushq\t%%rax\n");
+}
+
+/**
+ * Writes a division or remainder.  A zero divisor throws, as on the JVM, and a
+ * divisor of -1 is handled separately, since the minimum integer divided by -1
+ * traps on x86-64 but yields the minimum integer (and remainder zero) on the
+ * JVM.
+ */
+static void write_division(Bytecode opcode, int index)
+{
+	int minus_one, done;
+
+	minus_one = nlocal++;
+	done = nlocal++;
+
+	fprintf(out, "\tpopq\t%%rcx\n");
+	fprintf(out, "\tpopq\t%%rax\n");
+	fprintf(out, "\ttestl\t%%ecx, %%ecx\n");
+	fprintf(out, "\tje\t.LZ%d\n", index);
+	fprintf(out, "\tcmpl\t$-1, %%ecx\n");
+	fprintf(out, "\tje\t.LD%d\n", minus_one);
+	fprintf(out, "\tcltd\n");
+	fprintf(out, "\tidivl\t%%ecx\n");
+	if (opcode == JVM_IREM) {
+		fprintf(out, "\tmovl\t%%edx, %%eax\n");
+	}
+	fprintf(out, "\tjmp\t.LD%d\n", done);
+	fprintf(out, ".LD%d:\n", minus_one);
+	if (opcode == JVM_IREM) {
+		fprintf(out, "\txorl\t%%eax, %%eax\n");
+	} else {
+		fprintf(out, "\tnegl\t%%eax\n");
+	}
+	fprintf(out, ".LD%d:\n", done);
+	fprintf(out, "\tmovslq\t%%eax, %%rax\n");
+	fprintf(out, "\tpushq\t%%rax\n");
+}
+
+/**
+ * Writes a check that the array reference in %rax is not null, since the
+ * length in front of the elements cannot be read through a null reference.
+ */
+static void write_null_check(int index)
+{
+	fprintf(out, "\ttestq\t%%rax, %%rax\n");
+	fprintf(out, "\tje\t.LN%d\n", index);
+}
+
+/**
+ * Writes a conditional branch that compares the top slot with zero, or the
+ * top two slots with each other.
+ *
+ * @param[in] jump      the conditional jump instruction.
+ * @param[in] cmp       the comparison of two slots, or NULL for one.
+ * @param[in] noperands the number of slots to pop.
+ * @param[in] label     the target of the branch.
+ */
+static void write_branch(const char *jump, const char *cmp, int noperands,
+		Label label)
+{
+	if (noperands == 1) {
+		fprintf(out, "\tpopq\t%%rax\n");
+		fprintf(out, "\ttestl\t%%eax, %%eax\n");
+	} else {
+		fprintf(out, "\tpopq\t%%rcx\n");
+		fprintf(out, "\tpopq\t%%rax\n");
+		fprintf(out, "\t%s\t%%ecx, %%eax\n", cmp);
+	}
+	fprintf(out, "\t%s\t.LL%u\n", jump, label);
+}
+
+/**
+ * Returns the conditional jump that corresponds to a conditional branch.
+ */
+static const char *branch_condition(Bytecode opcode)
+{
+	switch (opcode) {
+		case JVM_IFEQ:
+		case JVM_IF_ICMPEQ: return "je";
+		case JVM_IFNE:
+		case JVM_IF_ICMPNE: return "jne";
+		case JVM_IFGE:
+		case JVM_IF_ICMPGE: return "jge";
+		case JVM_IFGT:
+		case JVM_IF_ICMPGT: return "jg";
+		case JVM_IF_ICMPLE: return "jle";
+		case JVM_IF_ICMPLT: return "jl";
+		default:
+			eprintf("Not a conditional branch: '%s'",
+					get_opcode_string(opcode));
+			return NULL;
+	}
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+/**
+ * Adds a string constant, and returns its number.  The string must outlive
+ * the writing of the assembly file.
+ */
+static int add_string(const char *s)
+{
+	strings = erealloc(strings, (nstrings + 1) * sizeof(const char *));
+	strings[nstrings] = s;
+	return nstrings++;
+}
+
+/**
+ * Returns a newly allocated name for the assembly file of the class.
+ */
+static char *make_asm_name(void)
+{
+	char *name;
+	const char *cname;
+
+	cname = get_class_name();
+	name = emalloc(strlen(cname) + sizeof(ASM_EXT));
+	strcpy(name, cname);
+	strcat(name, ASM_EXT);
+
+	return name;
+}
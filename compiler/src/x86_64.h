@@ -0,0 +1,30 @@
+/**
+ * @file    x86_64.h
+ * @brief   A backend that translates the generated JVM code to GNU assembler
+ *          for x86-64 Linux, and links it with a small C runtime.
+ * @date    2026-10-16
+ */
+
+#ifndef X86_64_H
+#define X86_64_H
+
+/**
+ * Write the subroutines and main of the current class to an assembly file in
+ * the current directory, named after the class with a ".s" extension.  The
+ * runtime support methods of the JVM target are not translated; the C runtime
+ * takes their place.  The bodies of all the methods must have been closed by
+ * <code>close_subroutine_codegen</code>.
+ */
+void make_asm_file(void);
+
+/**
+ * Link the assembly file with the C runtime into an executable named after the
+ * class, by running the system C compiler.  The file must first be written by
+ * calling <code>make_asm_file</code>.
+ *
+ * @param[in]  runtime_path
+ *     the path to the compiled C runtime (or its source)
+ */
+void link_executable(const char *runtime_path);
+
+#endif /* X86_64_H */